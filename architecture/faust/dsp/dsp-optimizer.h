@@ -39,6 +39,8 @@
 
 /*
     A class to find optimal Faust compiler parameters for a given DSP.
+    See also createOptimizedDSPFactoryFromFile/String in llvm-dsp.h, which does a time bounded search
+    with the same options inside libfaust and keeps the result in the factory cache.
 */
 template <typename REAL>
 class dsp_optimizer {
@@ -212,6 +212,8 @@ std::vector<std::string> getAllInterpreterDSPFactories();
 
 /**
  * Start multi-thread access mode (since by default the library is not 'multi-thread' safe).
+ * In this mode, factories can be created from several threads: each compilation runs with its own
+ * compiler state, only the parsing of the source files is done by one compilation at a time.
  *
  * @return true if 'multi-thread' safe access is started.
  */
@@ -267,6 +269,51 @@ interpreter_dsp_factory* readInterpreterDSPFactoryFromBitcodeFile(const std::str
  */
 void writeInterpreterDSPFactoryToBitcodeFile(interpreter_dsp_factory* factory, const std::string& bit_code_path);
 
+/**
+ * Create a Faust DSP factory from a machine code string, that is the compact binary format produced by
+ * writeInterpreterDSPFactoryToMachine. The binary format is directly decoded (without any textual parsing), so it
+ * is the fastest way to load a lot of precompiled DSPs. It has to be produced by the same version of the library.
+ * The code is still decoded into the interpreter instructions, so the factory uses the same memory as a parsed one.
+ * Note that the library keeps an internal cache of all allocated factories (see readInterpreterDSPFactoryFromBitcode).
+ *
+ * @param machine_code - the machine code string
+ * @param error_msg - the error string to be filled
+ *
+ * @return the DSP factory on success, otherwise a null pointer.
+ */
+interpreter_dsp_factory* readInterpreterDSPFactoryFromMachine(const std::string& machine_code, std::string& error_msg);
+
+/**
+ * Write a Faust DSP factory into a machine code string (compact binary format).
+ *
+ * @param factory - the DSP factory
+ *
+ * @return the machine code as a string.
+ */
+std::string writeInterpreterDSPFactoryToMachine(interpreter_dsp_factory* factory);
+
+/**
+ * Create a Faust DSP factory from a machine code file (compact binary format). The file is memory-mapped
+ * and directly decoded, then unmapped (the factory does not refer to the file content). Note that the library
+ * keeps an internal cache of all allocated factories (see readInterpreterDSPFactoryFromBitcode).
+ *
+ * @param machine_code_path - the machine code file pathname
+ * @param error_msg - the error string to be filled
+ *
+ * @return the DSP factory on success, otherwise a null pointer.
+ */
+interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineFile(const std::string& machine_code_path, std::string& error_msg);
+
+/**
+ * Write a Faust DSP factory into a machine code file (compact binary format).
+ *
+ * @param factory - the DSP factory
+ * @param machine_code_path - the machine code file pathname
+ *
+ * @return true if success, false otherwise.
+ */
+bool writeInterpreterDSPFactoryToMachineFile(interpreter_dsp_factory* factory, const std::string& machine_code_path);
+
 /*!
  @}
  */
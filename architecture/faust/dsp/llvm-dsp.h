@@ -155,6 +155,9 @@ llvm_dsp_factory* getDSPFactoryFromSHAKey(const std::string& sha_key);
  * allocated factories so that the compilation of the same DSP code (that is same source code and 
  * same set of 'normalized' compilations options) will return the same (reference counted) factory pointer. You will have to explicitly
  * use deleteDSPFactory to properly decrement the reference counter when the factory is no more needed.
+ * If the FAUST_CACHE_DIR environment variable is set to an existing directory, the compiled machine code is also
+ * kept on disk (keyed by the DSP code, the compilation options, the target and the compiler version, and checked
+ * against the content of the imported libraries), and later reloaded without any compilation, even after a process restart.
  * 
  * @param filename - the DSP filename
  * @param argc - the number of parameters in argv array 
@@ -179,6 +182,9 @@ llvm_dsp_factory* createDSPFactoryFromFile(const std::string& filename,
  * allocated factories so that the compilation of the same DSP code (that is same source code and 
  * same set of 'normalized' compilations options) will return the same (reference counted) factory pointer. You will have to explicitly
  * use deleteDSPFactory to properly decrement reference counter when the factory is no more needed.
+ * If the FAUST_CACHE_DIR environment variable is set to an existing directory, the compiled machine code is also
+ * kept on disk (keyed by the DSP code, the compilation options, the target and the compiler version, and checked
+ * against the content of the imported libraries), and later reloaded without any compilation, even after a process restart.
  * 
  * @param name_app - the name of the Faust program
  * @param dsp_content - the Faust program as a string
@@ -200,6 +206,62 @@ llvm_dsp_factory* createDSPFactoryFromString(const std::string& name_app,
                                              std::string& error_msg,
                                              int opt_level = -1);
 
+/**
+ * Create a Faust DSP factory from a DSP source code as a file, using the compilation options (-vec, -vs, -lv, -fun,
+ * -dfs, -g, -mcd) giving the fastest 'compute' on the host CPU. The option families tested by dsp-optimizer.h are
+ * compiled and measured in turn, a family being abandoned as soon as a larger vector size stops improving it, and the
+ * search stops when 'time_budget' is spent, keeping the best options found so far (see getCompileOptions).
+ * The chosen options are remembered (and kept on disk when FAUST_CACHE_DIR is set), so that later calls to
+ * createOptimizedDSPFactoryFromFile/String or createDSPFactoryFromFile/String with the same DSP, parameters, target
+ * and optimization level directly return the tuned factory. If argv already contains one of the tuned options,
+ * no search is done.
+ *
+ * @param filename - the DSP filename
+ * @param argc - the number of parameters in argv array
+ * @param argv - the array of parameters
+ * @param target - the LLVM machine target (using empty string will take current machine settings)
+ * @param error_msg - the error string to be filled
+ * @param time_budget - the maximum duration of the search in seconds
+ * @param buffer_size - the buffer size used in the measures (and the largest tested vector size)
+ * @param opt_level - LLVM IR to IR optimization level (from -1 to 4, -1 means 'maximum possible value'
+ * since the maximum value may change with new LLVM versions)
+ *
+ * @return a DSP factory on success, otherwise a null pointer.
+ */
+llvm_dsp_factory* createOptimizedDSPFactoryFromFile(const std::string& filename,
+                                                    int argc, const char* argv[],
+                                                    const std::string& target,
+                                                    std::string& error_msg,
+                                                    double time_budget = 10.,
+                                                    int buffer_size = 512,
+                                                    int opt_level = -1);
+
+/**
+ * Create a Faust DSP factory from a DSP source code as a string, using the compilation options giving
+ * the fastest 'compute' on the host CPU (see createOptimizedDSPFactoryFromFile).
+ *
+ * @param name_app - the name of the Faust program
+ * @param dsp_content - the Faust program as a string
+ * @param argc - the number of parameters in argv array
+ * @param argv - the array of parameters
+ * @param target - the LLVM machine target (using empty string will take current machine settings)
+ * @param error_msg - the error string to be filled
+ * @param time_budget - the maximum duration of the search in seconds
+ * @param buffer_size - the buffer size used in the measures (and the largest tested vector size)
+ * @param opt_level - LLVM IR to IR optimization level (from -1 to 4, -1 means 'maximum possible value'
+ * since the maximum value may change with new LLVM versions)
+ *
+ * @return a DSP factory on success, otherwise a null pointer.
+ */
+llvm_dsp_factory* createOptimizedDSPFactoryFromString(const std::string& name_app,
+                                                      const std::string& dsp_content,
+                                                      int argc, const char* argv[],
+                                                      const std::string& target,
+                                                      std::string& error_msg,
+                                                      double time_budget = 10.,
+                                                      int buffer_size = 512,
+                                                      int opt_level = -1);
+
 /**
  * Delete a Faust DSP factory, that is decrements it's reference counter, possibly really deleting the internal pointer. 
  * Possibly also delete DSP pointers associated with this factory, if they were not explicitly deleted with C++ delete.
@@ -237,6 +299,8 @@ std::vector<std::string> getAllDSPFactories();
 
 /**
  * Start multi-thread access mode (since by default the library is not 'multi-thread' safe).
+ * In this mode, factories can be created from several threads: each compilation runs with its own
+ * compiler state, only the parsing of the source files is done by one compilation at a time.
  * 
  * @return true if 'multi-thread' safe access is started.
  */ 
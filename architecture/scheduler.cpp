@@ -29,14 +29,26 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <strings.h>
 #include <semaphore.h>
 #include <sys/types.h>
+#ifdef __APPLE__
 #include <sys/sysctl.h>
+#endif
 #include <sys/stat.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <math.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 
 // For AVOIDDENORMALS
 #include "faust/dsp/dsp.h"
@@ -60,8 +72,10 @@ static int GetPID()
 #define LAST_TASK_INDEX 1
 
 #define MASTER_THREAD 0
-#define MAX_STEAL_DUR 50                        // in usec
-#define DEFAULT_CLOCKS_PER_SEC 2500000000       // in cycles (2,5 Ghz)
+#define SPIN_COUNT 256                          // failed steal attempts before yielding
+#define YIELD_COUNT 64                          // yields before parking
+#define MAX_PARK_DUR 1000                       // in usec
+#define CACHE_LINE_SIZE 64
 #define JACK_SCHED_POLICY SCHED_FIFO
 #define KDSPMESURE 50
 
@@ -276,111 +290,22 @@ inline bool Semaphore::try_wait()
 #ifdef __APPLE__
 //#include <CoreServices/../Frameworks/CarbonCore.framework/Headers/MacTypes.h>
 #include <MacTypes.h>
-#include <libkern/OSAtomic.h>
 #endif
 
 static void Yield();
 
 /**
- * Returns the number of clock cycles elapsed since the last reset
- * of the processor
+ * Hint to the CPU that we are in a spin-wait loop
  */
-static INLINE UInt64 DSP_rdtsc(void)
+static INLINE void Pause()
 {
-	union {
-		UInt32 i32[2];
-		UInt64 i64;
-	} count;
-	
-	__asm__ __volatile__("rdtsc" : "=a" (count.i32[0]), "=d" (count.i32[1]));
-    return count.i64;
-}
-
 #if defined(__i386__) || defined(__x86_64__)
-
-#define LOCK "lock ; "
-
-static INLINE void NOP(void)
-{
-    /*
-    #ifndef __APPLE__
-	__asm__ __volatile__("nop \n\t");
-    #endif
-    */
-}
-
-static INLINE char CAS1(volatile void* addr, volatile int value, int newvalue)
-{
-    return __sync_bool_compare_and_swap((int*)addr, value, newvalue);
-}
-
-static INLINE int atomic_xadd(volatile int* atomic, int val) 
-{ 
-     return __sync_add_and_fetch(atomic, val);
-} 
-
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
 #endif
-
-/*
-static INLINE int INC_ATOMIC(volatile int* val)
-{
-    int actual;
-    do {
-        actual = *val;
-    } while (!CAS1(val, actual, actual + 1));
-    return actual;
 }
 
-static INLINE int DEC_ATOMIC(volatile int* val)
-{
-    int actual;
-    do {
-        actual = *val;
-    } while (!CAS1(val, actual, actual - 1));
-    return actual;
-}
-*/
-
-static INLINE int INC_ATOMIC(volatile int* val)
-{
-    return atomic_xadd(val, 1);
-}
- 
-static INLINE int DEC_ATOMIC(volatile int* val)
-{
-    return atomic_xadd(val, -1);
-}
- 
-// To be used in lock-free queue
-struct AtomicCounter 
-{
-    union {
-        struct {
-            short fHead;	
-            short fTail;	
-        } scounter;
-        int fValue;
-    } info;
-    
-    INLINE AtomicCounter()
-	{
-        info.fValue = 0;
-    }
-      
- 	INLINE AtomicCounter& operator=(AtomicCounter& obj)
-    {
-        info.fValue = obj.info.fValue;
-        return *this;
-    }
-    
-	INLINE AtomicCounter& operator=(volatile AtomicCounter& obj)
-	{
-        info.fValue = obj.info.fValue;
-        return *this;
-    }
-    
-};
-
 /* use 512KB stack per thread - the default is way too high to be feasible
  * with mlockall() on many systems */
 #define THREAD_STACK 524288
@@ -561,15 +486,9 @@ static void SetRealTime()
     SetThreadToPriority(pthread_self(), 96, true, gPeriod, gComputation, gConstraint);
 }
 
-static void CancelThread(pthread_t fThread)
-{
-    mach_port_t machThread = pthread_mach_thread_np(fThread);
-    thread_terminate(machThread);
-}
-
 static void Yield()
 {
-    //sched_yield();
+    sched_yield();
 }
 
 int get_max_cpu()
@@ -603,25 +522,38 @@ static void SetRealTime()
     pthread_setschedparam(pthread_self(), faust_sched_policy, &faust_rt_param);
 }
 
-static void CancelThread(pthread_t fThread)
-{
-    pthread_cancel(fThread);
-    pthread_join(fThread, NULL);
-}
-
 static void Yield()
 {
-    pthread_yield();
+    sched_yield();
 }
 
-// TODO
 static UInt64 GetMicroSeconds(void)
-{	
-    return 0;
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
 static void get_affinity(pthread_t thread) {}
-static void set_affinity(pthread_t thread, int tag) {}
+
+/*
+    Optional core pinning, enabled like with OpenMP using OMP_PROC_BIND=true (or close/spread),
+    worker threads are then pinned on cores 1 to N-1, the master (audio) thread is not touched.
+*/
+static void set_affinity(pthread_t thread, int tag)
+{
+    const char* bind = getenv("OMP_PROC_BIND");
+    if (!bind || strcasecmp(bind, "false") == 0 || strcasecmp(bind, "master") == 0) {
+        return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(tag % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+    int res = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+    if (res != 0) {
+        printf("Cannot set thread affinity res = %d err = %s\n", res, strerror(res));
+    }
+}
 
 int get_max_cpu()
 {
@@ -680,7 +612,6 @@ class DynThreadAdapter {
         INLINE void StartMeasure()
         {
             if (fDynAdapt) {
-                //fStart = DSP_rdtsc();
                 fStart = GetMicroSeconds();
             }
         }
@@ -691,7 +622,6 @@ class DynThreadAdapter {
                 return;
             }
             
-            //fStop = DSP_rdtsc();
             fStop = GetMicroSeconds();
             fCounter = (fCounter + 1) % KDSPMESURE;
             if (fCounter == 0) {
@@ -726,139 +656,223 @@ class DynThreadAdapter {
         }
 };
 
-#define Value(e) (e).info.fValue
+class TaskQueue;
 
-#define Head(e) (e).info.scounter.fHead
-#define IncHead(e) (e).info.scounter.fHead++
-#define DecHead(e) (e).info.scounter.fHead--
-
-#define Tail(e) (e).info.scounter.fTail
-#define IncTail(e) (e).info.scounter.fTail++
-#define DecTail(e) (e).info.scounter.fTail--
+/*
+    Idle policy of the threads which do not find any task : spin for a while, then yield,
+    and finally park until a task is pushed, or the end of the cycle. Parking can be disabled
+    like with OpenMP using OMP_WAIT_POLICY=active.
+*/
+class ParkingLot
+{
+    private:
+    
+        std::mutex fMutex;
+        std::condition_variable fCond;
+        std::atomic<int> fParked;
+        int fEpoch;             // protected by fMutex
+        bool fCycleRunning;     // protected by fMutex
+        bool fCanPark;
+    
+        INLINE void Notify(bool all)
+        {
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fEpoch++;
+            }
+            if (all) {
+                fCond.notify_all();
+            } else {
+                fCond.notify_one();
+            }
+        }
+    
+    public:
+    
+        ParkingLot():fParked(0), fEpoch(0), fCycleRunning(false)
+        {
+            const char* policy = getenv("OMP_WAIT_POLICY");
+            fCanPark = !(policy && strcasecmp(policy, "active") == 0);
+        }
+    
+        INLINE bool CanPark() { return fCanPark; }
+    
+        // To be called after a task has been pushed
+        INLINE void Unpark()
+        {
+            if (fCanPark) {
+                // Pairs with the fParked increment in Park
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (fParked.load(std::memory_order_relaxed) > 0) {
+                    Notify(false);
+                }
+            }
+        }
+    
+        INLINE void StartCycle()
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fCycleRunning = true;
+        }
+    
+        INLINE void StopCycle()
+        {
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fCycleRunning = false;
+            }
+            Notify(true);
+        }
+    
+        INLINE void Park(TaskQueue* task_queue_list, int num_threads);
+    
+};
 
+/*
+    Chase-Lev work-stealing deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013).
+    The owner thread pushes and pops ready tasks at the head (bottom), other threads steal them at the tail (top).
+    Each task is activated at most once per cycle and the queues are empty at the end of each cycle,
+    so a fixed size circular buffer of at least 'task_queue_size' items is enough.
+*/
 class TaskQueue 
 {
     private:
     
-        int* fTaskList;
-        int fTaskQueueSize;
-        volatile AtomicCounter fCounter;
-        
-        UInt64 fStealingStart;
-        UInt64 fMaxStealing;
+        // Top and bottom on separated cache lines
+        std::atomic<long long> fTop;
+        char fPad1[CACHE_LINE_SIZE];
+        std::atomic<long long> fBottom;
+        char fPad2[CACHE_LINE_SIZE];
+    
+        std::atomic<int>* fTaskList;
+        long long fMask;
+        ParkingLot* fParkingLot;
+    
+        // Only accessed by the owner thread
+        int fIdleCount;
+    
+        INLINE void Idle(TaskQueue* task_queue_list, int cur_thread, int num_threads)
+        {
+            fIdleCount++;
+            if (fIdleCount < SPIN_COUNT) {
+                Pause();
+            } else if (fIdleCount < SPIN_COUNT + YIELD_COUNT
+                       || cur_thread == MASTER_THREAD   // The master (audio) thread is never parked
+                       || !fParkingLot->CanPark()) {
+                Yield();
+            } else {
+                fParkingLot->Park(task_queue_list, num_threads);
+            }
+        }
      
     public:
   
-        INLINE TaskQueue()
+        INLINE TaskQueue():fTop(0), fBottom(0), fTaskList(NULL), fMask(0), fParkingLot(NULL), fIdleCount(0)
         {}
         
-        INLINE void Init(int task_queue_size)
+        INLINE void Init(int task_queue_size, ParkingLot* parking_lot)
         {
-            fTaskQueueSize = task_queue_size;
-            fTaskList = new int[fTaskQueueSize];
-            for (int i = 0; i < fTaskQueueSize; i++) {
-                fTaskList[i] = -1;
+            int size = 1;
+            while (size < task_queue_size) {
+                size <<= 1;
             }
-            fStealingStart = 0;
-             
-            int clock_per_microsec = (getenv("CLOCKSPERSEC") 
-                ? strtoll(getenv("CLOCKSPERSEC"), NULL, 10) 
-                : DEFAULT_CLOCKS_PER_SEC) / 1000000;
-                
-            fMaxStealing = getenv("OMP_STEALING_DUR") 
-                ? strtoll(getenv("OMP_STEALING_DUR"), NULL, 10) * clock_per_microsec 
-                : MAX_STEAL_DUR * clock_per_microsec;
+            fTaskList = new std::atomic<int>[size];
+            for (int i = 0; i < size; i++) {
+                fTaskList[i].store(WORK_STEALING_INDEX, std::memory_order_relaxed);
+            }
+            fMask = size - 1;
+            fParkingLot = parking_lot;
         }
         
         INLINE ~TaskQueue()
         {
             delete[] fTaskList;
         }
-         
+    
         INLINE void InitOne()
         {
-            for (int i = 0; i < fTaskQueueSize; i++) {
-                fTaskList[i] = -1;
-            }
-            fCounter.info.fValue = 0;
-            fStealingStart = 0;
+            fIdleCount = 0;
         }
-        
+    
+        INLINE bool IsEmpty()
+        {
+            return fTop.load(std::memory_order_seq_cst) >= fBottom.load(std::memory_order_seq_cst);
+        }
+    
+        // Owner only (or any thread before the cycle has started)
         INLINE void PushHead(int item)
         {
-            fTaskList[Head(fCounter)] = item;
-            IncHead(fCounter);
+            long long b = fBottom.load(std::memory_order_relaxed);
+            fTaskList[b & fMask].store(item, std::memory_order_relaxed);
+            fBottom.store(b + 1, std::memory_order_release);
+            fParkingLot->Unpark();
         }
-        
+    
+        // Owner only
         INLINE int PopHead()
         {
-            AtomicCounter old_val;
-            AtomicCounter new_val;
-            
-            do {
-                old_val = fCounter;
-                new_val = old_val;
-                if (Head(old_val) == Tail(old_val)) {
-                    return WORK_STEALING_INDEX;
-                } else {
-                    DecHead(new_val);
+            long long b = fBottom.load(std::memory_order_relaxed) - 1;
+            fBottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            long long t = fTop.load(std::memory_order_relaxed);
+            int item = WORK_STEALING_INDEX;
+            if (t <= b) {
+                item = fTaskList[b & fMask].load(std::memory_order_relaxed);
+                if (t == b) {
+                    // Last item, race against thieves
+                    if (!fTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        item = WORK_STEALING_INDEX;
+                    }
+                    fBottom.store(b + 1, std::memory_order_relaxed);
                 }
-            } while (!CAS1(&fCounter, Value(old_val), Value(new_val)));
-            
-            return fTaskList[Head(old_val) - 1];
+            } else {
+                fBottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
         }
-        
+    
+        // Any thread
         INLINE int PopTail()
-        {   
-            AtomicCounter old_val;
-            AtomicCounter new_val;
-
-            do {
-                old_val = fCounter;
-                new_val = old_val;
-                if (Head(old_val) == Tail(old_val)) {
-                    return WORK_STEALING_INDEX;
-                } else {
-                    IncTail(new_val);
+        {
+            long long t = fTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            long long b = fBottom.load(std::memory_order_acquire);
+            if (t < b) {
+                int item = fTaskList[t & fMask].load(std::memory_order_relaxed);
+                if (fTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    return item;
                 }
-            } while (!CAS1(&fCounter, Value(old_val), Value(new_val)));
-
-            return fTaskList[Tail(old_val)];
+            }
+            return WORK_STEALING_INDEX;
         }
-
-		INLINE void MeasureStealingDur()
-		{
-            // Takes first timestamp
-            if (fStealingStart == 0) {
-                fStealingStart = DSP_rdtsc();
-            } else if ((DSP_rdtsc() - fStealingStart) > fMaxStealing) {
-                Yield();
+    
+        static INLINE bool HasTask(TaskQueue* task_queue_list, int num_threads)
+        {
+            for (int i = 0; i < num_threads; i++) {
+                if (!task_queue_list[i].IsEmpty()) {
+                    return true;
+                }
             }
-		}
-
-		INLINE void ResetStealingDur()
-		{
-            fStealingStart = 0;
-		}
+            return false;
+        }
            
         static INLINE int GetNextTask(TaskQueue* task_queue_list, int cur_thread, int num_threads)
         {
-            int tasknum;
-            for (int i = 0; i < num_threads; i++) {
-                if ((tasknum = task_queue_list[i].PopTail()) != WORK_STEALING_INDEX) {
-                #ifdef __linux__
-                    //if (cur_thread != MASTER_THREAD)
-                        task_queue_list[cur_thread].ResetStealingDur();
-                #endif
-                    return tasknum;    // Task is found
-                }
+            TaskQueue& queue = task_queue_list[cur_thread];
+            
+            // First look in our own queue, then steal from the other ones
+            int tasknum = queue.PopHead();
+            for (int i = 1; (i < num_threads) && (tasknum == WORK_STEALING_INDEX); i++) {
+                tasknum = task_queue_list[(cur_thread + i) % num_threads].PopTail();
+            }
+            
+            if (tasknum != WORK_STEALING_INDEX) {
+                queue.fIdleCount = 0;
+                return tasknum;    // Task is found
+            } else {
+                queue.Idle(task_queue_list, cur_thread, num_threads);
+                return WORK_STEALING_INDEX;    // Otherwise will try "workstealing" again next cycle...
             }
-            //NOP();
-        #ifdef __linux__
-			//if (cur_thread != MASTER_THREAD)
-                task_queue_list[cur_thread].MeasureStealingDur();
-        #endif
-            return WORK_STEALING_INDEX;    // Otherwise will try "workstealing" again next cycle...
         }
          
         INLINE void InitTaskList(int task_list_size, int* task_list, int thread_num, int cur_thread)
@@ -888,21 +902,46 @@ class TaskQueue
      
 };
 
+INLINE void ParkingLot::Park(TaskQueue* task_queue_list, int num_threads)
+{
+    std::unique_lock<std::mutex> lock(fMutex);
+    if (!fCycleRunning) {
+        return;
+    }
+    int epoch = fEpoch;
+    fParked.fetch_add(1, std::memory_order_seq_cst);
+    // A task may have been pushed before the pusher could see us parked
+    if (!TaskQueue::HasTask(task_queue_list, num_threads)) {
+        while (fEpoch == epoch) {
+            if (fCond.wait_for(lock, std::chrono::microseconds(MAX_PARK_DUR)) == std::cv_status::timeout) {
+                break;
+            }
+        }
+    }
+    fParked.fetch_sub(1, std::memory_order_relaxed);
+}
+
 class TaskGraph 
 {
     private:
     
-        volatile int* fTaskList;
+        std::atomic<int>* fTaskList;
         int fTaskQueueSize;
+    
+        // Returns true when the last input of 'task' has been computed
+        INLINE bool Activate(int task)
+        {
+            return fTaskList[task].fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
         
     public:
     
         TaskGraph(int task_queue_size)
         {
             fTaskQueueSize = task_queue_size;
-            fTaskList = new int[fTaskQueueSize];
+            fTaskList = new std::atomic<int>[fTaskQueueSize];
             for (int i = 0; i < fTaskQueueSize; i++) {
-                fTaskList[i] = 0;
+                fTaskList[i].store(0, std::memory_order_relaxed);
             } 
         }
         
@@ -913,19 +952,19 @@ class TaskGraph
 
         INLINE void InitTask(int task, int val)
         {
-            fTaskList[task] = val;
+            fTaskList[task].store(val, std::memory_order_relaxed);
         }
         
         void Display()
         {
             for (int i = 0; i < fTaskQueueSize; i++) {
-                printf("Task = %d activation = %d\n", i, fTaskList[i]);
+                printf("Task = %d activation = %d\n", i, fTaskList[i].load());
             } 
         }
           
         INLINE void ActivateOutputTask(TaskQueue& queue, int task, int* tasknum)
         {
-            if (DEC_ATOMIC(&fTaskList[task]) == 0) {
+            if (Activate(task)) {
                 if (*tasknum == WORK_STEALING_INDEX) {
                     *tasknum = task;
                 } else {
@@ -936,14 +975,14 @@ class TaskGraph
           
         INLINE void ActivateOutputTask(TaskQueue& queue, int task)
         {   
-            if (DEC_ATOMIC(&fTaskList[task]) == 0) {
+            if (Activate(task)) {
                 queue.PushHead(task);
             }
         }
          
         INLINE void ActivateOneOutputTask(TaskQueue& queue, int task, int* tasknum)
         {   
-            if (DEC_ATOMIC(&fTaskList[task]) == 0) {
+            if (Activate(task)) {
                 *tasknum = task;
             } else {
                 *tasknum = queue.PopHead(); 
@@ -967,7 +1006,7 @@ class DSPThreadPool {
     
         DSPThread** fThreadPool;
         int fThreadCount; 
-        volatile int fCurThreadCount;
+        std::atomic<int> fCurThreadCount;
       
     public:
         
@@ -982,12 +1021,12 @@ class DSPThreadPool {
         
         void SignalOne()
         {
-            DEC_ATOMIC(&fCurThreadCount);
+            fCurThreadCount.fetch_sub(1, std::memory_order_release);
         }
 
         bool IsFinished()
         {
-            return (fCurThreadCount == 0);
+            return (fCurThreadCount.load(std::memory_order_acquire) == 0);
         }
 
 };
@@ -999,6 +1038,7 @@ class DSPThread {
         pthread_t fThread;
         DSPThreadPool* fThreadPool;
         Semaphore fSemaphore;
+        std::atomic<bool> fRunning;
         bool fRealTime;
         int fNumThread;
         void* fDSP;
@@ -1016,7 +1056,7 @@ class DSPThread {
                 SetRealTime();
             }
                       
-            while (true) {
+            while (thread->fRunning) {
                 thread->Run();
             }
             
@@ -1026,7 +1066,7 @@ class DSPThread {
     public: 
     
         DSPThread(int num_thread, DSPThreadPool* pool, void* dsp)
-            :fThreadPool(pool), fSemaphore(0), fRealTime(false), fNumThread(num_thread), fDSP(dsp) 
+            :fThreadPool(pool), fSemaphore(0), fRunning(false), fRealTime(false), fNumThread(num_thread), fDSP(dsp) 
         {}
 
         virtual ~DSPThread()
@@ -1035,14 +1075,21 @@ class DSPThread {
         void Run()
         {
             fSemaphore.wait();
-            computeThreadExternal(fDSP, fNumThread + 1);
-            //fThreadPool->SignalOne();
+            if (fRunning) {
+                computeThreadExternal(fDSP, fNumThread + 1);
+                fThreadPool->SignalOne();
+            }
         }
                 
         void Signal()
         {
             fSemaphore.post();
         }
+    
+        bool IsRunning()
+        {
+            return fRunning;
+        }
         
         int Start(bool realtime)
         {
@@ -1102,8 +1149,10 @@ class DSPThread {
                 return -1;
             }
             
+            fRunning = true;
             if ((res = pthread_create(&fThread, &attributes, ThreadHandler, this))) {
                 printf("Cannot create thread res = %d err = %s\n", res, strerror(errno));
+                fRunning = false;
                 return -1;
             }
             
@@ -1116,7 +1165,11 @@ class DSPThread {
         
         void Stop()
         {
-            CancelThread(fThread);
+            if (fRunning) {
+                fRunning = false;
+                fSemaphore.post();
+                pthread_join(fThread, NULL);
+            }
         }
 
 };
@@ -1149,7 +1202,10 @@ void DSPThreadPool::StartAll(int num_thread, bool realtime, void* dsp)
     if (fThreadCount == 0) {  // Protection for multiple call...  (like LADSPA plug-ins in Ardour)
         for (int i = 0; i < num_thread; i++) {
             fThreadPool[i] = new DSPThread(i, this, dsp);
-            fThreadPool[i]->Start(realtime);
+            // Fallback to a non real-time thread (when real-time is not allowed)
+            if (fThreadPool[i]->Start(realtime) != 0 && realtime) {
+                fThreadPool[i]->Start(false);
+            }
             fThreadCount++;
         }
     }
@@ -1164,10 +1220,17 @@ void DSPThreadPool::StopAll()
 
 void DSPThreadPool::SignalAll(int num_thread)
 {
-    fCurThreadCount = num_thread;
+    // Threads that could not be started are not waited for, their tasks will be stolen
+    int count = 0;
+    for (int i = 0; i < num_thread && i < fThreadCount; i++) {
+        count += fThreadPool[i]->IsRunning();
+    }
+    fCurThreadCount = count;
      
-    for (int i = 0; i < num_thread; i++) {  // Important : use local num here...
-        fThreadPool[i]->Signal();
+    for (int i = 0; i < num_thread && i < fThreadCount; i++) {  // Important : use local num here...
+        if (fThreadPool[i]->IsRunning()) {
+            fThreadPool[i]->Signal();
+        }
     }
 }
 
@@ -1182,6 +1245,7 @@ class WorkStealingScheduler {
         DSPThreadPool* fThreadPool;
         TaskQueue* fTaskQueueList;
         TaskGraph* fTaskGraph;
+        ParkingLot fParkingLot;
         
         DynThreadAdapter fDynThreadAdapter;
         
@@ -1198,12 +1262,15 @@ class WorkStealingScheduler {
         {
             fStaticNumThreads = get_max_cpu();
             fDynamicNumThreads = getenv("OMP_NUM_THREADS") ? atoi(getenv("OMP_NUM_THREADS")) : fStaticNumThreads;
+            // Like OpenMP, OMP_NUM_THREADS may ask for more threads than cores
+            fDynamicNumThreads = Range(1, 1024, fDynamicNumThreads);
+            fStaticNumThreads = std::max(fStaticNumThreads, fDynamicNumThreads);
             
             fThreadPool = new DSPThreadPool(fStaticNumThreads);
             fTaskGraph = new TaskGraph(task_queue_size);
             fTaskQueueList = new TaskQueue[fStaticNumThreads];
             for (int i = 0; i < fStaticNumThreads; i++) {
-                fTaskQueueList[i].Init(task_queue_size);
+                fTaskQueueList[i].Init(task_queue_size, &fParkingLot);
             }
             
             fReadyTaskListSize = init_task_list_size;
@@ -1238,12 +1305,22 @@ class WorkStealingScheduler {
         {
             GetRealTime();
             fDynThreadAdapter.StartMeasure();
+            fParkingLot.StartCycle();
             fThreadPool->SignalAll(fDynamicNumThreads - 1);
         }
         
         void SyncAll()
         {
-            //while (!fThreadPool->IsFinished()) {}
+            // Wake up parked threads, and wait for all of them to leave computeThread
+            // before the next cycle can touch the task graph and the queues again
+            fParkingLot.StopCycle();
+            for (int i = 0; !fThreadPool->IsFinished(); i++) {
+                if (i < SPIN_COUNT) {
+                    Pause();
+                } else {
+                    Yield();
+                }
+            }
             fDynThreadAdapter.StopMeasure(fStaticNumThreads, fDynamicNumThreads);
         }
         
@@ -1284,8 +1361,9 @@ class WorkStealingScheduler {
         
         void InitTaskList(int cur_thread)
         {
-            TaskQueue::InitAll(fTaskQueueList, fDynamicNumThreads);
             if (cur_thread == -1) {
+                // Called before the cycle starts : queues are all empty, reset the idle state of their threads
+                TaskQueue::InitAll(fTaskQueueList, fDynamicNumThreads);
                 // Dispatch on all WSQ
                 for (int i = 0; i < fDynamicNumThreads; i++) {
                     fTaskQueueList[i].InitTaskList(fReadyTaskListSize, fReadyTaskList, fDynamicNumThreads, i);
@@ -23,14 +23,10 @@
  ************************************************************************/
 
 #include <libgen.h>
+#include <iostream>
 
-#include "faust/audio/coreaudio-dsp.h"
 #include "faust/dsp/dsp-bench.h"
 #include "faust/gui/UI.h"
-#include "faust/dsp/llvm-dsp.h"
-#include "faust/misc.h"
-
-using namespace std;
 #include "faust/misc.h"
 
 using namespace std;
@@ -45,22 +41,14 @@ using namespace std;
 
 int main(int argc, char *argv[])
 {
-    char name[256];
-    char rcfilename[256];
-    char* home = getenv("HOME");
-    snprintf(name, 255, "%s", basename(argv[0]));
-    snprintf(rcfilename, 255, "%s/.%src", home, basename(argv[0]));
-    
-    long srate = (long)lopt(argv, "--frequency", 44100);
-    int	fpb = lopt(argv, "--buffer", 512);
+    int fpb = lopt(argv, "--buffer", 512);
+    double duration = (double)lopt(argv, "--duration", 5);
     
-    measure_dsp* dsp = new measure_dsp(new mydsp(), fpb, 100000, 20);
+    measure_dsp* dsp = new measure_dsp(new mydsp(), fpb, duration, false);
     
-    dsp->init(srate);
-    dsp->openMeasure();
-    dsp->computeAll();
-    dsp->closeMeasure();
-    dsp->printStats(argv[0]);
+    dsp->measure();
+    dsp->printStats(basename(argv[0]));
     
+    delete dsp;
     return 0;
 }
@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+# Compare the throughput of scalar, OpenMP (-omp) and work-stealing scheduler (-sch) code
+# using the console-bench.cpp architecture, on all .dsp files of this folder (or the ones given as parameters).
+#
+# Environment variables:
+#   FAUST       : Faust compiler to use (default: faust)
+#   CXX         : C++ compiler to use (default: g++)
+#   CXXFLAGS    : C++ compiler options (default: -O3 -march=native)
+#   THREADS     : list of number of threads to test -omp and -sch with (default: number of cores)
+#   DURATION    : duration of each measure in seconds (default: 5)
+#
+# Scheduler options (see architecture/scheduler.cpp) can be given the usual way,
+# for instance OMP_PROC_BIND=true to pin worker threads, or OMP_WAIT_POLICY=active to disable parking.
+#
+
+FAUST=${FAUST:-faust}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-O3 -march=native"}
+DURATION=${DURATION:-5}
+if [[ $(uname) == Darwin ]]; then
+    THREADS=${THREADS:-$(sysctl -n hw.physicalcpu)}
+else
+    THREADS=${THREADS:-$(nproc)}
+fi
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ARCHDIR=$HERE/../architecture
+DIR=$(mktemp -d /tmp/sch-bench.XXXXXX)
+DST=results-sch-$(date +%y%m%d.%H%M%S)
+
+if [ $# -eq 0 ]; then
+    set -- "$HERE"/*.dsp
+fi
+
+echo "Faust scalar/omp/sch Benchmark : threads = $THREADS, $CXX $CXXFLAGS" > $DST
+uname -a >> $DST
+date >> $DST
+echo -e "name\tmode\tthreads\tMB/s (best)\tMB/s (25%)\tMB/s (median)\tMB/s (75%)\tMB/s (worst)" >> $DST
+
+# $1 : dsp file, $2 : mode name, $3 : Faust options, $4 : C++ options
+compile()
+{
+    $FAUST $3 -a "$HERE/console-bench.cpp" "$1" -o "$DIR/$2.cpp" 2> /dev/null \
+        && $CXX $CXXFLAGS -std=c++11 -I"$ARCHDIR" "$DIR/$2.cpp" $4 -lpthread -o "$DIR/$2" 2> /dev/null
+}
+
+# $1 : dsp name, $2 : mode name, $3 : number of threads
+run()
+{
+    RES=$(OMP_NUM_THREADS=$3 "$DIR/$2" --duration $DURATION 2> /dev/null | tail -n 1 | cut -f 2-)
+    echo -e "$1\t$2\t$3\t$RES" | tee -a $DST
+}
+
+for f in "$@"; do
+    name=$(basename "$f" .dsp)
+    if ! compile "$f" scal ""; then
+        echo "$name : compilation failed, skipped"
+        continue
+    fi
+    run $name scal 1
+    if compile "$f" omp "-omp" "-fopenmp"; then
+        for n in $THREADS; do
+            run $name omp $n
+        done
+    fi
+    if compile "$f" sch "-sch"; then
+        for n in $THREADS; do
+            run $name sch $n
+        done
+    fi
+done
+
+rm -rf "$DIR"
+echo "Results written in $DST"
@@ -52,15 +52,16 @@ static int computeBoxComplexity(Tree box);
  */
 int boxComplexity(Tree box)
 {
-    Tree prop = box->getProperty(gGlobal->BCOMPLEXITY);
+    PropertyValue* prop = box->getValueProperty(gGlobal->BCOMPLEXITY);
 
     if (prop) {
-        return tree2int(prop);
+        return prop->fInt;
 
     } else {
-        int v = computeBoxComplexity(box);
-        box->setProperty(gGlobal->BCOMPLEXITY, tree(v));
-        return v;
+        PropertyValue v;
+        v.fInt = computeBoxComplexity(box);
+        box->setValueProperty(gGlobal->BCOMPLEXITY, v);
+        return v.fInt;
     }
 }
 
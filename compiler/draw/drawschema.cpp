@@ -304,7 +304,7 @@ static char* legalFileName(Tree t, int n, char* dst)
  * isInverter(t) returns true if t == '*(-1)'. This test is used
  * to simplify diagram by using a special symbol for inverters.
  */
-Tree gInverter[6];
+thread_local Tree gInverter[6];  // trees of the compilation running in the current thread
 
 static bool isInverter(Tree t)
 {
@@ -29,7 +29,8 @@
 #include <iostream>
 using namespace std;
 
-const char* yyfilename = "????";
+// Name of the file being parsed or evaluated by the compilation running in the current thread
+thread_local const char* yyfilename = "????";
 
 void faustassertaux(bool cond, const string& file, int line)
 {
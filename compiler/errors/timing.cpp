@@ -22,21 +22,61 @@
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <iomanip>
 #include <sstream>
+#include <vector>
 #ifndef _WIN32
+#include <sys/resource.h>
 #include <sys/time.h>
 #endif
 #include "Text.hh"
 #include "compatibility.hh"
+#include "exception.hh"
+#include "export.hh"
 #include "global.hh"
 #include "timing.hh"
 
-// Timing can be used outside of the scope of 'gGlobal'
-bool     gTimingSwitch;
-int      gTimingIndex;
-double   gStartTime[1024];
-double   gEndTime[1024];
-ostream* gTimingLog = 0;
+// Timing stack is per thread, since backend work (like LLVM JIT compilation) may run concurrently
+thread_local int      gTimingIndex;
+thread_local double   gStartTime[1024];
+thread_local double   gEndTime[1024];
+thread_local ostream* gTimingLog = 0;
+thread_local size_t   gStartTrees[1024];
+
+struct TimingPhase {
+    string fName;
+    int    fDepth;
+    double fStart;
+    double fDuration;
+    size_t fTrees;    // number of trees created during the phase
+    long   fPeakRSS;  // peak resident set size at the end of the phase (in KB)
+};
+
+// Timing can be used outside of the scope of 'gGlobal' : the options and measured phases of a compilation
+// are used by the thread calling the API and by the compilation thread, one after the other
+struct TimingContext {
+    bool                fSwitch   = false;  // -time : trace and text report
+    string              fJSONFile;          // -time-json : JSON report
+    bool                fRecord   = false;  // phases are recorded by one of the two options
+    bool                fDeferred = false;  // set by a backend writing the reports itself (see deferTimingReports)
+    vector<TimingPhase> fPhases;
+    string              fTreeStats[2];   // hash table statistics (text and JSON) kept by keepTimingStats
+    string              fArenaStats[2];  // arena statistics (text and JSON) kept by keepTimingStats
+};
+
+static thread_local TimingContext  gThreadTimingContext;
+static thread_local TimingContext* gTimingContext = nullptr;
+
+TimingContext* getTimingContext()
+{
+    return (gTimingContext) ? gTimingContext : &gThreadTimingContext;
+}
+
+void setTimingContext(TimingContext* context)
+{
+    gTimingContext = context;
+}
 
 #ifndef _WIN32
 double mysecond()
@@ -47,11 +87,27 @@ double mysecond()
     return ((double)tp.tv_sec + (double)tp.tv_usec * 1.e-6);
 }
 
+static long peakRSS()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return long(usage.ru_maxrss / 1024);  // in bytes on macOS
+#else
+    return long(usage.ru_maxrss);
+#endif
+}
+
 #else
 double mysecond()
 {
     return 0;
 }
+
+static long peakRSS()
+{
+    return 0;
+}
 #endif
 
 void startTiming(const char* msg)
@@ -62,31 +118,172 @@ void startTiming(const char* msg)
         *gTimingLog << endl;
     }
 
-    if (gTimingSwitch) {
+    TimingContext* context = getTimingContext();
+    if (context->fRecord) {
         faustassert(gTimingIndex < 1023);
         if (gTimingLog) {
             tab(gTimingIndex, *gTimingLog);
             *gTimingLog << "start " << msg << endl;
-        } else {
+        } else if (context->fSwitch) {
             tab(gTimingIndex, cerr);
             cerr << "start " << msg << endl;
         }
+        gStartTrees[gTimingIndex]  = CTree::serialCounter();
         gStartTime[gTimingIndex++] = mysecond();
     }
 }
 
 void endTiming(const char* msg)
 {
-    if (gTimingSwitch) {
+    TimingContext* context = getTimingContext();
+    if (context->fRecord) {
         faustassert(gTimingIndex > 0);
         gEndTime[--gTimingIndex] = mysecond();
         if (gTimingLog) {
             *gTimingLog << msg << "\t" << gEndTime[gTimingIndex] - gStartTime[gTimingIndex] << endl;
             gTimingLog->flush();
-        } else {
+        } else if (context->fSwitch) {
             tab(gTimingIndex, cerr);
             cerr << "end " << msg << " (duration : " << gEndTime[gTimingIndex] - gStartTime[gTimingIndex] << ")"
                  << endl;
         }
+        TimingPhase phase = {msg,
+                             gTimingIndex,
+                             gStartTime[gTimingIndex],
+                             gEndTime[gTimingIndex] - gStartTime[gTimingIndex],
+                             CTree::serialCounter() - gStartTrees[gTimingIndex],
+                             peakRSS()};
+        context->fPhases.push_back(phase);
+    }
+}
+
+void resetTimingReport()
+{
+    TimingContext* context = getTimingContext();
+    context->fPhases.clear();
+    context->fSwitch   = false;
+    context->fJSONFile = "";
+    context->fRecord   = false;
+    for (int i = 0; i < 2; i++) {
+        context->fTreeStats[i]  = "";
+        context->fArenaStats[i] = "";
+    }
+}
+
+void setTimingTrace()
+{
+    TimingContext* context = getTimingContext();
+    context->fSwitch       = true;
+    context->fRecord       = true;
+}
+
+void setTimingJSONFile(const string& filename)
+{
+    TimingContext* context = getTimingContext();
+    context->fJSONFile     = filename;
+    context->fRecord       = true;
+}
+
+void deferTimingReports(bool defer)
+{
+    getTimingContext()->fDeferred = defer;
+}
+
+bool isTimingReportDeferred()
+{
+    return getTimingContext()->fDeferred;
+}
+
+void keepTimingStats()
+{
+    TimingContext* context = getTimingContext();
+    if (context->fRecord) {
+        for (int i = 0; i < 2; i++) {
+            stringstream tree_stats, arena_stats;
+            CTree::printStats(tree_stats, i == 1);
+            Garbageable::printStats(arena_stats, i == 1);
+            context->fTreeStats[i]  = tree_stats.str();
+            context->fArenaStats[i] = arena_stats.str();
+        }
+    }
+}
+
+// Statistics of the running compilation, or the ones kept at its end
+static void printStats(ostream& out, bool json)
+{
+    TimingContext* context = getTimingContext();
+    if (gGlobal) {
+        CTree::printStats(out, json);
+        if (json) out << "," << endl << "  \"arena\": ";
+        Garbageable::printStats(out, json);
+    } else {
+        out << context->fTreeStats[json];
+        if (json) out << "," << endl << "  \"arena\": ";
+        out << context->fArenaStats[json];
+    }
+}
+
+// Phases are recorded when they end : sort them back in starting order
+static vector<TimingPhase> sortedPhases()
+{
+    vector<TimingPhase> phases = getTimingContext()->fPhases;
+    stable_sort(phases.begin(), phases.end(),
+                [](const TimingPhase& a, const TimingPhase& b) { return a.fStart < b.fStart; });
+    return phases;
+}
+
+void printTimingReport(ostream& out)
+{
+    streamsize precision = out.precision();
+    out << "Compilation phases :" << endl;
+    out << left << setw(40) << "phase" << right << setw(12) << "time (ms)" << setw(12) << "trees" << setw(16)
+        << "peak RSS (KB)" << endl;
+    for (const auto& phase : sortedPhases()) {
+        out << left << setw(40) << (string(2 * phase.fDepth, ' ') + phase.fName) << right << setw(12) << fixed
+            << setprecision(3) << phase.fDuration * 1000. << setw(12) << phase.fTrees << setw(16) << phase.fPeakRSS
+            << endl;
+    }
+    out.unsetf(ios::floatfield);
+    out.precision(precision);
+    out << "Peak RSS : " << peakRSS() << " KB" << endl;
+    printStats(out, false);
+}
+
+void printTimingReportJSON(ostream& out)
+{
+    out << "{" << endl;
+    out << "  \"version\": \"" << FAUSTVERSION << "\"," << endl;
+    out << "  \"phases\": [";
+    string sep = "";
+    for (const auto& phase : sortedPhases()) {
+        out << sep << endl
+            << "    { \"name\": \"" << phase.fName << "\", \"depth\": " << phase.fDepth
+            << ", \"time\": " << phase.fDuration << ", \"trees\": " << phase.fTrees
+            << ", \"peak_rss\": " << phase.fPeakRSS << " }";
+        sep = ",";
+    }
+    out << endl << "  ]," << endl;
+    out << "  \"peak_rss\": " << peakRSS() << "," << endl;
+    out << "  \"hash_table\": ";
+    printStats(out, true);
+    out << endl << "}" << endl;
+}
+
+void writeTimingReports()
+{
+    TimingContext* context = getTimingContext();
+    if (context->fSwitch) {
+        printTimingReport(cerr);
+    }
+    if (context->fJSONFile != "") {
+        ofstream json(context->fJSONFile.c_str());
+        if (json.is_open()) {
+            printTimingReportJSON(json);
+        }
+        if (!json.is_open() || !json.good()) {
+            stringstream error;
+            error << "ERROR : cannot write the compilation time report in '" << context->fJSONFile << "'" << endl;
+            throw faustexception(error.str());
+        }
     }
 }
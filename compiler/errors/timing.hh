@@ -22,10 +22,35 @@
 #ifndef __TIMING__
 #define __TIMING__
 
+#include <ostream>
+#include <string>
+
 // use startTiming("foo") and endTiming("foo") to measure the execution time of a portion of code
 // edit timing.cpp de unactivate the code
 
 void startTiming(const char* msg);
 void endTiming(const char* msg);
 
+// Report of all phases measured since the last reset : duration, created trees and peak RSS,
+// followed by the tree hash table and memory arena statistics.
+// '-time' traces the phases and prints the report on stderr, '-time-json <file>' only writes it in JSON.
+void resetTimingReport();  // to be called at the beginning of each compilation, also disables the options
+void setTimingTrace();
+void setTimingJSONFile(const std::string& filename);
+void printTimingReport(std::ostream& out);
+void printTimingReportJSON(std::ostream& out);
+void writeTimingReports();  // raises a faustexception if the JSON file cannot be written
+
+// A backend doing timed work after the compilation (like the LLVM JIT) defers the reports,
+// then calls writeTimingReports itself (only concerns the calling thread)
+void deferTimingReports(bool defer);
+bool isTimingReportDeferred();
+void keepTimingStats();  // keeps the hash table and arena statistics before the compiler state is destroyed
+
+// Options and phases are kept in the timing context of the thread calling the API,
+// which is shared with the thread running the compilation
+struct TimingContext;
+TimingContext* getTimingContext();
+void           setTimingContext(TimingContext* context);
+
 #endif
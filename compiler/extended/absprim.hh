@@ -43,6 +43,13 @@ class AbsPrim : public xtended {
         return t;
     }
 
+    virtual int getIdentityArg(const vector<::Type>& types)
+    {
+        faustassert(types.size() == arity());
+        interval i = types[0]->getInterval();
+        return isAlwaysLE(interval(0), i) ? 0 : -1;
+    }
+
     virtual void sigVisit(Tree sig, sigvisitor* visitor) {}
 
     virtual int infereSigOrder(const vector<int>& args)
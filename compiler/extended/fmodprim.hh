@@ -47,6 +47,12 @@ class FmodPrim : public xtended {
         return castInterval(floatCast(args[0] | args[1]), fmod(i, j));
     }
 
+    virtual int getIdentityArg(const vector<::Type>& types)
+    {
+        faustassert(types.size() == arity());
+        return isRemIdentity(types[0]->getInterval(), types[1]->getInterval()) ? 0 : -1;
+    }
+
     virtual void sigVisit(Tree sig, sigvisitor* visitor) {}
 
     virtual int infereSigOrder(const vector<int>& args)
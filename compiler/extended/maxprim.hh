@@ -42,6 +42,16 @@ class MaxPrim : public xtended {
         return castInterval(types[0] | types[1], max(i, j));
     }
 
+    virtual int getIdentityArg(const vector<::Type>& types)
+    {
+        faustassert(types.size() == arity());
+        interval i = types[0]->getInterval();
+        interval j = types[1]->getInterval();
+        if (isAlwaysLE(j, i)) return 0;
+        if (isAlwaysLE(i, j)) return 1;
+        return -1;
+    }
+
     virtual void sigVisit(Tree sig, sigvisitor* visitor) {}
 
     virtual int infereSigOrder(const vector<int>& args)
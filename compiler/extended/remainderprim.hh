@@ -40,6 +40,17 @@ class RemainderPrim : public xtended {
         return castInterval(floatCast(args[0] | args[1]), interval());  // temporary rule !!!
     }
 
+    virtual int getIdentityArg(const vector<::Type>& types)
+    {
+        faustassert(types.size() == arity());
+        interval i = types[0]->getInterval();
+        interval j = types[1]->getInterval();
+        // remainder(x, y) is x when |x| < y/2 (with the same margin as isRemIdentity)
+        return (i.valid && j.valid && (j.lo > 0) && (max(fabs(i.lo), fabs(i.hi)) * (1 + INTERVAL_MARGIN) < j.lo / 2))
+                   ? 0
+                   : -1;
+    }
+
     virtual void sigVisit(Tree sig, sigvisitor* visitor) {}
 
     virtual int infereSigOrder(const vector<int>& args)
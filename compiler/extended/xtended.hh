@@ -74,6 +74,11 @@ class xtended : public virtual Garbageable {
         return false;
     }  ///< generally false, but true for binary op # such that #(x) == _#x
 
+    virtual int getIdentityArg(const vector< ::Type>& types)
+    {
+        return -1;
+    }  ///< index of the argument always returned given the arguments intervals, or -1 (used to remove useless clamps)
+
     void prepareTypeArgsResult(::Type result, const list<ValueInst*>& args, vector<::Type> const& types,
                                Typed::VarType& result_type, vector<Typed::VarType>& arg_types,
                                list<ValueInst*>& casted_args);
@@ -24,6 +24,8 @@
 
 #include <stdio.h>
 #include <new>
+#include <ostream>
+#include <vector>
 
 #include "exception.hh"
 
@@ -40,6 +42,46 @@ class Garbageable {
     void  operator delete[](void* ptr);
 
     static void cleanup();
+    static void printStats(std::ostream& fout, bool json = false);
+};
+
+/*
+ Memory used by Garbageable objects : objects are allocated in big pages with a bump pointer,
+ and all pages are released together by Garbageable::cleanup at the end of a compilation.
+ Big objects are directly allocated with malloc.
+*/
+
+class GarbageableArena {
+   public:
+    static const size_t kPageSize      = 256 * 1024;
+    static const size_t kMaxObjectSize = kPageSize / 8;
+
+   private:
+    std::vector<char*> fPages;      // allocated pages
+    char*              fCurrent;    // first free byte in the current page
+    size_t             fRemaining;  // free bytes in the current page
+    void*              fFreeBlocks[kMaxObjectSize / 16 + 1];  // blocks given back during the compilation, by size
+
+    // Statistics for the current compilation
+    size_t fObjects;       // number of allocated objects
+    size_t fBytes;         // number of allocated bytes
+    size_t fReused;        // number of allocations served by a block given back
+    size_t fBigObjects;    // number of objects allocated with malloc
+    size_t fBigBytes;      // number of bytes allocated with malloc
+
+   public:
+    GarbageableArena() : fCurrent(nullptr), fRemaining(0), fObjects(0), fBytes(0), fReused(0), fBigObjects(0), fBigBytes(0)
+    {
+        for (size_t i = 0; i <= kMaxObjectSize / 16; i++) fFreeBlocks[i] = nullptr;
+    }
+    ~GarbageableArena() { release(); }
+
+    // 'size' is a multiple of 16
+    void* allocate(size_t size);
+    void  deallocate(void* ptr, size_t size);
+    void  release();
+
+    void printStats(std::ostream& fout, bool json = false);
 };
 
 template <class P>
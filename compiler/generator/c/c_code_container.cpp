@@ -28,7 +28,7 @@
 
 using namespace std;
 
-map<string, bool> CInstVisitor::gFunctionSymbolTable;
+thread_local map<string, bool> CInstVisitor::gFunctionSymbolTable;
 
 dsp_factory_base* CCodeContainer::produceFactory()
 {
@@ -157,6 +157,7 @@ void CCodeContainer::produceClass()
     // Libraries
     printLibrary(*fOut);
     printIncludeFile(*fOut);
+    printExpectMacro(*fOut);
 
     // Sub containers
     generateSubContainers();
@@ -381,6 +382,7 @@ void CScalarOneSampleCodeContainer::produceClass()
     // Libraries
     printLibrary(*fOut);
     printIncludeFile(*fOut);
+    printExpectMacro(*fOut);
     
     // Sub containers
     mergeSubContainers();
@@ -35,7 +35,7 @@ class CInstVisitor : public TextInstVisitor {
      Global functions names table as a static variable in the visitor
      so that each function prototype is generated as most once in the module.
      */
-    static map<string, bool> gFunctionSymbolTable;
+    static thread_local map<string, bool> gFunctionSymbolTable;
 
    public:
     using TextInstVisitor::visit;
@@ -326,6 +326,9 @@ class CInstVisitor : public TextInstVisitor {
         *fOut << ")";
     }
 
+    // Branch hint given by the runtime profile (-pgo)
+    virtual void visit(Select2Inst* inst) { visitExpect(inst); }
+
     virtual void visit(ForLoopInst* inst)
     {
         // Don't generate empty loops...
@@ -28,6 +28,7 @@
 #include "global.hh"
 #include "recursivness.hh"
 #include "text_instructions.hh"
+#include "timing.hh"
 #include "type_manager.hh"
 
 using namespace std;
@@ -212,6 +213,23 @@ void CodeContainer::printIncludeFile(ostream& fout)
     }
 }
 
+/**
+ * Print the FAUST_EXPECT macro used by the C/C++ backends for the selects
+ * having a dominant condition value in the runtime profile (-pgo)
+ */
+void CodeContainer::printExpectMacro(ostream& fout)
+{
+    if (gGlobal->gProfile) {
+        fout << "#ifndef FAUST_EXPECT" << endl;
+        fout << "#if defined(__GNUC__)" << endl;
+        fout << "#define FAUST_EXPECT(cond, val) __builtin_expect(!!(cond), val)" << endl;
+        fout << "#else" << endl;
+        fout << "#define FAUST_EXPECT(cond, val) (cond)" << endl;
+        fout << "#endif" << endl;
+        fout << "#endif" << endl;
+    }
+}
+
 /**
  * Print the loop graph in dot format
  */
@@ -376,10 +394,17 @@ void CodeContainer::processFIR(void)
     generateSR();
 
     // Possibly groups tasks (used by VectorCodeContainer, OpenMPCodeContainer and WSSCodeContainer)
-    if (gGlobal->gGroupTaskSwitch) {
+    if ((gGlobal->gSchedulerSwitch || gGlobal->gOpenMPSwitch) && gGlobal->gTaskGranularity > 0) {
+        // Cost driven grouping, also groups sequential tasks like -g
+        startTiming("groupTasks");
+        CodeLoop::groupTasks(fCurLoop, gGlobal->gTaskGranularity);
+        endTiming("groupTasks");
+    } else if (gGlobal->gGroupTaskSwitch) {
+        startTiming("groupSeqLoops");
         CodeLoop::computeUseCount(fCurLoop);
         set<CodeLoop*> visited;
         CodeLoop::groupSeqLoops(fCurLoop, visited);
+        endTiming("groupSeqLoops");
     }
 
     // Sort struct fields by size and type
@@ -431,6 +456,8 @@ BlockInst* CodeContainer::flattenFIR(void)
 
 BlockInst* CodeContainer::inlineSubcontainersFunCalls(BlockInst* block)
 {
+    startTiming("inlineSubcontainersFunCalls");
+
     // Rename 'sig' in 'dsp' and remove 'dsp' allocation
     block = DspRenamer().getCode(block);
 
@@ -448,6 +475,7 @@ BlockInst* CodeContainer::inlineSubcontainersFunCalls(BlockInst* block)
     }
 
     // dump2FIR(block);
+    endTiming("inlineSubcontainersFunCalls");
     return block;
 }
 
@@ -221,6 +221,7 @@ class CodeContainer : public virtual Garbageable {
 
     void printLibrary(ostream& fout);
     void printIncludeFile(ostream& fout);
+    void printExpectMacro(ostream& fout);
 
     void setLoopProperty(Tree sig, CodeLoop* l);   ///< Store the loop used to compute a signal
     bool getLoopProperty(Tree sig, CodeLoop*& l);  ///< Returns the loop used to compute a signal
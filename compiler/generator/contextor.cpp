@@ -32,5 +32,5 @@
 
 // define the static members of context
 
-int contextor::top = 0;
-int contextor::pile[1024];
+thread_local int contextor::top = 0;
+thread_local int contextor::pile[1024];
@@ -29,7 +29,7 @@
 
 using namespace std;
 
-map<string, bool> CPPInstVisitor::gFunctionSymbolTable;
+thread_local map<string, bool> CPPInstVisitor::gFunctionSymbolTable;
 
 dsp_factory_base* CPPCodeContainer::produceFactory()
 {
@@ -142,6 +142,86 @@ void CPPCodeContainer::produceInit(int tabs)
     *fOut << "}";
 }
 
+// Target specific versions of 'compute' generated with -mv, from the most to the least capable one
+static const char* gComputeVersions[][2] = {{"AVX512F", "avx512f"}, {"AVX2", "avx2,fma"}};
+
+string CPPCodeContainer::getComputeDeclaration()
+{
+    if (fComputeVersion == "") {
+        return subst("virtual void compute(int $0, $1** inputs, $1** outputs) {", fFullCount, xfloat());
+    } else if (fComputeTarget == "") {
+        return subst("void compute$0(int $1, $2** inputs, $2** outputs) {", fComputeVersion, fFullCount, xfloat());
+    } else {
+        return subst("__attribute__((target(\"$0\"))) void compute$1(int $2, $3** inputs, $3** outputs) {",
+                     fComputeTarget, fComputeVersion, fFullCount, xfloat());
+    }
+}
+
+void CPPCodeContainer::produceCompute(int n)
+{
+    if (!gGlobal->gMultiVersion) {
+        generateCompute(n);
+        return;
+    }
+
+    // The same FIR code is generated once per target, the default version being compiled for the baseline ISA
+    tab(0, *fOut);
+    *fOut << "#ifdef FAUST_CPU_DISPATCH";
+    for (const auto& version : gComputeVersions) {
+        fComputeVersion = version[0];
+        fComputeTarget  = version[1];
+        generateCompute(n);
+    }
+    tab(0, *fOut);
+    *fOut << "#endif";
+    fComputeVersion = "Default";
+    fComputeTarget  = "";
+    generateCompute(n);
+    fComputeVersion = "";
+
+    // 'compute' calls the version chosen in 'classInit'
+    tab(n + 1, *fOut);
+    tab(n + 1, *fOut);
+    *fOut << subst("virtual void compute(int $0, $1** inputs, $1** outputs) {", fFullCount, xfloat());
+    tab(n + 2, *fOut);
+    *fOut << "(this->*fComputeFun)(" << fFullCount << ", inputs, outputs);";
+    tab(n + 1, *fOut);
+    *fOut << "}";
+}
+
+void CPPCodeContainer::produceComputeDispatch(int n)
+{
+    // Choose the 'compute' version using the CPU features
+    tab(0, *fOut);
+    *fOut << "#ifdef FAUST_CPU_DISPATCH";
+    tab(n, *fOut);
+    *fOut << "__builtin_cpu_init();";
+    for (const auto& version : gComputeVersions) {
+        tab(n, *fOut);
+        if (&version != &gComputeVersions[0]) *fOut << "} else ";
+        *fOut << "if (";
+        stringstream features(version[1]);
+        string       feature;
+        bool         first = true;
+        while (getline(features, feature, ',')) {
+            *fOut << ((first) ? "" : " && ") << "__builtin_cpu_supports(\"" << feature << "\")";
+            first = false;
+        }
+        *fOut << ") {";
+        tab(n + 1, *fOut);
+        *fOut << "fComputeFun = &" << fKlassName << "::compute" << version[0] << ";";
+    }
+    tab(n, *fOut);
+    *fOut << "} else {";
+    tab(n + 1, *fOut);
+    *fOut << "fComputeFun = &" << fKlassName << "::computeDefault;";
+    tab(n, *fOut);
+    *fOut << "}";
+    tab(0, *fOut);
+    *fOut << "#endif";
+    tab(n, *fOut);
+}
+
 void CPPCodeContainer::produceInternal()
 {
     int n = 0;
@@ -249,6 +329,7 @@ void CPPCodeContainer::produceClass()
     // Libraries
     printLibrary(*fOut);
     printIncludeFile(*fOut);
+    printExpectMacro(*fOut);
     
     if (gGlobal->gNameSpace != "" && gGlobal->gArchFile == "") {
         tab(n, *fOut);
@@ -274,6 +355,15 @@ void CPPCodeContainer::produceClass()
     *fOut << "#define exp10 __exp10" << endl;
     *fOut << "#endif" << endl;
     
+    if (gGlobal->gMultiVersion) {
+        // Target specific 'compute' versions need GCC/clang on x86
+        tab(n, *fOut);
+        *fOut << "#if !defined(FAUST_CPU_DISPATCH) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))"
+              << endl;
+        *fOut << "#define FAUST_CPU_DISPATCH 1" << endl;
+        *fOut << "#endif" << endl;
+    }
+    
     tab(n, *fOut);
     *fOut << "class " << fKlassName << " : public " << fSuperKlassName << " {";
     
@@ -323,6 +413,13 @@ void CPPCodeContainer::produceClass()
         *fOut << "static dsp_memory_manager* fManager;";
     }
 
+    if (gGlobal->gMultiVersion) {
+        tab(n + 1, *fOut);
+        *fOut << subst("typedef void ($0::*computeFun)(int, $1**, $1**);", fKlassName, xfloat());
+        tab(n + 1, *fOut);
+        *fOut << "static computeFun fComputeFun;";
+    }
+
     // Print metadata declaration
     tab(n + 1, *fOut);
     produceMetadata(n + 1);
@@ -360,6 +457,9 @@ void CPPCodeContainer::produceClass()
     tab(n + 2, *fOut);
     fCodeProducer.Tab(n + 2);
     generateStaticInit(&fCodeProducer);
+    if (gGlobal->gMultiVersion) {
+        produceComputeDispatch(n + 2);
+    }
     back(1, *fOut);
     *fOut << "}";
 
@@ -486,7 +586,7 @@ void CPPCodeContainer::produceClass()
     *fOut << "}";
 
     // Compute
-    generateCompute(n);
+    produceCompute(n);
     tab(n, *fOut);
     tab(n, *fOut);
     *fOut << "};" << endl;
@@ -496,6 +596,11 @@ void CPPCodeContainer::produceClass()
         tab(n, *fOut);
         *fOut << "dsp_memory_manager* " << fKlassName << "::fManager = 0;" << endl;
     }
+    if (gGlobal->gMultiVersion) {
+        tab(n, *fOut);
+        *fOut << fKlassName << "::computeFun " << fKlassName << "::fComputeFun = &" << fKlassName
+              << "::computeDefault;" << endl;
+    }
 
     // Generate user interface macros if needed
     printMacros(*fOut, n);
@@ -519,7 +624,7 @@ void CPPScalarCodeContainer::generateCompute(int n)
     // Generates declaration
     tab(n + 1, *fOut);
     tab(n + 1, *fOut);
-    *fOut << subst("virtual void compute(int $0, $1** inputs, $1** outputs) {", fFullCount, xfloat());
+    *fOut << getComputeDeclaration();
     tab(n + 2, *fOut);
     fCodeProducer.Tab(n + 2);
 
@@ -572,6 +677,7 @@ void CPPScalarOneSampleCodeContainer::produceClass()
     // Libraries
     printLibrary(*fOut);
     printIncludeFile(*fOut);
+    printExpectMacro(*fOut);
     
     if (gGlobal->gNameSpace != "" && gGlobal->gArchFile == "") {
         tab(n, *fOut);
@@ -801,7 +907,7 @@ void CPPVectorCodeContainer::generateCompute(int n)
 
     // Generates declaration
     tab(n + 1, *fOut);
-    *fOut << subst("virtual void compute(int $0, $1** inputs, $1** outputs) {", fFullCount, xfloat());
+    *fOut << getComputeDeclaration();
     tab(n + 2, *fOut);
     fCodeProducer.Tab(n + 2);
 
@@ -831,7 +937,7 @@ void CPPOpenMPCodeContainer::generateCompute(int n)
 
     // Generates declaration
     tab(n + 1, *fOut);
-    *fOut << subst("virtual void compute(int $0, $1** inputs, $1** outputs) {", fFullCount, xfloat());
+    *fOut << getComputeDeclaration();
     tab(n + 2, *fOut);
     fCodeProducer.Tab(n + 2);
 
@@ -876,7 +982,7 @@ void CPPWorkStealingCodeContainer::generateCompute(int n)
 
     // Generates declaration
     tab(n + 1, *fOut);
-    *fOut << subst("virtual void compute(int $0, $1** inputs, $1** outputs) {", fFullCount, xfloat());
+    *fOut << getComputeDeclaration();
     tab(n + 2, *fOut);
     fCodeProducer.Tab(n + 2);
 
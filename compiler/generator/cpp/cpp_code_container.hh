@@ -42,8 +42,16 @@ class CPPCodeContainer : public virtual CodeContainer {
     std::ostream*  fOut;
     string         fSuperKlassName;
 
+    // 'compute' version being generated with -mv ("" for the single 'compute' method)
+    string fComputeVersion;
+    string fComputeTarget;
+
     void produceMetadata(int tabs);
     void produceInit(int tabs);
+    void produceCompute(int tabs);
+    void produceComputeDispatch(int tabs);
+
+    string getComputeDeclaration();
 
    public:
     CPPCodeContainer(const string& name, const string& super, int numInputs, int numOutputs, std::ostream* out)
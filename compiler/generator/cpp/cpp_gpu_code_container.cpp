@@ -132,6 +132,7 @@ void CPPOpenCLCodeContainer::produceClass()
     // Libraries
     printLibrary(*fOut);
     printIncludeFile(*fOut);
+    printExpectMacro(*fOut);
 
     // Sub containers
     generateSubContainers();
@@ -1257,6 +1258,7 @@ void CPPCUDACodeContainer::produceClass()
     // Libraries
     printLibrary(*fOut);
     printIncludeFile(*fOut);
+    printExpectMacro(*fOut);
 
     // Sub containers
     generateSubContainers();
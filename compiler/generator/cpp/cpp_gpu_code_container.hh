@@ -145,6 +145,9 @@ class CPPGPUCodeContainer : public CPPCodeContainer {
         map<string, string> fFunctionTable;
         KernelInstVisitor(std::ostream* out, int tab) : CPPInstVisitor(out, tab) {}
 
+        // Kernels are compiled separately, without the FAUST_EXPECT macro
+        virtual void visit(Select2Inst* inst) { TextInstVisitor::visit(inst); }
+
         virtual void visit(LoadVarInst* inst)
         {
             NamedAddress*   named   = dynamic_cast<NamedAddress*>(inst->fAddress);
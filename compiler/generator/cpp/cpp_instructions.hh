@@ -33,7 +33,7 @@ class CPPInstVisitor : public TextInstVisitor {
      Global functions names table as a static variable in the visitor
      so that each function prototype is generated at most once in the module.
      */
-    static map<string, bool> gFunctionSymbolTable;
+    static thread_local map<string, bool> gFunctionSymbolTable;
 
     // Polymorphic math functions
     map<string, string> gPolyMathLibTable;
@@ -409,6 +409,9 @@ class CPPInstVisitor : public TextInstVisitor {
         }
     }
 
+    // Branch hint given by the runtime profile (-pgo)
+    virtual void visit(Select2Inst* inst) { visitExpect(inst); }
+
     virtual void visit(ForLoopInst* inst)
     {
         // Don't generate empty loops...
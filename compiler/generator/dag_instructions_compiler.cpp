@@ -127,7 +127,9 @@ void DAGInstructionsCompiler::compileMultiSignal(Tree L)
     }
 
     // Apply FIR to FIR transformations
+    startTiming("processFIR");
     fContainer->processFIR();
+    endTiming("processFIR");
 
     // Generate JSON
     if (gGlobal->gPrintJSONSwitch) {
@@ -331,12 +333,10 @@ ValueInst* DAGInstructionsCompiler::generateCacheCode(Tree sig, ValueInst* exp)
                     // return subst("$0[i]", vname);
                     return InstBuilder::genLoadArrayVar(vname, var_access, getCurrentLoopIndex());
                 } else {
-                    // we use a ring buffer
+                    // we use a block buffer
                     string vname_idx = vname + "_idx";
-                    int    mask      = pow2limit(d + gGlobal->gVecSize) - 1;
-                    // return subst("$0[($0_idx+i) & $1]", vname, mask);
-                    FIRIndex index1 = (getCurrentLoopIndex() + InstBuilder::genLoadStructVar(vname_idx)) &
-                                      InstBuilder::genInt32NumInst(mask);
+                    // return subst("$0[$0_idx+i]", vname);
+                    FIRIndex index1 = getCurrentLoopIndex() + InstBuilder::genLoadStructVar(vname_idx);
                     return InstBuilder::genLoadArrayStructVar(vname, index1);
                 }
             }
@@ -469,33 +469,29 @@ ValueInst* DAGInstructionsCompiler::generateFixDelay(Tree sig, Tree exp, Tree de
             }
         } else {
             // return subst("$0[i-$1]", vname, CS(delay));
-            FIRIndex index = getCurrentLoopIndex() - CS(delay);
+            FIRIndex index = getCurrentLoopIndex() - clampDelay(CS(delay), mxd);
             return generateCacheCode(sig, InstBuilder::genLoadArrayStackVar(vname, index));
         }
     } else {
-        // long delay : we use a ring buffer of size 2^x
-        int    N         = pow2limit(mxd + gGlobal->gVecSize);
+        // long delay : we use a block buffer (see generateDlineLoop), reads are contiguous in a block
         string vname_idx = vname + "_idx";
 
         if (isSigInt(delay, &d)) {
             if (d == 0) {
-                // return subst("$0[($0_idx+i)&$1]", vname, T(N-1));
-                FIRIndex index1 = (getCurrentLoopIndex() + InstBuilder::genLoadStructVar(vname_idx)) &
-                                  InstBuilder::genInt32NumInst(N - 1);
+                // return subst("$0[$0_idx+i]", vname);
+                FIRIndex index1 = getCurrentLoopIndex() + InstBuilder::genLoadStructVar(vname_idx);
                 return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, index1));
             } else {
-                // return subst("$0[($0_idx+i-$2)&$1]", vname, T(N-1), T(d));
+                // return subst("$0[$0_idx+i-$1]", vname, T(d));
                 FIRIndex index1 = getCurrentLoopIndex() + InstBuilder::genLoadStructVar(vname_idx);
                 FIRIndex index2 = index1 - InstBuilder::genInt32NumInst(d);
-                FIRIndex index3 = index2 & InstBuilder::genInt32NumInst(N - 1);
-                return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, index3));
+                return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, index2));
             }
         } else {
-            // return subst("$0[($0_idx+i-$2)&$1]", vname, T(N-1), CS(delay));
+            // return subst("$0[$0_idx+i-$1]", vname, CS(delay)), reads are not masked so the delay is clamped
             FIRIndex index1 = getCurrentLoopIndex() + InstBuilder::genLoadStructVar(vname_idx);
-            FIRIndex index2 = index1 - CS(delay);
-            FIRIndex index3 = index2 & InstBuilder::genInt32NumInst(N - 1);
-            return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, index3));
+            FIRIndex index2 = index1 - clampDelay(CS(delay), mxd);
+            return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, index2));
         }
     }
 }
@@ -587,33 +583,41 @@ void DAGInstructionsCompiler::generateDlineLoop(Typed::VarType ctype, const stri
         var_access = Address::kStack;
 
     } else {
-        // Implementation of a ring-buffer delayline, the size should be large enough and aligned on a power of two
-        delay = pow2limit(delay + gGlobal->gVecSize);
+        // Implementation of a block delayline : the block is written at 'idx' and read at 'idx - d', without wrapping.
+        // 'idx' moves by one block at each block and is rewound to 'delay' by copying the last 'delay' samples at the
+        // beginning when the next block does not fit anymore. With a buffer of 2 * delay + vec size samples, the copy
+        // source and destination do not overlap, and about one sample is copied for each computed sample.
+        int size = 2 * delay + gGlobal->gVecSize;
 
         // create names for temporary and permanent storage
         string idx      = subst("$0_idx", vname);
         string idx_save = subst("$0_idx_save", vname);
 
         // allocate permanent storage for delayed samples
-        pushClearMethod(generateInitArray(vname, ctype, delay));
+        pushClearMethod(generateInitArray(vname, ctype, size));
         pushDeclare(InstBuilder::genDecStructVar(idx, InstBuilder::genInt32Typed()));
         pushDeclare(InstBuilder::genDecStructVar(idx_save, InstBuilder::genInt32Typed()));
 
         // init permanent memory
-        pushClearMethod(InstBuilder::genStoreStructVar(idx, InstBuilder::genInt32NumInst(0)));
+        pushClearMethod(InstBuilder::genStoreStructVar(idx, InstBuilder::genInt32NumInst(delay)));
         pushClearMethod(InstBuilder::genStoreStructVar(idx_save, InstBuilder::genInt32NumInst(0)));
 
         // -- update index
         FIRIndex index1 = FIRIndex(InstBuilder::genLoadStructVar(idx)) + InstBuilder::genLoadStructVar(idx_save);
-        FIRIndex index2 = index1 & InstBuilder::genInt32NumInst(delay - 1);
+        pushComputePreDSPMethod(InstBuilder::genStoreStructVar(idx, index1));
 
-        pushComputePreDSPMethod(InstBuilder::genStoreStructVar(idx, index2));
+        // -- rewind when the block does not fit
+        FIRIndex   index2 = FIRIndex(InstBuilder::genLoadStructVar(idx)) + InstBuilder::genLoadLoopVar("vsize");
+        BlockInst* rewind = InstBuilder::genBlockInst();
+        rewind->pushBackInst(generateRewindArray(vname, idx, delay));
+        rewind->pushBackInst(InstBuilder::genStoreStructVar(idx, InstBuilder::genInt32NumInst(delay)));
+        pushComputePreDSPMethod(
+            InstBuilder::genIfInst(InstBuilder::genGreaterThan(index2, InstBuilder::genInt32NumInst(size)), rewind));
 
         // -- compute the new samples
         FIRIndex index3 = getCurrentLoopIndex() + InstBuilder::genLoadStructVar(idx);
-        FIRIndex index4 = index3 & InstBuilder::genInt32NumInst(delay - 1);
 
-        pushComputeDSPMethod(InstBuilder::genStoreArrayStructVar(vname, index4, exp));
+        pushComputeDSPMethod(InstBuilder::genStoreArrayStructVar(vname, index3, exp));
 
         // -- save index
         pushComputePostDSPMethod(InstBuilder::genStoreStructVar(idx_save, InstBuilder::genLoadLoopVar("vsize")));
@@ -643,6 +647,26 @@ StatementInst* DAGInstructionsCompiler::generateCopyBackArray(const string& vnam
     return loop;
 }
 
+StatementInst* DAGInstructionsCompiler::generateRewindArray(const string& vname, const string& vname_idx, int size)
+{
+    string index = gGlobal->getFreshID("j");
+
+    // Generates copy loop of the 'size' samples before 'vname_idx' to the beginning of the array
+    DeclareVarInst* loop_decl =
+        InstBuilder::genDecLoopVar(index, InstBuilder::genInt32Typed(), InstBuilder::genInt32NumInst(0));
+    ValueInst*    loop_end       = InstBuilder::genLessThan(loop_decl->load(), InstBuilder::genInt32NumInst(size));
+    StoreVarInst* loop_increment = loop_decl->store(InstBuilder::genAdd(loop_decl->load(), 1));
+
+    ForLoopInst* loop = InstBuilder::genForLoopInst(loop_decl, loop_end, loop_increment);
+
+    FIRIndex load_index =
+        FIRIndex(InstBuilder::genLoadStructVar(vname_idx)) - InstBuilder::genInt32NumInst(size) + loop_decl->load();
+    ValueInst* load_value = InstBuilder::genLoadArrayStructVar(vname, load_index);
+
+    loop->pushFrontInst(InstBuilder::genStoreArrayStructVar(vname, loop_decl->load(), load_value));
+    return loop;
+}
+
 ValueInst* DAGInstructionsCompiler::generateWaveform(Tree sig)
 {
     string vname;
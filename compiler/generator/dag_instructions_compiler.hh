@@ -55,6 +55,7 @@ class DAGInstructionsCompiler : public InstructionsCompiler {
                                          Address::AccessType& var_access);
 
     StatementInst* generateCopyBackArray(const string& vname_to, const string& vname_from, int size);
+    StatementInst* generateRewindArray(const string& vname, const string& vname_idx, int size);
 
     // private helper functions
     bool needSeparateLoop(Tree sig);
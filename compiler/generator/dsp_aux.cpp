@@ -22,9 +22,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/stat.h>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "Text.hh"
 #include "compatibility.hh"
@@ -225,7 +233,6 @@ Same DSP code and same normalized compilation options will generate the same SHA
 EXPORT string expandDSPFromString(const string& name_app, const string& dsp_content, int argc, const char* argv[],
                                   string& sha_key, string& error_msg)
 {
-    LOCK_API
     if (dsp_content == "") {
         error_msg = "Unable to read file";
         return "";
@@ -267,7 +274,6 @@ EXPORT bool generateAuxFilesFromFile(const string& filename, int argc, const cha
 EXPORT bool generateAuxFilesFromString(const string& name_app, const string& dsp_content, int argc, const char* argv[],
                                        string& error_msg)
 {
-    LOCK_API
     if (dsp_content == "") {
         error_msg = "Unable to read file";
         return false;
@@ -297,6 +303,112 @@ string sha1FromDSP(const string& name_app, const string& dsp_content, int argc,
     return dsp_content;
 }
 
+/*
+Persistent factory cache : activated by setting the FAUST_CACHE_DIR environment variable to an existing directory.
+The entry name is computed from the SHA key of the DSP code, the normalized compilation options, the backend, the
+target and the compiler version. An entry starts with the list of the imported files, with the SHA key of their content
+and their modification time and size when it was written, so that a change in one of the libraries invalidates it
+without running the front-end. The content of a file is only read and hashed again when its modification time or size
+has changed:
+
+    <number of imported files>
+    <SHA key of the file content> <modification time> <size> <pathname>
+    ...
+    <code>
+*/
+string getFactoryCachePath(const string& name_app, const string& dsp_content, int argc, const char* argv[],
+                           const string& backend, const string& target)
+{
+    const char* cache_dir = getenv("FAUST_CACHE_DIR");
+    if (!cache_dir || strlen(cache_dir) == 0) return "";
+
+    string key = generateSHA1(name_app + dsp_content + reorganizeCompilationOptions(argc, argv) + backend + target +
+                              FAUSTVERSION);
+    return string(cache_dir) + "/" + key + "." + backend;
+}
+
+static string fileSHA1(const string& pathname)
+{
+    ifstream reader(pathname.c_str(), ios::binary);
+    return (reader.is_open()) ? generateSHA1(string(istreambuf_iterator<char>(reader), {})) : "";
+}
+
+// Modification time and size of a file, or "0 -1" (never matching) if it cannot be trusted to detect a change
+static string fileStamp(const string& pathname, bool written = false)
+{
+    struct stat st;
+    if (stat(pathname.c_str(), &st) != 0) return "0 -1";
+    // A file modified in the same second as the entry is written could change again with the same time and size
+    if (written && st.st_mtime >= time(nullptr) - 1) return "0 -1";
+    stringstream stamp;
+    stamp << (long long)st.st_mtime << " " << (long long)st.st_size;
+    return stamp.str();
+}
+
+bool readFactoryCacheFile(const string& path, string& code)
+{
+    ifstream reader(path.c_str(), ios::binary);
+    if (!reader.is_open()) return false;
+
+    string line;
+    int    files = -1;
+    if (!getline(reader, line) || sscanf(line.c_str(), "%d", &files) != 1 || files < 0) return false;
+    for (int i = 0; i < files; i++) {
+        char      sha_key[64];
+        long long mtime, size;
+        int       pos = 0;
+        if (!getline(reader, line) || sscanf(line.c_str(), "%63s %lld %lld %n", sha_key, &mtime, &size, &pos) != 3 ||
+            pos == 0) {
+            return false;
+        }
+        string pathname = line.substr(pos);
+        stringstream stamp;
+        stamp << mtime << " " << size;
+        if (stamp.str() != fileStamp(pathname) && sha_key != fileSHA1(pathname)) return false;
+    }
+    code = string(istreambuf_iterator<char>(reader), {});
+    return reader.good() || reader.eof();
+}
+
+bool writeFactoryCacheFile(const string& path, const string& code, const vector<string>& pathnames)
+{
+    // Write in a temporary file then rename it, so that concurrent readers never see a partially written entry
+    // (the name is unique among the threads of all processes sharing the cache)
+    stringstream tmp_path;
+#ifdef _WIN32
+    tmp_path << path << ".tmp" << _getpid() << "_" << hash<thread::id>()(this_thread::get_id());
+#else
+    tmp_path << path << ".tmp" << getpid() << "_" << hash<thread::id>()(this_thread::get_id());
+#endif
+    {
+        ofstream writer(tmp_path.str().c_str(), ios::binary);
+        if (!writer.is_open()) return false;
+        writer << pathnames.size() << "\n";
+        for (const auto& it : pathnames) {
+            // The stamp is taken before the content, so that a change while hashing is seen on next read
+            string stamp = fileStamp(it, true);
+            writer << fileSHA1(it) << " " << stamp << " " << it << "\n";
+        }
+        writer << code;
+        if (!writer.good()) {
+            writer.close();
+            remove(tmp_path.str().c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // 'rename' fails on Windows when the entry already exists (written by another process, or refreshed)
+    bool renamed = MoveFileExA(tmp_path.str().c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool renamed = rename(tmp_path.str().c_str(), path.c_str()) == 0;
+#endif
+    if (!renamed) {
+        remove(tmp_path.str().c_str());
+        return false;
+    }
+    return true;
+}
+
 // External C libfaust API
 
 #ifdef __cplusplus
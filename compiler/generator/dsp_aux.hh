@@ -27,6 +27,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #ifdef WIN32
@@ -180,22 +181,48 @@ template <class T>
 struct dsp_factory_table : public std::map<T, std::list<dsp*> > {
     typedef typename std::map<T, std::list<dsp*> >::iterator factory_iterator;
 
+    // Secondary index to find factories from their SHA key in constant time, kept in sync on insert and delete
+    std::unordered_map<std::string, factory_iterator> fSHAKeyIndex;
+
     dsp_factory_table() {}
     virtual ~dsp_factory_table() {}
 
     bool getFactory(const std::string& sha_key, factory_iterator& res)
     {
-        for (factory_iterator it = this->begin(); it != this->end(); it++) {
-            if ((*it).first->getSHAKey() == sha_key) {
-                res = it;
-                return true;
-            }
+        typename std::unordered_map<std::string, factory_iterator>::iterator it = fSHAKeyIndex.find(sha_key);
+        if (it != fSHAKeyIndex.end()) {
+            res = (*it).second;
+            return true;
+        } else {
+            return false;
         }
+    }
 
-        return false;
+    // The factory SHA key has to be set before the factory is added in the table
+    void setFactory(T factory)
+    {
+        factory_iterator it = this->insert(std::pair<T, std::list<dsp*> >(factory, std::list<dsp*>())).first;
+        // If several factories have the same SHA key, the first one is kept in the index
+        fSHAKeyIndex.insert(std::make_pair(factory->getSHAKey(), it));
     }
 
-    void setFactory(T factory) { this->insert(std::pair<T, std::list<dsp*> >(factory, std::list<dsp*>())); }
+    void eraseFactory(factory_iterator it)
+    {
+        std::string sha_key = (*it).first->getSHAKey();
+        typename std::unordered_map<std::string, factory_iterator>::iterator it1 = fSHAKeyIndex.find(sha_key);
+        // Only touch the index when it refers to the erased factory, and then move it to another factory
+        // with the same SHA key if any (like the factories created with an empty key)
+        if (it1 != fSHAKeyIndex.end() && (*it1).second == it) {
+            fSHAKeyIndex.erase(it1);
+            for (factory_iterator it2 = this->begin(); it2 != this->end(); it2++) {
+                if (it2 != it && (*it2).first->getSHAKey() == sha_key) {
+                    fSHAKeyIndex.insert(std::make_pair(sha_key, it2));
+                    break;
+                }
+            }
+        }
+        this->erase(it);
+    }
 
     bool addDSP(T factory, dsp* dsp)
     {
@@ -264,7 +291,7 @@ struct dsp_factory_table : public std::map<T, std::list<dsp*> > {
                     delete it1;
                 }
                 // Last use, remove from the global table, pointer will be deleted
-                this->erase(factory);
+                eraseFactory(it);
                 return true;
             } else {
                 factory->removeReference();
@@ -287,6 +314,7 @@ struct dsp_factory_table : public std::map<T, std::list<dsp*> > {
             }
         }
         // Then clear the table thus finally deleting all ref = 1 smart pointers
+        fSHAKeyIndex.clear();
         this->clear();
     }
 };
@@ -294,6 +322,16 @@ struct dsp_factory_table : public std::map<T, std::list<dsp*> > {
 // Compute SHA1 key from name_app, dsp_content and compialtions arguments, and returns the dsp_content
 std::string sha1FromDSP(const std::string& name_app, const std::string& dsp_content, int argc, const char* argv[], std::string& sha_key);
 
+// Persistent factory cache (see FAUST_CACHE_DIR) : return the cache entry path, or "" if the cache is not activated
+std::string getFactoryCachePath(const std::string& name_app, const std::string& dsp_content, int argc, const char* argv[],
+                                const std::string& backend, const std::string& target);
+
+// Read an entry, only valid if the imported files it depends on have not changed since it was written
+bool readFactoryCacheFile(const std::string& path, std::string& code);
+
+// 'pathnames' are the files imported by the DSP (see getLibraryList)
+bool writeFactoryCacheFile(const std::string& path, const std::string& code, const std::vector<std::string>& pathnames);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
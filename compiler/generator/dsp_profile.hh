@@ -0,0 +1,121 @@
+/************************************************************************
+ ************************************************************************
+ Copyright (C) 2003-2020 GRAME, Centre National de Creation Musicale
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef DSP_PROFILE_H
+#define DSP_PROFILE_H
+
+#include <stdint.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+/*
+ Runtime profile of a DSP: recorded by the interpreter when FAUST_INTERP_PROFILE_FILE is set,
+ and read back by the compiler with the '-pgo <file>' option.
+
+ Text format, one record per line:
+    count <size> <calls>        : 'compute' calls with a given block size (loop trip count)
+    select <key> <true> <false> : condition values of a 'select2/select3' (keyed by its signal)
+*/
+
+struct DSPProfile {
+    std::map<int, int64_t>                      fCounts;
+    std::map<int, std::pair<int64_t, int64_t> > fSelects;
+
+    void addCount(int count, int64_t calls = 1) { fCounts[count] += calls; }
+
+    void addSelect(int key, bool cond)
+    {
+        std::pair<int64_t, int64_t>& select = fSelects[key];
+        if (cond) {
+            select.first++;
+        } else {
+            select.second++;
+        }
+    }
+
+    void merge(const DSPProfile& profile)
+    {
+        for (const auto& it : profile.fCounts) {
+            addCount(it.first, it.second);
+        }
+        for (const auto& it : profile.fSelects) {
+            fSelects[it.first].first += it.second.first;
+            fSelects[it.first].second += it.second.second;
+        }
+    }
+
+    // Probability of the 'true' branch of a select, or -1 if the select was not executed
+    double getSelectRatio(int key) const
+    {
+        auto it = fSelects.find(key);
+        if (it == fSelects.end()) return -1.;
+        int64_t total = (*it).second.first + (*it).second.second;
+        return (total > 0) ? double((*it).second.first) / double(total) : -1.;
+    }
+
+    // The block size of all 'compute' calls, or 0 if several sizes were used
+    int getFixedCount() const { return (fCounts.size() == 1) ? fCounts.begin()->first : 0; }
+
+    bool read(const std::string& filename)
+    {
+        std::ifstream reader(filename.c_str());
+        if (!reader.is_open()) return false;
+        std::string line;
+        while (getline(reader, line)) {
+            std::stringstream record(line);
+            std::string       kind;
+            record >> kind;
+            if (kind == "count") {
+                int     count;
+                int64_t calls;
+                if (!(record >> count >> calls)) return false;
+                addCount(count, calls);
+            } else if (kind == "select") {
+                int     key;
+                int64_t on, off;
+                if (!(record >> key >> on >> off)) return false;
+                fSelects[key].first += on;
+                fSelects[key].second += off;
+            } else if (kind != "") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool write(const std::string& filename) const
+    {
+        std::ofstream writer(filename.c_str());
+        if (!writer.is_open()) return false;
+        for (const auto& it : fCounts) {
+            writer << "count " << it.first << " " << it.second << std::endl;
+        }
+        for (const auto& it : fSelects) {
+            writer << "select " << it.first << " " << it.second.first << " " << it.second.second << std::endl;
+        }
+        return writer.good();
+    }
+};
+
+#endif
@@ -316,7 +316,8 @@ struct ConstantPropagationBuilder : public BasicCloneVisitor {
         } else if (int1) {
             return (int1->fNum > 0) ? inst->fThen->clone(this) : inst->fElse->clone(this);
         } else {
-            return InstBuilder::genSelect2Inst(val1, inst->fThen->clone(this), inst->fElse->clone(this));
+            return InstBuilder::genSelect2Inst(val1, inst->fThen->clone(this), inst->fElse->clone(this),
+                                               inst->fProfileKey);
         }
     }
 
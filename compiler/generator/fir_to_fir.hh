@@ -701,4 +701,33 @@ struct LoopVariableRenamer : public BasicCloneVisitor {
     BlockInst* getCode(BlockInst* src) { return static_cast<BlockInst*>(src->clone(this)); }
 };
 
+/*
+ Rename the stack variables declared in the code and all their accesses, so that a copy of the code
+ can be added in the same function
+*/
+struct StackVariableRenamer : public BasicCloneVisitor {
+    std::map<std::string, std::string> fStackVarMap;
+
+    virtual StatementInst* visit(DeclareVarInst* inst)
+    {
+        if (dynamic_cast<NamedAddress*>(inst->fAddress) && inst->fAddress->getAccess() == Address::kStack) {
+            std::string name   = inst->fAddress->getName();
+            fStackVarMap[name] = gGlobal->getFreshID(name);
+        }
+        return BasicCloneVisitor::visit(inst);
+    }
+
+    virtual Address* visit(NamedAddress* address)
+    {
+        auto it = fStackVarMap.find(address->getName());
+        if (address->fAccess == Address::kStack && it != fStackVarMap.end()) {
+            return new NamedAddress(it->second, address->fAccess);
+        } else {
+            return BasicCloneVisitor::visit(address);
+        }
+    }
+
+    BlockInst* getCode(BlockInst* src) { return static_cast<BlockInst*>(src->clone(this)); }
+};
+
 #endif
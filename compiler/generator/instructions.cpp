@@ -25,7 +25,7 @@
 #include "sigtype.hh"
 
 // Used when inlining functions
-std::stack<BlockInst*> BasicCloneVisitor::fBlockStack;
+thread_local std::stack<BlockInst*> BasicCloneVisitor::fBlockStack;
 
 DeclareStructTypeInst* isStructType(const string& name)
 {
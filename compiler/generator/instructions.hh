@@ -1071,9 +1071,10 @@ struct Select2Inst : public ValueInst {
     ValueInst* fCond;
     ValueInst* fThen;
     ValueInst* fElse;
+    int        fProfileKey;  // Key of the select in a runtime profile (see DSPProfile), or 0
 
-    Select2Inst(ValueInst* cond_inst, ValueInst* then_inst, ValueInst* else_inst)
-        : ValueInst(), fCond(cond_inst), fThen(then_inst), fElse(else_inst)
+    Select2Inst(ValueInst* cond_inst, ValueInst* then_inst, ValueInst* else_inst, int profile_key = 0)
+        : ValueInst(), fCond(cond_inst), fThen(then_inst), fElse(else_inst), fProfileKey(profile_key)
     {
     }
 
@@ -1253,7 +1254,7 @@ struct WhileLoopInst : public StatementInst {
 
 class BasicCloneVisitor : public CloneVisitor {
    protected:
-    static std::stack<BlockInst*> fBlockStack;
+    static thread_local std::stack<BlockInst*> fBlockStack;
 
    public:
     BasicCloneVisitor() {}
@@ -1353,7 +1354,7 @@ class BasicCloneVisitor : public CloneVisitor {
         ValueInst* else_exp = inst->fElse->clone(this);
         ValueInst* cond_exp = inst->fCond->clone(this);
         // cond_exp has to be evaluated last for FunctionInliner to correctly work in gHasTeeLocal mode
-        return new Select2Inst(cond_exp, then_exp, else_exp);
+        return new Select2Inst(cond_exp, then_exp, else_exp, inst->fProfileKey);
     }
     virtual StatementInst* visit(IfInst* inst)
     {
@@ -1372,8 +1373,13 @@ class BasicCloneVisitor : public CloneVisitor {
     // Loop
     virtual StatementInst* visit(ForLoopInst* inst)
     {
-        return new ForLoopInst(inst->fInit->clone(this), inst->fEnd->clone(this), inst->fIncrement->clone(this),
-                               static_cast<BlockInst*>(inst->fCode->clone(this)), inst->fIsRecursive);
+        // The loop variable declaration has to be cloned first (visitors may rename it),
+        // and arguments evaluation order is unspecified
+        StatementInst* init      = inst->fInit->clone(this);
+        ValueInst*     end       = inst->fEnd->clone(this);
+        StatementInst* increment = inst->fIncrement->clone(this);
+        return new ForLoopInst(init, end, increment, static_cast<BlockInst*>(inst->fCode->clone(this)),
+                               inst->fIsRecursive);
     }
 
     virtual StatementInst* visit(SimpleForLoopInst* inst)
@@ -1938,9 +1944,10 @@ struct InstBuilder {
     static DropInst* genDropInst(ValueInst* result = nullptr) { return new DropInst(result); }
 
     // Conditional
-    static Select2Inst* genSelect2Inst(ValueInst* cond_inst, ValueInst* then_inst, ValueInst* else_inst)
+    static Select2Inst* genSelect2Inst(ValueInst* cond_inst, ValueInst* then_inst, ValueInst* else_inst,
+                                       int profile_key = 0)
     {
-        return new Select2Inst(cond_inst, then_inst, else_inst);
+        return new Select2Inst(cond_inst, then_inst, else_inst, profile_key);
     }
     static IfInst* genIfInst(ValueInst* cond_inst, BlockInst* then_inst, BlockInst* else_inst)
     {
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "Text.hh"
+#include "dsp_profile.hh"
 #include "ensure.hh"
 #include "exception.hh"
 #include "fir_to_fir.hh"
@@ -34,6 +35,7 @@
 #include "privatise.hh"
 #include "recursivness.hh"
 #include "sigConstantPropagation.hh"
+#include "sigLookAhead.hh"
 #include "sigPromotion.hh"
 #include "sigToGraph.hh"
 #include "sigprint.hh"
@@ -51,12 +53,90 @@ static inline BasicTyped* genBasicFIRTyped(int sig_type)
     return InstBuilder::genBasicTyped((sig_type == kInt) ? Typed::kInt32 : itfloat());
 }
 
+// Report (with -d) an operation that the intervals of its arguments make useless
+static void reportRemovedOperation(const string& op, const vector< ::Type>& types, int arg)
+{
+    if (gGlobal->gDetailsSwitch) {
+        cout << "'" << op << "' with arguments in";
+        for (size_t i = 0; i < types.size(); i++) {
+            cout << " " << types[i]->getInterval();
+        }
+        cout << " is replaced by its argument " << arg << endl;
+    }
+}
+
+/**
+ * Test if a signal depends on a UI control (or a soundfile). The interval of such a signal
+ * comes from the control range, but hosts may set any value in the control zone, so it cannot
+ * be used to remove clamps and range reductions.
+ */
+bool InstructionsCompiler::isUIDependent(Tree sig)
+{
+    auto it = fUIDependentSig.find(sig);
+    if (it != fUIDependentSig.end()) return it->second;
+
+    // A recursion reached again from its own definition is first considered as independent,
+    // so iterate until no new dependency is found
+    set<Tree> visited;
+    bool      changed;
+    do {
+        visited.clear();
+        changed = false;
+        isUIDependentAux(sig, visited, changed);
+    } while (changed);
+
+    // Dependent signals are already memoized, the remaining visited signals are independent
+    for (Tree s : visited) {
+        fUIDependentSig.insert(make_pair(s, false));
+    }
+    return fUIDependentSig[sig];
+}
+
+bool InstructionsCompiler::isUIDependentAux(Tree sig, set<Tree>& visited, bool& changed)
+{
+    auto it = fUIDependentSig.find(sig);
+    if (it != fUIDependentSig.end()) return it->second;
+    if (visited.count(sig)) return false;
+    visited.insert(sig);
+
+    Tree var, body, label;
+    bool res = isSigButton(sig) || isSigCheckbox(sig) || isSigHSlider(sig) || isSigVSlider(sig) ||
+               isSigNumEntry(sig) || isSigSoundfile(sig, label);
+    if (!res && isRec(sig, var, body)) {
+        res = isUIDependentAux(body, visited, changed);
+    } else if (!res) {
+        for (Tree b : sig->branches()) {
+            if (isUIDependentAux(b, visited, changed)) {
+                res = true;
+                break;
+            }
+        }
+    }
+    if (res) {
+        fUIDependentSig[sig] = true;
+        changed              = true;
+    }
+    return res;
+}
+
+// Test if one of the arguments of an operation depends on a UI control
+bool InstructionsCompiler::hasUIDependentArg(Tree sig)
+{
+    for (Tree b : sig->branches()) {
+        if (isUIDependent(b)) return true;
+    }
+    return false;
+}
+
 InstructionsCompiler::InstructionsCompiler(CodeContainer* container)
     : fContainer(container),
       fSharingKey(nullptr),
       fUIRoot(uiFolder(cons(tree(0), tree(subst("$0", ""))), gGlobal->nil)),
       fDescription(0),
-      fLoadedIota(false)
+      fLoadedIota(false),
+      fDecimation(0),
+      fDecimatedCode(nullptr),
+      fInDecimatedCode(false)
 {
 }
 
@@ -64,9 +144,9 @@ InstructionsCompiler::InstructionsCompiler(CodeContainer* container)
 
 int InstructionsCompiler::getSharingCount(Tree sig)
 {
-    Tree c;
-    if (getProperty(sig, fSharingKey, c)) {
-        return c->node().getInt();
+    PropertyValue* c = sig->getValueProperty(fSharingKey);
+    if (c) {
+        return c->fInt;
     } else {
         return 0;
     }
@@ -74,7 +154,9 @@ int InstructionsCompiler::getSharingCount(Tree sig)
 
 void InstructionsCompiler::setSharingCount(Tree sig, int count)
 {
-    setProperty(sig, fSharingKey, tree(count));
+    PropertyValue c;
+    c.fInt = count;
+    sig->setValueProperty(fSharingKey, c);
 }
 
 void InstructionsCompiler::sharingAnalysis(Tree t)
@@ -168,6 +250,14 @@ Tree InstructionsCompiler::prepare(Tree LS)
 
     Tree L5 = privatise(L4);  // Un-share tables with multiple writers
 
+    if (gGlobal->gLookAheadStep > 1) {
+        startTiming("Look-ahead");
+        typeAnnotation(L5, false);  // The natures and variabilities of the recursions are needed
+        SignalLookAhead SL(gGlobal->gLookAheadStep);
+        L5 = SL.mapself(L5);
+        endTiming("Look-ahead");
+    }
+
     // dump normal form
     if (gGlobal->gDumpNorm) {
         cout << ppsig(L5) << endl;
@@ -180,8 +270,10 @@ Tree InstructionsCompiler::prepare(Tree LS)
     typeAnnotation(L5, true);  // Annotate L5 with type information and check causality
     endTiming("L5 typeAnnotation");
 
+    startTiming("occurrences markup");
     sharingAnalysis(L5);  // annotate L5 with sharing count
     fOccMarkup.mark(L5);  // annotate L5 with occurrences analysis
+    endTiming("occurrences markup");
     // annotationStatistics();
     endTiming("prepare");
 
@@ -284,6 +376,10 @@ ValueInst* InstructionsCompiler::CS(Tree sig)
 {
     ValueInst* code;
 
+    if (fDecimation > 0 && isDecimated(sig)) {
+        return generateDecimated(sig);
+    }
+
     if (!getCompiledExpression(sig, code)) {
         code = generateCode(sig);
         setCompiledExpression(sig, code);
@@ -313,6 +409,9 @@ void InstructionsCompiler::compileMultiSignal(Tree L)
 
     L = prepare(L);  // Optimize, share and annotate expression
 
+    // Only done in the main DSP loop, not in the tables initialisation (and not with the 'one sample control' model)
+    fDecimation = (gGlobal->gOneSampleControl) ? 0 : gGlobal->gControlRate;
+
     startTiming("compileMultiSignal");
 
 #ifdef LLVM_DEBUG
@@ -403,6 +502,8 @@ void InstructionsCompiler::compileMultiSignal(Tree L)
         fContainer->setOutputRate(index, rate);
     }
 
+    generateDecimatedInit();
+
     generateUserInterfaceTree(prepareUserInterfaceTree(fUIRoot), true);
     generateMacroInterfaceTree("", prepareUserInterfaceTree(fUIRoot));
     if (fDescription) {
@@ -410,7 +511,9 @@ void InstructionsCompiler::compileMultiSignal(Tree L)
     }
 
     // Apply FIR to FIR transformations
+    startTiming("processFIR");
     fContainer->processFIR();
+    endTiming("processFIR");
 
     // Generate JSON (which checks for non duplicated path)
     if (gGlobal->gPrintJSONSwitch) {
@@ -739,6 +842,13 @@ ValueInst* InstructionsCompiler::generateBinOp(Tree sig, int opcode, Tree a1, Tr
         // cerr << "WARNING : potential division by zero (" << i << "/" << j << ") in " << ppsig(sig) << endl;
     }
 
+    // x % y is x when x is known to be in [0, y[
+    if (opcode == kRem && isRemIdentity(i, j) && !hasUIDependentArg(sig)) {
+        reportRemovedOperation("%", {getCertifiedSigType(a1), getCertifiedSigType(a2)}, 0);
+        return generateCacheCode(sig, (t1 == t3) ? v1 : ((t3 == kInt) ? InstBuilder::genCastInt32Inst(v1)
+                                                                       : InstBuilder::genCastFloatInst(v1)));
+    }
+
     // Logical operations work on kInt32, so cast both operands here
     if (isLogicalOpcode(opcode)) {
         res = InstBuilder::genBinopInst(opcode, promote2int(t1, v1), promote2int(t2, v2));
@@ -938,6 +1048,218 @@ ValueInst* InstructionsCompiler::generateVariableStore(Tree sig, ValueInst* exp)
     }
 }
 
+/*****************************************************************************
+ CONTROL-RATE DECIMATION
+
+ With '-cr N', the one-pole smoothers of control values (see isSmoother), and the expressions
+ only depending on them and on control values, are computed every N samples in a decimated code
+ executed at the beginning of the sample loop :
+
+    if (iDecCount0 == 0) {
+        fDec0 = (iDecCount0 < 0) ? fDec0 : (fSlow1 * fDec0 + fSlow2);     // smoother advanced by N samples
+        float fDecVal0_next = cos(fDec0);                                 // next value of an expression to reach
+        if (iDecCount0 < 0) {
+            fDecVal0 = fDecVal0_next;
+        }
+        fDecVal0_step = (fDecVal0_next - fDecVal0) / N;
+        iDecCount0 = N;
+    }
+    iDecCount0 = iDecCount0 - 1;
+    fDecVal0 = fDecVal0 + fDecVal0_step;                                  // linear interpolation used in the sample loop
+
+ After instanceClear, iDecCount0 is -1 and a copy of the decimated code is executed once before the
+ sample loop, without advancing the smoothers: it sets the fDecVal to the values of the expressions at
+ the cleared state, from which the first window is interpolated.
+ *****************************************************************************/
+
+// Test if rec is a one-pole smoother of a control value : y = x + c * y' with x and c control values and 0 <= c < 1
+bool InstructionsCompiler::isSmoother(Tree rec, Tree& x, Tree& c)
+{
+    Tree var, le, a, b, y, z, d;
+    int  op, i, k;
+
+    if (!isRec(rec, var, le) || !isList(le) || !isNil(tl(le))) return false;
+    Tree exp = hd(le);
+    if (getCertifiedSigType(exp)->nature() != kReal || !isSigBinOp(exp, &op, a, b) || op != kAdd) return false;
+
+    // a is the recursive term and b the control value
+    if (getCertifiedSigType(a)->variability() != kSamp) std::swap(a, b);
+    if (getCertifiedSigType(b)->variability() == kSamp || !isSigBinOp(a, &op, y, z) || op != kMul) return false;
+
+    // y is the coefficient and z the delayed recursion
+    if (getCertifiedSigType(y)->variability() == kSamp) std::swap(y, z);
+    if (getCertifiedSigType(y)->variability() == kSamp) return false;
+    if (!isSigDelay1(z, z) && !(isSigFixDelay(z, z, d) && isSigInt(d, &k) && k == 1)) return false;
+    if (!isProj(z, &i, z) || z != rec) return false;
+
+    interval iv = getCertifiedSigType(y)->getInterval();
+    if (!iv.valid || iv.lo < 0 || iv.hi >= 1) return false;
+
+    x = b;
+    c = y;
+    return true;
+}
+
+// Test if sig can be computed in the decimated code
+bool InstructionsCompiler::isDecimated(Tree sig)
+{
+    auto it = fDecimatedSig.find(sig);
+    if (it != fDecimatedSig.end()) return (*it).second;
+
+    ::Type t   = getCertifiedSigType(sig);
+    bool   res = false;
+    Tree   rec, x, c;
+    int    i, op, d;
+
+    if (t->variability() == kSamp && t->nature() == kReal) {
+        int mxd = fOccMarkup.retrieve(sig)->getMaxDelay();
+        if (isSigFixDelay(sig, x, c) && isSigInt(c, &d) && d == 0) {
+            res = isDecimated(x);
+        } else if (isProj(sig, &i, rec)) {
+            // The smoother must only be delayed by its own recursion
+            res = (mxd == 1) && isSmoother(rec, x, c);
+        } else if (mxd == 0 && (getUserData(sig) || isSigBinOp(sig, &op, x, c) || isSigFloatCast(sig, x))) {
+            vector<Tree> subsigs;
+            getSubSignals(sig, subsigs);
+            res = true;
+            for (Tree s : subsigs) {
+                res = res && (getCertifiedSigType(s)->variability() != kSamp || isDecimated(s));
+            }
+        }
+    }
+
+    fDecimatedSig[sig] = res;
+    return res;
+}
+
+ValueInst* InstructionsCompiler::generateDecimated(Tree sig)
+{
+    ValueInst* code;
+    Tree       rec, x, c;
+    int        i;
+
+    // x@0 is x
+    if (isSigFixDelay(sig, x, c)) {
+        return CS(x);
+    }
+
+    if (fInDecimatedCode) {
+        // Value computed in the decimated code
+        auto it = fDecimatedExp.find(sig);
+        if (it != fDecimatedExp.end()) return (*it).second;
+        if (isProj(sig, &i, rec) && isSmoother(rec, x, c)) {
+            code = generateSmoother(x, c);
+        } else {
+            code = generateCode(sig);
+        }
+        fDecimatedExp[sig] = code;
+        return code;
+    }
+
+    if (getCompiledExpression(sig, code)) {
+        return code;
+    }
+
+    if (!fDecimatedCode) {
+        fDecimatedCounter = gGlobal->getFreshID("iDecCount");
+        pushDeclare(InstBuilder::genDecStructVar(fDecimatedCounter, InstBuilder::genInt32Typed()));
+        pushClearMethod(InstBuilder::genStoreStructVar(fDecimatedCounter, InstBuilder::genInt32NumInst(-1)));
+        fDecimatedCode    = InstBuilder::genBlockInst();
+        BlockInst* window = InstBuilder::genBlockInst();
+        window->pushBackInst(fDecimatedCode);
+        window->pushBackInst(
+            InstBuilder::genStoreStructVar(fDecimatedCounter, InstBuilder::genInt32NumInst(fDecimation)));
+        pushComputePreDSPMethod(InstBuilder::genIfInst(
+            InstBuilder::genEqual(InstBuilder::genLoadStructVar(fDecimatedCounter), InstBuilder::genInt32NumInst(0)),
+            window));
+        pushComputePreDSPMethod(InstBuilder::genStoreStructVar(
+            fDecimatedCounter,
+            InstBuilder::genSub(InstBuilder::genLoadStructVar(fDecimatedCounter), InstBuilder::genInt32NumInst(1))));
+    }
+
+    fInDecimatedCode = true;
+    ValueInst* value = CS(sig);
+    fInDecimatedCode = false;
+
+    // Linear interpolation in the sample loop of the values computed in the decimated code
+    Typed* type  = InstBuilder::genBasicTyped(itfloat());
+    string vname = gGlobal->getFreshID("fDecVal");
+    string step  = vname + "_step";
+    pushDeclare(InstBuilder::genDecStructVar(vname, type));
+    pushDeclare(InstBuilder::genDecStructVar(step, type));
+    pushClearMethod(InstBuilder::genStoreStructVar(vname, InstBuilder::genRealNumInst(itfloat(), 0.)));
+    pushClearMethod(InstBuilder::genStoreStructVar(step, InstBuilder::genRealNumInst(itfloat(), 0.)));
+
+    string next = vname + "_next";
+    fDecimatedCode->pushBackInst(InstBuilder::genDecStackVar(next, type, value));
+    BlockInst* first = InstBuilder::genBlockInst();
+    first->pushBackInst(InstBuilder::genStoreStructVar(vname, InstBuilder::genLoadStackVar(next)));
+    fDecimatedCode->pushBackInst(InstBuilder::genIfInst(isClearedState(), first));
+    fDecimatedCode->pushBackInst(InstBuilder::genStoreStructVar(
+        step,
+        InstBuilder::genDiv(InstBuilder::genSub(InstBuilder::genLoadStackVar(next), InstBuilder::genLoadStructVar(vname)),
+                            InstBuilder::genRealNumInst(itfloat(), double(fDecimation)))));
+    pushComputePreDSPMethod(InstBuilder::genStoreStructVar(
+        vname, InstBuilder::genAdd(InstBuilder::genLoadStructVar(vname), InstBuilder::genLoadStructVar(step))));
+
+    return setCompiledExpression(sig, InstBuilder::genLoadStructVar(vname));
+}
+
+// Executes a copy of the complete decimated code before the sample loop of the first block after instanceClear
+void InstructionsCompiler::generateDecimatedInit()
+{
+    if (!fDecimatedCode) return;
+
+    // The stack variables of the copy are renamed, since it is added in the same method
+    StackVariableRenamer renamer;
+    BlockInst*           init = renamer.getCode(fDecimatedCode);
+    init->pushBackInst(InstBuilder::genStoreStructVar(fDecimatedCounter, InstBuilder::genInt32NumInst(0)));
+    pushComputeBlockMethod(InstBuilder::genIfInst(isClearedState(), init));
+}
+
+// True in the decimated code executed at the cleared state (see generateDecimatedInit)
+ValueInst* InstructionsCompiler::isClearedState()
+{
+    return InstBuilder::genLessThan(InstBuilder::genLoadStructVar(fDecimatedCounter), InstBuilder::genInt32NumInst(0));
+}
+
+// y = x + c * y' advanced by N samples : y = c^N * y + x * (1 - c^N) / (1 - c)
+ValueInst* InstructionsCompiler::generateSmoother(Tree x, Tree c)
+{
+    Typed* type = InstBuilder::genBasicTyped(itfloat());
+
+    // c^N (N is a power of 2) and x * (1 - c^N) / (1 - c) are computed once per block
+    string coef = "f" + gGlobal->getFreshID("Slow");
+    pushComputeBlockMethod(
+        InstBuilder::genDecStackVar(coef, type, promote2real(getCertifiedSigType(c)->nature(), CS(c))));
+    string pow = coef;
+    for (int n = 1; n < fDecimation; n *= 2) {
+        string prev = pow;
+        pow         = "f" + gGlobal->getFreshID("Slow");
+        pushComputeBlockMethod(InstBuilder::genDecStackVar(
+            pow, type, InstBuilder::genMul(InstBuilder::genLoadStackVar(prev), InstBuilder::genLoadStackVar(prev))));
+    }
+    string gain = "f" + gGlobal->getFreshID("Slow");
+    pushComputeBlockMethod(InstBuilder::genDecStackVar(
+        gain, type,
+        InstBuilder::genDiv(
+            InstBuilder::genMul(promote2real(getCertifiedSigType(x)->nature(), CS(x)),
+                                InstBuilder::genSub(InstBuilder::genRealNumInst(itfloat(), 1.),
+                                                    InstBuilder::genLoadStackVar(pow))),
+            InstBuilder::genSub(InstBuilder::genRealNumInst(itfloat(), 1.), InstBuilder::genLoadStackVar(coef)))));
+
+    string vname = gGlobal->getFreshID("fDec");
+    pushDeclare(InstBuilder::genDecStructVar(vname, type));
+    pushClearMethod(InstBuilder::genStoreStructVar(vname, InstBuilder::genRealNumInst(itfloat(), 0.)));
+    fDecimatedCode->pushBackInst(InstBuilder::genStoreStructVar(
+        vname, InstBuilder::genSelect2Inst(
+                   isClearedState(), InstBuilder::genLoadStructVar(vname),
+                   InstBuilder::genAdd(
+                       InstBuilder::genMul(InstBuilder::genLoadStackVar(pow), InstBuilder::genLoadStructVar(vname)),
+                       InstBuilder::genLoadStackVar(gain)))));
+    return InstBuilder::genLoadStructVar(vname);
+}
+
 /*****************************************************************************
  CASTING
  *****************************************************************************/
@@ -945,6 +1267,15 @@ ValueInst* InstructionsCompiler::generateVariableStore(Tree sig, ValueInst* exp)
 // Generate cast only when really necessary...
 ValueInst* InstructionsCompiler::generateIntCast(Tree sig, Tree x)
 {
+    // int(float(y)) is y when y is an integer exactly representable as a float
+    Tree y;
+    if (isSigFloatCast(x, y) && getCertifiedSigType(y)->nature() == kInt) {
+        interval i = getCertifiedSigType(y)->getInterval();
+        if (i.valid && (fabs(i.lo) <= 16777216.) && (fabs(i.hi) <= 16777216.) && !isUIDependent(y)) {
+            reportRemovedOperation("int(float)", {getCertifiedSigType(y)}, 0);
+            return generateCacheCode(sig, CS(y));
+        }
+    }
     return generateCacheCode(sig,
                              (getCertifiedSigType(x)->nature() != kInt) ? InstBuilder::genCastInt32Inst(CS(x)) : CS(x));
 }
@@ -1398,7 +1729,7 @@ ValueInst* InstructionsCompiler::generateWRTbl(Tree sig, Tree tbl, Tree idx, Tre
             error << "ERROR : WRTbl write index [" << idx_i.lo << ":" <<idx_i.hi
                   << "] is outside of table range (" << tree2int(size) << ") in "
                   << *sig << endl;
-            if (gGlobal->gCheckTable == "cta") {
+            if (gGlobal->gCheckTable == "cat") {
                 cerr << error.str();
             } else {
                 throw faustexception(error.str());
@@ -1443,7 +1774,7 @@ ValueInst* InstructionsCompiler::generateRDTbl(Tree sig, Tree tbl, Tree idx)
             error << "ERROR : RDTbl read index [" << idx_i.lo << ":" <<idx_i.hi
                   << "] is outside of table range (" << tree2int(size) << ") in "
                   << *sig << endl;
-            if (gGlobal->gCheckTable == "cta") {
+            if (gGlobal->gCheckTable == "cat") {
                 cerr << error.str();
             } else {
                 throw faustexception(error.str());
@@ -1648,6 +1979,41 @@ void InstructionsCompiler::ensureIotaCode()
  SELECT
  *****************************************************************************/
 
+/*
+ Key of a signal in a runtime profile. Unlike the tree hashkey (that depends on the symbols addresses) it only depends
+ on the tree structure, so that it is the same each time the DSP is compiled, whatever the backend.
+*/
+int InstructionsCompiler::getProfileKey(Tree sig)
+{
+    auto it = fProfileKeys.find(sig);
+    if (it != fProfileKeys.end()) return (*it).second;
+
+    // FNV-1a hash of the node and of the keys of the branches
+    const Node& node = sig->node();
+    uint32_t    key  = 2166136261u;
+    auto        mix  = [&key](uint32_t val) { key = (key ^ val) * 16777619u; };
+    mix(uint32_t(node.type()));
+    if (node.type() == kIntNode) {
+        mix(uint32_t(node.getInt()));
+    } else if (node.type() == kDoubleNode) {
+        double   val = node.getDouble();
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        mix(uint32_t(bits));
+        mix(uint32_t(bits >> 32));
+    } else if (node.type() == kSymNode) {
+        for (const char* c = name(node.getSym()); *c; c++) mix(uint32_t(*c));
+    }
+    for (int i = 0; i < sig->arity(); i++) {
+        mix(uint32_t(getProfileKey(sig->branch(i))));
+    }
+
+    // 0 means 'no key'
+    int res           = (key == 0) ? 1 : int(key);
+    fProfileKeys[sig] = res;
+    return res;
+}
+
 ValueInst* InstructionsCompiler::generateSelect2(Tree sig, Tree sel, Tree s1, Tree s2)
 {
     ValueInst* cond = CS(sel);
@@ -1665,7 +2031,10 @@ ValueInst* InstructionsCompiler::generateSelect2(Tree sig, Tree sel, Tree s1, Tr
         v2 = promote2real(t2, v2);
     }
 
-    return generateCacheCode(sig, InstBuilder::genSelect2Inst(cond, v2, v1));
+    // The interpreter records the branches taken by the select in profiling mode, the other backends use the profile
+    int profile_key = (gGlobal->gOutputLang == "interp" || gGlobal->gProfile) ? getProfileKey(sig) : 0;
+
+    return generateCacheCode(sig, InstBuilder::genSelect2Inst(cond, v2, v1, profile_key));
 }
 
 ValueInst* InstructionsCompiler::generateSelect3(Tree sig, Tree sel, Tree s1, Tree s2, Tree s3)
@@ -1690,6 +2059,20 @@ ValueInst* InstructionsCompiler::generateXtended(Tree sig)
         arg_types.push_back(getCertifiedSigType(sig->branch(i)));
     }
 
+    // Clamps and range reductions that the arguments intervals make useless are removed
+    // (but not when the intervals come from UI controls, since hosts may set any value)
+    int arg = hasUIDependentArg(sig) ? -1 : p->getIdentityArg(arg_types);
+    if (arg >= 0) {
+        reportRemovedOperation(p->name(), arg_types, arg);
+        ValueInst* res = *next(args.begin(), arg);
+        int        t1  = arg_types[arg]->nature();
+        int        t2  = getCertifiedSigType(sig)->nature();
+        if (t1 != t2) {
+            res = (t2 == kInt) ? InstBuilder::genCastInt32Inst(res) : InstBuilder::genCastFloatInst(res);
+        }
+        return generateCacheCode(sig, res);
+    }
+
     if (p->needCache()) {
         return generateCacheCode(sig, p->generateCode(fContainer, args, getCertifiedSigType(sig), arg_types));
     } else {
@@ -1715,6 +2098,7 @@ ValueInst* InstructionsCompiler::generateXtended(Tree sig)
  Temp	V[0]	V[1]	...
  V[0]	V[1]	V[2]	...
 
+ with a ring buffer which layout is chosen for each delay line (see getDelayLine)
 
  *****************************************************************************/
 
@@ -1750,15 +2134,98 @@ ValueInst* InstructionsCompiler::generateFixDelay(Tree sig, Tree exp, Tree delay
             return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, CS(delay)));
         }
     } else {
-        // Long delay : we use a ring buffer of size 2^x
-        int N = pow2limit(mxd + 1);
+        // Long delay : we use a ring buffer
+        Typed::VarType ctype = (getCertifiedSigType(exp)->nature() == kInt) ? Typed::kInt32 : itfloat();
+        return generateCacheCode(sig, generateDelayAccess(vname, ctype, mxd, CS(delay)));
+    }
+}
+
+/*
+ Layout of the ring buffer of a long delay line keeping M = mxd + 1 values, chosen with a simple cost model:
+
+ - kMaskRing : 2^x >= M values, written at IOTA & (2^x - 1) and read at (IOTA - d) & (2^x - 1). Cheapest index
+   computation, but up to half of the buffer is wasted, so it is used when the power of 2 wastes at most a quarter of
+   the buffer, or when the buffer is small anyway.
+
+ - kMirrorRing : 2 * M values, each value is written at idx and idx + M, and read at idx + M - d which never wraps.
+   Index computation is as cheap as with kMaskRing, so it is used when 2 * M values still fit in a small cache budget.
+
+ - kExactRing : M values written at idx and read at idx + M - d, minus M when it wraps. The smallest buffer, used for
+   long delay lines (typically reverbs) where the cache footprint matters more than the wrapping test.
 
-        FIRIndex value2 =
-            (FIRIndex(InstBuilder::genLoadStructVar("IOTA")) - CS(delay)) & InstBuilder::genInt32NumInst(N - 1);
-        return generateCacheCode(sig, InstBuilder::genLoadArrayStructVar(vname, value2));
+ idx is a per line index going from 0 to M - 1.
+*/
+#define SMALL_DELAY_BYTES 1024
+#define MIRROR_DELAY_BYTES 8192
+
+InstructionsCompiler::DelayLine InstructionsCompiler::getDelayLine(Typed::VarType ctype, int mxd)
+{
+    int M     = mxd + 1;
+    int N     = pow2limit(M);
+    int bytes = gGlobal->gTypeSizeMap[ctype];
+
+    if ((N - M) * 4 <= N || N * bytes <= SMALL_DELAY_BYTES) {
+        return {kMaskRing, N};
+    } else if (2 * M * bytes <= MIRROR_DELAY_BYTES) {
+        return {kMirrorRing, M};
+    } else {
+        return {kExactRing, M};
     }
 }
 
+/**
+ * Generate code to read a long delay line at a given delay. The delay line may not be generated yet
+ * (in recursive definitions), its layout only depends of its type and maximum delay (see getDelayLine).
+ */
+ValueInst* InstructionsCompiler::generateDelayAccess(const string& vname, Typed::VarType ctype, int mxd,
+                                                     ValueInst* delay)
+{
+    DelayLine line = getDelayLine(ctype, mxd);
+
+    if (line.fType == kMaskRing) {
+        FIRIndex index = (FIRIndex(InstBuilder::genLoadStructVar("IOTA")) - delay) & (line.fSize - 1);
+        return InstBuilder::genLoadArrayStructVar(vname, index);
+    } else {
+        string idx = subst("$0_idx", vname);
+        // Read position is idx + M - d, with a constant offset for fixed delays
+        Int32NumInst* num = dynamic_cast<Int32NumInst*>(delay);
+        if (num && num->fNum == 0) {
+            return InstBuilder::genLoadArrayStructVar(vname, InstBuilder::genLoadStructVar(idx));
+        } else if (num) {
+            auto pos = [&]() { return FIRIndex(InstBuilder::genLoadStructVar(idx)) + (line.fSize - num->fNum); };
+            if (line.fType == kMirrorRing) {
+                return InstBuilder::genLoadArrayStructVar(vname, pos());
+            } else {
+                ValueInst* wrap = InstBuilder::genGreaterEqual(pos(), InstBuilder::genInt32NumInst(line.fSize));
+                return InstBuilder::genLoadArrayStructVar(
+                    vname, InstBuilder::genSelect2Inst(wrap, pos() - line.fSize, pos()));
+            }
+        } else {
+            // Unlike with the mask, a variable delay out of [0, mxd] would read out of the buffer
+            FIRIndex pos = FIRIndex(InstBuilder::genLoadStructVar(idx)) + line.fSize - clampDelay(delay, mxd);
+            if (line.fType == kMirrorRing) {
+                return InstBuilder::genLoadArrayStructVar(vname, pos);
+            } else {
+                string rpos = gGlobal->getFreshID("iRead");
+                pushComputeDSPMethod(InstBuilder::genDecStackVar(rpos, InstBuilder::genInt32Typed(), pos));
+                ValueInst* wrap =
+                    InstBuilder::genGreaterEqual(InstBuilder::genLoadStackVar(rpos), InstBuilder::genInt32NumInst(line.fSize));
+                return InstBuilder::genLoadArrayStructVar(
+                    vname, InstBuilder::genSelect2Inst(wrap, FIRIndex(InstBuilder::genLoadStackVar(rpos)) - line.fSize,
+                                                       InstBuilder::genLoadStackVar(rpos)));
+            }
+        }
+    }
+}
+
+// Clamp a variable delay in [0, mxd], for delay lines which are not read with a mask
+ValueInst* InstructionsCompiler::clampDelay(ValueInst* delay, int mxd)
+{
+    vector<Typed::VarType> types = {Typed::kInt32, Typed::kInt32};
+    ValueInst* res = fContainer->pushFunction("max_i", Typed::kInt32, types, {delay, InstBuilder::genInt32NumInst(0)});
+    return fContainer->pushFunction("min_i", Typed::kInt32, types, {res, InstBuilder::genInt32NumInst(mxd)});
+}
+
 /**
  * Generate code for the delay mecchanism. The generated code depend of the
  * maximum delay attached to exp and the "less temporaries" switch
@@ -1858,8 +2325,38 @@ ValueInst* InstructionsCompiler::generateDelayLine(ValueInst* exp, Typed::VarTyp
         }
 
     } else {
-        // Generate code for a long delay : we use a ring buffer of size N = 2**x > mxd
-        int N = pow2limit(mxd + 1);
+        // Generate code for a long delay : we use a ring buffer (see getDelayLine)
+        DelayLine line = getDelayLine(ctype, mxd);
+
+        if (line.fType != kMaskRing) {
+            string idx = subst("$0_idx", vname);
+            int    M   = line.fSize;
+
+            // Per line index
+            pushDeclare(InstBuilder::genDecStructVar(idx, InstBuilder::genInt32Typed()));
+            pushClearMethod(InstBuilder::genStoreStructVar(idx, InstBuilder::genInt32NumInst(0)));
+
+            // Generates table init
+            pushClearMethod(generateInitArray(vname, ctype, (line.fType == kMirrorRing) ? 2 * M : M));
+
+            // Generate table use
+            pushComputeDSPMethod(InstBuilder::genStoreArrayStructVar(vname, InstBuilder::genLoadStructVar(idx), exp));
+            if (line.fType == kMirrorRing) {
+                FIRIndex index = FIRIndex(InstBuilder::genLoadStructVar(idx)) + M;
+                pushComputeDSPMethod(InstBuilder::genStoreArrayStructVar(
+                    vname, index, InstBuilder::genLoadArrayStructVar(vname, InstBuilder::genLoadStructVar(idx))));
+            }
+
+            // Move the index
+            FIRIndex   next = FIRIndex(InstBuilder::genLoadStructVar(idx)) + 1;
+            ValueInst* wrap = InstBuilder::genLessThan(next, InstBuilder::genInt32NumInst(M));
+            pushComputePostDSPMethod(InstBuilder::genStoreStructVar(
+                idx, InstBuilder::genSelect2Inst(wrap, FIRIndex(InstBuilder::genLoadStructVar(idx)) + 1,
+                                                 InstBuilder::genInt32NumInst(0))));
+            return exp;
+        }
+
+        int N = line.fSize;
 
         // We need an iota index
         ensureIotaCode();
@@ -54,12 +54,32 @@ class InstructionsCompiler : public virtual Garbageable {
 
     std::map<int, std::string> fIOTATable;  // Ensure IOTA base fixed delays are computed once
 
+    // Memory layout of the ring buffer of a long delay line (see getDelayLine)
+    enum DelayType { kMaskRing, kMirrorRing, kExactRing };
+    struct DelayLine {
+        DelayType fType;
+        int       fSize;  // Number of delayed values kept (power of 2 for kMaskRing, 'mxd + 1' otherwise)
+    };
+
+    std::map<Tree, int> fProfileKeys;  // Keys of the signals in a runtime profile (see getProfileKey)
+
     Tree         fUIRoot;
     Description* fDescription;
     bool         fLoadedIota;
 
+    // Control-rate decimation (see generateDecimated)
+    int                        fDecimation;       // Decimation factor, or 0 when everything runs at sample rate
+    BlockInst*                 fDecimatedCode;    // Code executed every 'fDecimation' samples
+    std::string                fDecimatedCounter; // Samples before the next execution of the decimated code
+    bool                       fInDecimatedCode;  // True when compiling the decimated code
+    std::map<Tree, ValueInst*> fDecimatedExp;     // Values of the decimated signals in the decimated code
+    std::map<Tree, bool>       fDecimatedSig;     // Memoized isDecimated
+    std::map<Tree, bool>       fUIDependentSig;   // Memoized isUIDependent
+
     void getTypedNames(::Type t, const string& prefix, Typed::VarType& ctype, string& vname);
 
+    int getProfileKey(Tree sig);
+
     bool     getCompiledExpression(Tree sig, InstType& cexp);
     InstType setCompiledExpression(Tree sig, const InstType& cexp);
 
@@ -102,11 +122,34 @@ class InstructionsCompiler : public virtual Garbageable {
     StatementInst* pushExtGlobalDeclare(StatementInst* inst) { return fContainer->pushExtGlobalDeclare(inst); }
 
     StatementInst* pushComputePreDSPMethod(StatementInst* inst) { return fContainer->pushComputePreDSPMethod(inst); }
-    StatementInst* pushComputeDSPMethod(StatementInst* inst) { return fContainer->pushComputeDSPMethod(inst); }
+    StatementInst* pushComputeDSPMethod(StatementInst* inst)
+    {
+        if (fInDecimatedCode) {
+            fDecimatedCode->pushBackInst(inst);
+            return inst;
+        } else {
+            return fContainer->pushComputeDSPMethod(inst);
+        }
+    }
     StatementInst* pushComputePostDSPMethod(StatementInst* inst) { return fContainer->pushComputePostDSPMethod(inst); }
 
     void ensureIotaCode();
 
+    bool       isSmoother(Tree rec, Tree& x, Tree& c);
+    bool       isDecimated(Tree sig);
+    ValueInst* generateDecimated(Tree sig);
+    ValueInst* generateSmoother(Tree x, Tree c);
+    ValueInst* isClearedState();
+    void       generateDecimatedInit();
+
+    DelayLine  getDelayLine(Typed::VarType ctype, int mxd);
+    ValueInst* generateDelayAccess(const string& vname, Typed::VarType ctype, int mxd, ValueInst* delay);
+    ValueInst* clampDelay(ValueInst* delay, int mxd);
+
+    bool isUIDependent(Tree sig);
+    bool isUIDependentAux(Tree sig, std::set<Tree>& visited, bool& changed);
+    bool hasUIDependentArg(Tree sig);
+
     int pow2limit(int x)
     {
         int n = 2;
@@ -149,7 +149,7 @@ class InstComplexityVisitor : public DispatchVisitor {
         inst->fThen->accept(&then_branch);
 
         InstComplexityVisitor else_branch;
-        inst->fThen->accept(&else_branch);
+        inst->fElse->accept(&else_branch);
 
         // Takes the max of both then/else branches
         if (then_branch.cost() > else_branch.cost()) {
@@ -162,6 +162,7 @@ class InstComplexityVisitor : public DispatchVisitor {
             fCast += then_branch.fCast;
             fSelect += then_branch.fSelect;
             fLoop += then_branch.fLoop;
+            fFunCall += then_branch.fFunCall;
         } else {
             fLoad += else_branch.fLoad;
             fStore += else_branch.fStore;
@@ -172,6 +173,7 @@ class InstComplexityVisitor : public DispatchVisitor {
             fCast += else_branch.fCast;
             fSelect += else_branch.fSelect;
             fLoop += else_branch.fLoop;
+            fFunCall += else_branch.fFunCall;
         }
     }
 
@@ -195,17 +197,20 @@ class InstComplexityVisitor : public DispatchVisitor {
         fLoad += visitor.fLoad;
         fStore += visitor.fStore;
         fBinop += visitor.fBinop;
+        fMathop += visitor.fMathop;
         fNumbers += visitor.fNumbers;
         fDeclare += visitor.fDeclare;
         fCast += visitor.fCast;
         fSelect += visitor.fSelect;
         fLoop += visitor.fLoop;
+        fFunCall += visitor.fFunCall;
     }
 
     int cost()
     {
-        // A polynom based on measured values
-        return 0;
+        // A linear model of the relative cost of operations : memory accesses, arithmetic and casts
+        // are counted as one, selects as two, and function calls (math functions especially) as ten
+        return fLoad + fStore + fBinop + fCast + 2 * fSelect + 10 * fFunCall;
     }
 };
 
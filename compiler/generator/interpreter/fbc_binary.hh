@@ -0,0 +1,436 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FBC_BINARY_H
+#define _FBC_BINARY_H
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "exception.hh"
+#include "interpreter_bytecode.hh"
+
+/*
+ Binary FBC format: a fixed size header followed by 8 bytes aligned sections, all in native endianness:
+
+ - a string table (NUL terminated strings, referenced by their byte offset, offset 0 is the empty string)
+ - the meta and UI items
+ - the code blocks, as ranges in the flat instruction array
+ - the flat instruction array, where branches are block indexes
+ - the int and real tables used by kBlockStoreInt and kBlockStoreReal
+
+ The header contains everything needed to check that the file can be used as is (magic, format and
+ interpreter versions, sample type size, endianness) and the sections are bounds checked, so that a
+ memory-mapped file can be directly decoded without any parsing.
+
+ Decoding still allocates the interpreter instructions and tables (the interpreter executes its own
+ instruction objects), so loading is not zero-copy: only the textual parsing is saved.
+*/
+
+#define FBC_BINARY_MAGIC "FAUSTFBC"
+#define FBC_BINARY_VERSION 1
+#define FBC_BINARY_ENDIAN 0x01020304
+
+struct FBCBinaryHeader {
+    char     fMagic[8];
+    uint32_t fFormatVersion;
+    uint32_t fFileVersion;
+    uint32_t fRealSize;
+    uint32_t fEndian;
+
+    // String table references
+    uint32_t fFaustVersion;
+    uint32_t fCompileOptions;
+    uint32_t fName;
+    uint32_t fSHAKey;
+
+    int32_t fOptLevel;
+    int32_t fNumInputs;
+    int32_t fNumOutputs;
+    int32_t fIntHeapSize;
+    int32_t fRealHeapSize;
+    int32_t fSoundHeapSize;
+    int32_t fSROffset;
+    int32_t fCountOffset;
+    int32_t fIOTAOffset;
+
+    // Root blocks: static_init, constants, reset_ui, clear, control, dsp
+    int32_t fRootBlocks[6];
+
+    // Sections (offset from the beginning of the buffer, and number of items)
+    uint32_t fStringsOffset;
+    uint32_t fStringsSize;
+    uint32_t fMetaOffset;
+    uint32_t fMetaCount;
+    uint32_t fUIOffset;
+    uint32_t fUICount;
+    uint32_t fBlocksOffset;
+    uint32_t fBlocksCount;
+    uint32_t fInstructionsOffset;
+    uint32_t fInstructionsCount;
+    uint32_t fIntTableOffset;
+    uint32_t fIntTableCount;
+    uint32_t fRealTableOffset;
+    uint32_t fRealTableCount;
+};
+
+struct FBCBinaryMeta {
+    uint32_t fKey;
+    uint32_t fValue;
+};
+
+template <class T>
+struct FBCBinaryUI {
+    T        fInit;
+    T        fMin;
+    T        fMax;
+    T        fStep;
+    int32_t  fOpcode;
+    int32_t  fOffset;
+    uint32_t fLabel;
+    uint32_t fKey;
+    uint32_t fValue;
+    uint32_t fPad;
+};
+
+struct FBCBinaryBlock {
+    uint32_t fFirst;
+    uint32_t fCount;
+};
+
+template <class T>
+struct FBCBinaryInstruction {
+    T        fRealValue;
+    int32_t  fOpcode;
+    int32_t  fIntValue;
+    int32_t  fOffset1;
+    int32_t  fOffset2;
+    int32_t  fBranch1;  // Block index or -1
+    int32_t  fBranch2;  // Block index or -1
+    uint32_t fName;
+    uint32_t fTableIndex;  // kBlockStoreInt/kBlockStoreReal values
+    uint32_t fTableSize;
+    uint32_t fPad;
+};
+
+template <class T>
+struct FBCBinaryWriter {
+    std::vector<char>                    fStrings;
+    std::map<std::string, uint32_t>      fStringMap;
+    std::vector<FBCBinaryMeta>           fMeta;
+    std::vector<FBCBinaryUI<T>>          fUI;
+    std::vector<FBCBinaryBlock>          fBlocks;
+    std::vector<FBCBinaryInstruction<T>> fInstructions;
+    std::vector<int32_t>                 fIntTable;
+    std::vector<T>                       fRealTable;
+
+    FBCBinaryWriter() { addString(""); }
+
+    uint32_t addString(const std::string& str)
+    {
+        auto it = fStringMap.find(str);
+        if (it != fStringMap.end()) return it->second;
+        uint32_t offset = uint32_t(fStrings.size());
+        fStrings.insert(fStrings.end(), str.begin(), str.end());
+        fStrings.push_back(0);
+        fStringMap[str] = offset;
+        return offset;
+    }
+
+    void addMetaBlock(FIRMetaBlockInstruction* block)
+    {
+        for (auto& it : block->fInstructions) {
+            fMeta.push_back({addString(it->fKey), addString(it->fValue)});
+        }
+    }
+
+    void addUIBlock(FIRUserInterfaceBlockInstruction<T>* block)
+    {
+        for (auto& it : block->fInstructions) {
+            FBCBinaryUI<T> ui;
+            memset(&ui, 0, sizeof(ui));
+            ui.fInit   = it->fInit;
+            ui.fMin    = it->fMin;
+            ui.fMax    = it->fMax;
+            ui.fStep   = it->fStep;
+            ui.fOpcode = it->fOpcode;
+            ui.fOffset = it->fOffset;
+            ui.fLabel  = addString(it->fLabel);
+            ui.fKey    = addString(it->fKey);
+            ui.fValue  = addString(it->fValue);
+            fUI.push_back(ui);
+        }
+    }
+
+    // Instructions of a block are contiguous, sub-blocks are added after them, so branch indexes are always
+    // greater than the index of the block that contains them
+    int32_t addCodeBlock(FBCBlockInstruction<T>* block)
+    {
+        int32_t  index = int32_t(fBlocks.size());
+        uint32_t first = uint32_t(fInstructions.size());
+        fBlocks.push_back({first, uint32_t(block->fInstructions.size())});
+        fInstructions.resize(first + block->fInstructions.size());
+
+        for (size_t i = 0; i < block->fInstructions.size(); i++) {
+            FBCBasicInstruction<T>* inst = block->fInstructions[i];
+            FBCBinaryInstruction<T> res;
+            memset(&res, 0, sizeof(res));
+            res.fRealValue = inst->fRealValue;
+            res.fOpcode    = FBCInstruction::getFileOpcode(inst->fOpcode);
+            res.fIntValue  = inst->fIntValue;
+            res.fOffset1   = inst->fOffset1;
+            res.fOffset2   = inst->fOffset2;
+            res.fName      = addString(inst->fName);
+            if (inst->fOpcode == FBCInstruction::kBlockStoreReal) {
+                auto& table     = static_cast<FIRBlockStoreRealInstruction<T>*>(inst)->fNumTable;
+                res.fTableIndex = uint32_t(fRealTable.size());
+                res.fTableSize  = uint32_t(table.size());
+                fRealTable.insert(fRealTable.end(), table.begin(), table.end());
+            } else if (inst->fOpcode == FBCInstruction::kBlockStoreInt) {
+                auto& table     = static_cast<FIRBlockStoreIntInstruction<T>*>(inst)->fNumTable;
+                res.fTableIndex = uint32_t(fIntTable.size());
+                res.fTableSize  = uint32_t(table.size());
+                fIntTable.insert(fIntTable.end(), table.begin(), table.end());
+            }
+            // kCondBranch loops on its own block (and does not own it)
+            res.fBranch1           = (inst->getBranch1()) ? addCodeBlock(inst->getBranch1()) : -1;
+            res.fBranch2           = (inst->getBranch2()) ? addCodeBlock(inst->getBranch2()) : -1;
+            fInstructions[first + i] = res;
+        }
+
+        return index;
+    }
+
+    template <class R>
+    static void writeSection(std::string& out, const std::vector<R>& items, uint32_t& offset, uint32_t& count)
+    {
+        out.resize((out.size() + 7) & ~size_t(7), 0);
+        offset = uint32_t(out.size());
+        count  = uint32_t(items.size());
+        if (items.size() > 0) out.append(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(R));
+    }
+
+    std::string write(FBCBinaryHeader& header)
+    {
+        memcpy(header.fMagic, FBC_BINARY_MAGIC, sizeof(header.fMagic));
+        header.fFormatVersion = FBC_BINARY_VERSION;
+        header.fFileVersion   = INTERP_FILE_VERSION;
+        header.fRealSize      = sizeof(T);
+        header.fEndian        = FBC_BINARY_ENDIAN;
+
+        std::string out(sizeof(FBCBinaryHeader), 0);
+        writeSection(out, fStrings, header.fStringsOffset, header.fStringsSize);
+        writeSection(out, fMeta, header.fMetaOffset, header.fMetaCount);
+        writeSection(out, fUI, header.fUIOffset, header.fUICount);
+        writeSection(out, fBlocks, header.fBlocksOffset, header.fBlocksCount);
+        writeSection(out, fInstructions, header.fInstructionsOffset, header.fInstructionsCount);
+        writeSection(out, fIntTable, header.fIntTableOffset, header.fIntTableCount);
+        writeSection(out, fRealTable, header.fRealTableOffset, header.fRealTableCount);
+        memcpy(&out[0], &header, sizeof(FBCBinaryHeader));
+        return out;
+    }
+};
+
+template <class T>
+struct FBCBinaryReader {
+    const char*     fBuffer;
+    size_t          fSize;
+    FBCBinaryHeader fHeader;
+    int32_t         fNextBlock;
+
+    static bool isBinary(const char* buffer, size_t size)
+    {
+        return size >= sizeof(FBCBinaryHeader) && memcmp(buffer, FBC_BINARY_MAGIC, 8) == 0;
+    }
+
+    // Returns the size of the sample type of a binary buffer (0 if not a binary FBC buffer)
+    static int getRealSize(const char* buffer, size_t size)
+    {
+        if (!isBinary(buffer, size)) return 0;
+        FBCBinaryHeader header;
+        memcpy(&header, buffer, sizeof(FBCBinaryHeader));
+        return int(header.fRealSize);
+    }
+
+    FBCBinaryReader(const char* buffer, size_t size) : fBuffer(buffer), fSize(size), fNextBlock(0)
+    {
+        if (!isBinary(buffer, size)) {
+            throw faustexception("ERROR : unrecognized binary interpreter file format\n");
+        }
+        memcpy(&fHeader, buffer, sizeof(FBCBinaryHeader));
+        if (fHeader.fEndian != FBC_BINARY_ENDIAN || fHeader.fFormatVersion != FBC_BINARY_VERSION) {
+            throw faustexception("ERROR : binary interpreter file format version or endianness not supported\n");
+        }
+        if (fHeader.fFileVersion != INTERP_FILE_VERSION) {
+            std::stringstream error;
+            error << "ERROR : interpreter file format version '" << fHeader.fFileVersion
+                  << "' different from compiled one '" << INTERP_FILE_VERSION << "'" << std::endl;
+            throw faustexception(error.str());
+        }
+        if (fHeader.fRealSize != sizeof(T)) {
+            throw faustexception("ERROR : binary interpreter file has a different sample type\n");
+        }
+        checkSection(fHeader.fStringsOffset, fHeader.fStringsSize, 1);
+        checkSection(fHeader.fMetaOffset, fHeader.fMetaCount, sizeof(FBCBinaryMeta));
+        checkSection(fHeader.fUIOffset, fHeader.fUICount, sizeof(FBCBinaryUI<T>));
+        checkSection(fHeader.fBlocksOffset, fHeader.fBlocksCount, sizeof(FBCBinaryBlock));
+        checkSection(fHeader.fInstructionsOffset, fHeader.fInstructionsCount, sizeof(FBCBinaryInstruction<T>));
+        checkSection(fHeader.fIntTableOffset, fHeader.fIntTableCount, sizeof(int32_t));
+        checkSection(fHeader.fRealTableOffset, fHeader.fRealTableCount, sizeof(T));
+        if (fHeader.fStringsSize == 0 || fBuffer[fHeader.fStringsOffset + fHeader.fStringsSize - 1] != 0) {
+            throwCorrupted();
+        }
+    }
+
+    static void throwCorrupted() { throw faustexception("ERROR : corrupted binary interpreter file\n"); }
+
+    void checkSection(uint32_t offset, uint32_t count, size_t item_size)
+    {
+        if (offset < sizeof(FBCBinaryHeader) || offset > fSize || uint64_t(count) * item_size > fSize - offset) {
+            throwCorrupted();
+        }
+    }
+
+    // Sections are aligned in the file, but the buffer itself may not be, so items are copied
+    template <class R>
+    R getItem(uint32_t offset, uint32_t index)
+    {
+        R item;
+        memcpy(&item, fBuffer + offset + size_t(index) * sizeof(R), sizeof(R));
+        return item;
+    }
+
+    std::string getString(uint32_t offset)
+    {
+        if (offset >= fHeader.fStringsSize) throwCorrupted();
+        return std::string(fBuffer + fHeader.fStringsOffset + offset);
+    }
+
+    FIRMetaBlockInstruction* readMetaBlock()
+    {
+        FIRMetaBlockInstruction* block = new FIRMetaBlockInstruction();
+        try {
+            for (uint32_t i = 0; i < fHeader.fMetaCount; i++) {
+                FBCBinaryMeta meta = getItem<FBCBinaryMeta>(fHeader.fMetaOffset, i);
+                block->push(new FIRMetaInstruction(getString(meta.fKey), getString(meta.fValue)));
+            }
+        } catch (...) {
+            delete block;
+            throw;
+        }
+        return block;
+    }
+
+    FIRUserInterfaceBlockInstruction<T>* readUIBlock()
+    {
+        FIRUserInterfaceBlockInstruction<T>* block = new FIRUserInterfaceBlockInstruction<T>();
+        try {
+            for (uint32_t i = 0; i < fHeader.fUICount; i++) {
+                FBCBinaryUI<T> ui = getItem<FBCBinaryUI<T>>(fHeader.fUIOffset, i);
+                block->push(new FIRUserInterfaceInstruction<T>(FBCInstruction::Opcode(ui.fOpcode), ui.fOffset,
+                                                               getString(ui.fLabel), getString(ui.fKey),
+                                                               getString(ui.fValue), ui.fInit, ui.fMin, ui.fMax,
+                                                               ui.fStep));
+            }
+        } catch (...) {
+            delete block;
+            throw;
+        }
+        return block;
+    }
+
+    FBCBlockInstruction<T>* readCodeBlock(int32_t index)
+    {
+        // Blocks are read in the order they were written, so that a corrupted file cannot share or loop on blocks
+        if (index != fNextBlock++ || uint32_t(index) >= fHeader.fBlocksCount) throwCorrupted();
+        FBCBinaryBlock block = getItem<FBCBinaryBlock>(fHeader.fBlocksOffset, index);
+        if (block.fFirst > fHeader.fInstructionsCount || block.fCount > fHeader.fInstructionsCount - block.fFirst) {
+            throwCorrupted();
+        }
+
+        FBCBlockInstruction<T>* code_block = new FBCBlockInstruction<T>();
+        try {
+            code_block->fInstructions.reserve(block.fCount);
+            for (uint32_t i = 0; i < block.fCount; i++) {
+                code_block->push(readCodeInstruction(block.fFirst + i, code_block));
+            }
+        } catch (...) {
+            delete code_block;
+            throw;
+        }
+        return code_block;
+    }
+
+    FBCBasicInstruction<T>* readCodeInstruction(uint32_t index, FBCBlockInstruction<T>* block)
+    {
+        FBCBinaryInstruction<T> inst   = getItem<FBCBinaryInstruction<T>>(fHeader.fInstructionsOffset, index);
+        FBCInstruction::Opcode  opcode = FBCInstruction::Opcode(inst.fOpcode);
+        if (inst.fOpcode < 0 || inst.fOpcode > FBCInstruction::kNop) throwCorrupted();
+
+        if (opcode == FBCInstruction::kBlockStoreReal) {
+            if (inst.fTableIndex > fHeader.fRealTableCount ||
+                inst.fTableSize > fHeader.fRealTableCount - inst.fTableIndex) {
+                throwCorrupted();
+            }
+            std::vector<T> values(inst.fTableSize);
+            if (inst.fTableSize > 0) {
+                memcpy(values.data(), fBuffer + fHeader.fRealTableOffset + size_t(inst.fTableIndex) * sizeof(T),
+                       inst.fTableSize * sizeof(T));
+            }
+            return new FIRBlockStoreRealInstruction<T>(opcode, inst.fOffset1, inst.fOffset2, values);
+        } else if (opcode == FBCInstruction::kBlockStoreInt) {
+            if (inst.fTableIndex > fHeader.fIntTableCount ||
+                inst.fTableSize > fHeader.fIntTableCount - inst.fTableIndex) {
+                throwCorrupted();
+            }
+            std::vector<int> values(inst.fTableSize);
+            if (inst.fTableSize > 0) {
+                memcpy(values.data(), fBuffer + fHeader.fIntTableOffset + size_t(inst.fTableIndex) * sizeof(int32_t),
+                       inst.fTableSize * sizeof(int32_t));
+            }
+            return new FIRBlockStoreIntInstruction<T>(opcode, inst.fOffset1, inst.fOffset2, values);
+        } else {
+            std::string             name    = getString(inst.fName);
+            FBCBlockInstruction<T>* branch1 = nullptr;
+            FBCBlockInstruction<T>* branch2 = nullptr;
+            if (opcode == FBCInstruction::kCondBranch) {
+                // Special case for loops
+                branch1 = block;
+            } else if (inst.fBranch1 >= 0) {
+                branch1 = readCodeBlock(inst.fBranch1);
+            }
+            try {
+                if (inst.fBranch2 >= 0) branch2 = readCodeBlock(inst.fBranch2);
+            } catch (...) {
+                if (branch1 != block) delete branch1;
+                throw;
+            }
+            return new FBCBasicInstruction<T>(opcode, name, inst.fIntValue, inst.fRealValue,
+                                              inst.fOffset1, inst.fOffset2, branch1, branch2);
+        }
+    }
+};
+
+#endif
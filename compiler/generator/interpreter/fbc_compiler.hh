@@ -24,6 +24,10 @@
 
 //#define MIR 1
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #include "fbc_interpreter.hh"
 #ifdef MIR
 #include "fbc_mir_compiler.hh"
@@ -31,43 +35,93 @@
 #include "fbc_llvm_compiler.hh"
 #endif
 
-// FBC compiler
+// Compilers use a global context, so blocks are compiled one at a time (this also protects the compiled blocks maps)
+inline std::mutex& getFBCCompilerLock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+/*
+ FBC compiler: the 'DSP' compute block is compiled when the executor is created.
+
+ In tiered mode, the block is compiled in a background thread and interpreted meanwhile, so that the DSP
+ produces sound immediately. The compiled function is then used at the next ExecuteBlock call, that is at a
+ buffer boundary. Since both versions use the same heaps, the DSP state is kept.
+*/
 template <class T>
 class FBCCompiler : public FBCInterpreter<T,0> {
    public:
     typedef typename std::map<FBCBlockInstruction<T>*, FBCExecuteFun<T>*>           CompiledBlocksType;
     typedef typename std::map<FBCBlockInstruction<T>*, FBCExecuteFun<T>*>::iterator CompiledBlocksTypeIT;
 
-    FBCCompiler(interpreter_dsp_factory_aux<T,0>* factory, CompiledBlocksType* map) : FBCInterpreter<T,0>(factory)
+    FBCCompiler(interpreter_dsp_factory_aux<T,0>* factory, CompiledBlocksType* map, bool tiered = false)
+        : FBCInterpreter<T,0>(factory), fTieredBlock(nullptr), fTieredFun(nullptr)
     {
         fCompiledBlocks = map;
 
         // FBC blocks compilation
         //CompileBlock(factory->fComputeBlock);
-        CompileBlock(factory->fComputeDSPBlock);
+        if (tiered) {
+            fTieredBlock   = factory->fComputeDSPBlock;
+            fCompileThread = std::thread([this]() {
+                try {
+                    fTieredFun.store(CompileBlock(fTieredBlock), std::memory_order_release);
+                } catch (faustexception& e) {
+                    // Keep on interpreting the block
+                    std::cerr << e.Message();
+                }
+            });
+        } else {
+            fBlocks[factory->fComputeDSPBlock] = CompileBlock(factory->fComputeDSPBlock);
+        }
     }
 
-    virtual ~FBCCompiler() {}
+    virtual ~FBCCompiler()
+    {
+        if (fCompileThread.joinable()) {
+            fCompileThread.join();
+        }
+    }
 
     void ExecuteBlock(FBCBlockInstruction<T>* block, bool compile)
     {
-        if (compile && fCompiledBlocks->find(block) == fCompiledBlocks->end()) {
-            CompileBlock(block);
+        // Tiered block: interpreted until compiled
+        if (block == fTieredBlock) {
+            FBCExecuteFun<T>* fun = fTieredFun.load(std::memory_order_acquire);
+            if (fun) {
+                fun->Execute(this->fIntHeap, this->fRealHeap, this->fInputs, this->fOutputs);
+            } else {
+                FBCInterpreter<T,0>::ExecuteBlock(block);
+            }
+            return;
         }
 
         // The 'DSP' compute block only is compiled..
-        if (fCompiledBlocks->find(block) != fCompiledBlocks->end()) {
-            ((*fCompiledBlocks)[block])->Execute(this->fIntHeap, this->fRealHeap, this->fInputs, this->fOutputs);
+        CompiledBlocksTypeIT it = fBlocks.find(block);
+        if (it == fBlocks.end() && compile) {
+            it = fBlocks.insert(std::make_pair(block, CompileBlock(block))).first;
+        }
+        if (it != fBlocks.end()) {
+            it->second->Execute(this->fIntHeap, this->fRealHeap, this->fInputs, this->fOutputs);
         } else {
             FBCInterpreter<T,0>::ExecuteBlock(block);
         }
     }
 
    protected:
+    // Shared by all instances of the factory, only accessed with getFBCCompilerLock() held
     CompiledBlocksType* fCompiledBlocks;
+    // Blocks already compiled for this instance, read without lock in ExecuteBlock
+    CompiledBlocksType  fBlocks;
+
+    FBCBlockInstruction<T>*        fTieredBlock;
+    std::atomic<FBCExecuteFun<T>*> fTieredFun;
+    std::thread                    fCompileThread;
 
-    void CompileBlock(FBCBlockInstruction<T>* block)
+    FBCExecuteFun<T>* CompileBlock(FBCBlockInstruction<T>* block)
     {
+        std::lock_guard<std::mutex> lock(getFBCCompilerLock());
         if (fCompiledBlocks->find(block) == fCompiledBlocks->end()) {
         #ifdef MIR
             // Test with interp/MIR compiler
@@ -79,6 +133,7 @@ class FBCCompiler : public FBCInterpreter<T,0> {
         } else {
             // std::cout << "FBCCompiler: reuse compiled block" << std::endl;
         }
+        return (*fCompiledBlocks)[block];
     }
 };
 
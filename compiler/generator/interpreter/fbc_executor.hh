@@ -22,9 +22,77 @@
 #ifndef _FBC_EXECUTOR_H
 #define _FBC_EXECUTOR_H
 
+#include <algorithm>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "dsp_profile.hh"
 #include "faust/gui/CGlue.h"
 #include "interpreter_bytecode.hh"
 
+/*
+ Heap cells written by the 'static init' block, that is the tables and the state of the sub-containers filling them.
+ The segment is computed once by the factory. The tables placed at the end of the heaps can be shared: they are then
+ only read in the segment, and are not part of the instance heaps anymore. The other cells are copied in each instance.
+*/
+template <class T>
+struct FBCClassSegment {
+    // Heaps holding the segment values, other cells are unused
+    std::vector<int> fIntHeap;
+    std::vector<T>   fRealHeap;
+
+    // Cells of the segment
+    std::vector<bool> fIntCells;
+    std::vector<bool> fRealCells;
+
+    // Segment as [begin, end) runs
+    std::vector<std::pair<int, int>> fIntRuns;
+    std::vector<std::pair<int, int>> fRealRuns;
+
+    // The cells from 'int_offset' and 'real_offset' are shared, so not copied anymore
+    void share(int int_offset, int real_offset)
+    {
+        shareRuns(fIntRuns, int_offset);
+        shareRuns(fRealRuns, real_offset);
+    }
+
+    bool isIntCell(int offset) const { return offset >= 0 && offset < int(fIntCells.size()) && fIntCells[offset]; }
+    bool isRealCell(int offset) const { return offset >= 0 && offset < int(fRealCells.size()) && fRealCells[offset]; }
+
+    // Copy the segment in the heaps of an instance
+    void copy(int* int_heap, T* real_heap) const
+    {
+        for (auto& it : fIntRuns) {
+            memcpy(&int_heap[it.first], &fIntHeap[it.first], sizeof(int) * (it.second - it.first));
+        }
+        for (auto& it : fRealRuns) {
+            memcpy(&real_heap[it.first], &fRealHeap[it.first], sizeof(T) * (it.second - it.first));
+        }
+    }
+
+    static void shareRuns(std::vector<std::pair<int, int>>& runs, int offset)
+    {
+        std::vector<std::pair<int, int>> res;
+        for (auto& it : runs) {
+            if (it.first < offset) res.push_back(std::make_pair(it.first, std::min(it.second, offset)));
+        }
+        runs = res;
+    }
+
+    static void addRuns(const std::vector<bool>& cells, std::vector<std::pair<int, int>>& runs)
+    {
+        int size = int(cells.size());
+        for (int i = 0; i < size; i++) {
+            if (cells[i]) {
+                int begin = i;
+                while (i < size && cells[i]) i++;
+                runs.push_back(std::make_pair(begin, i));
+            }
+        }
+    }
+};
+
 template <class T>
 struct FBCExecutor {
     
@@ -34,9 +102,16 @@ struct FBCExecutor {
     virtual void setIntValue(int offset, int value) {}
     virtual int  getIntValue(int offset) { return -1; }
 
+    // Direct access to the heaps, nullptr if the executor does not use them
+    virtual int* getIntHeap() { return nullptr; }
+    virtual T*   getRealHeap() { return nullptr; }
+
     virtual void setInput(int offset, T* buffer) {}
     virtual void setOutput(int offset, T* buffer) {}
 
+    // Record the executed 'select' branches in the profile, if the executor supports it
+    virtual bool setProfile(DSPProfile* profile) { return false; }
+
     virtual ~FBCExecutor() {}
 
     virtual void dumpMemory(FBCBlockInstruction<T>* block, const std::string& name, const std::string& filename) {}
@@ -66,12 +66,21 @@ class FBCInterpreter : public FBCExecutor<T> {
     int*        fIntHeap;
     T*          fRealHeap;
     Soundfile** fSoundHeap;
+    int         fIntHeapSize;
+    int         fRealHeapSize;
+
+    // Read by the class segment lookups: the segment of the factory when the tables are shared, the heaps otherwise
+    const int* fClassIntHeap;
+    const T*   fClassRealHeap;
 
     T** fInputs;
     T** fOutputs;
 
     std::map<int, long long> fRealStats;
 
+    // Branches taken by the 'select' instructions (keyed by the instruction fIntValue), when profiling
+    DSPProfile* fProfile;
+
     /*
      Keeps the latest TRACE_STACK_SIZE executed instructions, to be displayed when an error occurs.
      */
@@ -553,7 +562,15 @@ class FBCInterpreter : public FBCExecutor<T> {
             &&do_kLoop, &&do_kReturn,
 
             // Select/if
-            &&do_kIf, &&do_kSelectReal, &&do_kSelectInt, &&do_kCondBranch
+            &&do_kIf, &&do_kSelectReal, &&do_kSelectInt, &&do_kCondBranch,
+
+            // Superinstructions
+            &&do_kLoadInputHeap, &&do_kStoreOutputHeap, &&do_kStoreIndexedRealHeap, &&do_kLoadIndexedRealStoreReal,
+            &&do_kSubIntValueInvertANDInt, &&do_kAddIntValueStoreInt, &&do_kAddRealStoreReal,
+            &&do_kMultRealHeapAddReal, &&do_kMultRealHeapAddRealStack, &&do_kMultRealValueAddRealStack,
+
+            // Class segment
+            &&do_kLoadIndexedClassReal, &&do_kLoadIndexedClassInt
 
         };
 
@@ -737,6 +754,18 @@ class FBCInterpreter : public FBCExecutor<T> {
         dispatchNextScal();
     }
 
+    do_kLoadIndexedClassReal : {
+        int offset = popInt();
+        pushReal(it, fClassRealHeap[(*it)->fOffset1 + offset]);
+        dispatchNextScal();
+    }
+
+    do_kLoadIndexedClassInt : {
+        int offset = popInt();
+        pushInt(fClassIntHeap[(*it)->fOffset1 + offset]);
+        dispatchNextScal();
+    }
+
     do_kStoreIndexedReal : {
         int offset = popInt();
         if (TRACE > 0) {
@@ -2367,7 +2396,10 @@ class FBCInterpreter : public FBCExecutor<T> {
         // Keep next instruction
         saveReturnScal();
 
-        if (popInt()) {
+        int cond = popInt();
+        if (fProfile && (*it)->fIntValue) fProfile->addSelect((*it)->fIntValue, cond);
+
+        if (cond) {
             // Execute new block
             assertInterp((*it)->fBranch1);
             dispatchBranch1Scal();
@@ -2384,7 +2416,10 @@ class FBCInterpreter : public FBCExecutor<T> {
         // Keep next instruction
         saveReturnScal();
 
-        if (popInt()) {
+        int cond = popInt();
+        if (fProfile && (*it)->fIntValue) fProfile->addSelect((*it)->fIntValue, cond);
+
+        if (cond) {
             // Execute new block
             assertInterp((*it)->fBranch1);
             dispatchBranch1Scal();
@@ -2421,13 +2456,74 @@ class FBCInterpreter : public FBCExecutor<T> {
         dispatchBranch1Scal();
     }
 
+        //-------------------
+        // Superinstructions
+        //-------------------
+
+        // Only produced by the optimizer, so never executed in trace mode
+
+    do_kLoadInputHeap : {
+        pushReal(it, fInputs[(*it)->fOffset1][fIntHeap[(*it)->fOffset2]]);
+        dispatchNextScal();
+    }
+
+    do_kStoreOutputHeap : {
+        fOutputs[(*it)->fOffset1][fIntHeap[(*it)->fOffset2]] = popReal(it);
+        dispatchNextScal();
+    }
+
+    do_kStoreIndexedRealHeap : {
+        fRealHeap[(*it)->fOffset1 + fIntHeap[(*it)->fIntValue]] = popReal(it);
+        dispatchNextScal();
+    }
+
+    do_kLoadIndexedRealStoreReal : {
+        int offset = popInt();
+        fRealHeap[(*it)->fIntValue] = fRealHeap[(*it)->fOffset1 + offset];
+        dispatchNextScal();
+    }
+
+    do_kSubIntValueInvertANDInt : {
+        pushInt((*it)->fOffset2 & (fIntHeap[(*it)->fOffset1] - (*it)->fIntValue));
+        dispatchNextScal();
+    }
+
+    do_kAddIntValueStoreInt : {
+        fIntHeap[(*it)->fOffset2] = (*it)->fIntValue + fIntHeap[(*it)->fOffset1];
+        dispatchNextScal();
+    }
+
+    do_kAddRealStoreReal : {
+        T v1 = popReal(it);
+        T v2 = popReal(it);
+        fRealHeap[(*it)->fOffset1] = v1 + v2;
+        dispatchNextScal();
+    }
+
+    do_kMultRealHeapAddReal : {
+        T v1 = popReal(it);
+        pushReal(it, (fRealHeap[(*it)->fOffset1] * fRealHeap[(*it)->fOffset2]) + v1);
+        dispatchNextScal();
+    }
+
+    do_kMultRealHeapAddRealStack : {
+        pushReal(it, fRealHeap[(*it)->fIntValue] + (fRealHeap[(*it)->fOffset1] * fRealHeap[(*it)->fOffset2]));
+        dispatchNextScal();
+    }
+
+    do_kMultRealValueAddRealStack : {
+        pushReal(it, fRealHeap[(*it)->fOffset2] + ((*it)->fRealValue * fRealHeap[(*it)->fOffset1]));
+        dispatchNextScal();
+    }
+
     end:
         // Check stack coherency
         assertInterp(real_stack_index == 0 && int_stack_index == 0 && sound_stack_index == 0);
     }
 
    public:
-    FBCInterpreter(interpreter_dsp_factory_aux<T, TRACE>* factory)
+    // With 'full_heaps', the instance heaps also hold the shared tables
+    FBCInterpreter(interpreter_dsp_factory_aux<T, TRACE>* factory, bool full_heaps = false)
     {
         /*
         std::cout << "FBCInterpreter :"
@@ -2437,17 +2533,20 @@ class FBCInterpreter : public FBCExecutor<T> {
                 << " count_offset " << count_offset << std::endl;
         */
 
-        fFactory = factory;
+        fFactory      = factory;
+        fProfile      = nullptr;
+        fIntHeapSize  = (full_heaps) ? fFactory->fIntHeapSize : fFactory->fIntClassOffset;
+        fRealHeapSize = (full_heaps) ? fFactory->fRealHeapSize : fFactory->fRealClassOffset;
 
         if (fFactory->getMemoryManager()) {
-            fRealHeap  = static_cast<T*>(fFactory->allocate(sizeof(T) * fFactory->fRealHeapSize));
-            fIntHeap   = static_cast<int*>(fFactory->allocate(sizeof(T) * fFactory->fIntHeapSize));
+            fRealHeap  = static_cast<T*>(fFactory->allocate(sizeof(T) * fRealHeapSize));
+            fIntHeap   = static_cast<int*>(fFactory->allocate(sizeof(T) * fIntHeapSize));
             fSoundHeap = static_cast<Soundfile**>(fFactory->allocate(sizeof(Soundfile*) * fFactory->fSoundHeapSize));
             fInputs    = static_cast<T**>(fFactory->allocate(sizeof(T*) * fFactory->fNumInputs));
             fOutputs   = static_cast<T**>(fFactory->allocate(sizeof(T*) * fFactory->fNumOutputs));
         } else {
-            fRealHeap  = new T[fFactory->fRealHeapSize];
-            fIntHeap   = new int[fFactory->fIntHeapSize];
+            fRealHeap  = new T[fRealHeapSize];
+            fIntHeap   = new int[fIntHeapSize];
             fSoundHeap = new Soundfile*[fFactory->fSoundHeapSize];
             fInputs    = new T*[fFactory->fNumInputs];
             fOutputs   = new T*[fFactory->fNumOutputs];
@@ -2458,13 +2557,16 @@ class FBCInterpreter : public FBCExecutor<T> {
         // std::cout << "fIntHeapSize = " << fFactory->fIntHeapSize << std::endl;
 
         // Initialise HEAP with special values to detect incorrect Load access
-        for (int i = 0; i < fFactory->fRealHeapSize; i++) {
+        for (int i = 0; i < fRealHeapSize; i++) {
             fRealHeap[i] = T(DUMMY_REAL);
         }
-        for (int i = 0; i < fFactory->fIntHeapSize; i++) {
+        for (int i = 0; i < fIntHeapSize; i++) {
             fIntHeap[i] = DUMMY_INT;
         }
 
+        fClassIntHeap  = (fIntHeapSize < fFactory->fIntHeapSize) ? fFactory->fClassSegment->fIntHeap.data() : fIntHeap;
+        fClassRealHeap = (fRealHeapSize < fFactory->fRealHeapSize) ? fFactory->fClassSegment->fRealHeap.data() : fRealHeap;
+
         fRealStats[INTEGER_OVERFLOW] = 0;
         fRealStats[DIV_BY_ZERO]      = 0;
         fRealStats[FP_INFINITE]      = 0;
@@ -2497,13 +2599,13 @@ class FBCInterpreter : public FBCExecutor<T> {
         std::ofstream out(filename);
         out << "DSP name: " << name << std::endl;
 
-        out << "REAL memory: " << fFactory->fRealHeapSize << "\n";
-        for (int i = 0; i < fFactory->fRealHeapSize; i++) {
+        out << "REAL memory: " << fRealHeapSize << "\n";
+        for (int i = 0; i < fRealHeapSize; i++) {
             out << "mem: " << i << " " << fRealHeap[i] << std::endl;
         }
 
-        out << "INT memory: " << fFactory->fIntHeapSize << "\n";
-        for (int i = 0; i < fFactory->fIntHeapSize; i++) {
+        out << "INT memory: " << fIntHeapSize << "\n";
+        for (int i = 0; i < fIntHeapSize; i++) {
             out << "mem: " << i << " " << fIntHeap[i] << std::endl;
         }
     }
@@ -2511,6 +2613,15 @@ class FBCInterpreter : public FBCExecutor<T> {
     void setIntValue(int offset, int value) { fIntHeap[offset] = value; }
     int  getIntValue(int offset) { return fIntHeap[offset]; }
 
+    int* getIntHeap() { return fIntHeap; }
+    T*   getRealHeap() { return fRealHeap; }
+
+    bool setProfile(DSPProfile* profile)
+    {
+        fProfile = profile;
+        return true;
+    }
+
     virtual void setInput(int input, T* buffer) { fInputs[input] = buffer; }
     virtual void setOutput(int output, T* buffer) { fOutputs[output] = buffer; }
 };
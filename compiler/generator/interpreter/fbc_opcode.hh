@@ -340,6 +340,22 @@ struct FBCInstruction {
         kSelectInt,
         kCondBranch,
 
+        // Superinstructions : fused sequences of frequent opcodes
+        kLoadInputHeap,
+        kStoreOutputHeap,
+        kStoreIndexedRealHeap,
+        kLoadIndexedRealStoreReal,
+        kSubIntValueInvertANDInt,
+        kAddIntValueStoreInt,
+        kAddRealStoreReal,
+        kMultRealHeapAddReal,
+        kMultRealHeapAddRealStack,
+        kMultRealValueAddRealStack,
+
+        // Table lookups in the class segment shared by all instances (only produced when the factory is loaded)
+        kLoadIndexedClassReal,
+        kLoadIndexedClassInt,
+
         // User Interface
         kOpenVerticalBox,
         kOpenHorizontalBox,
@@ -366,7 +382,7 @@ struct FBCInstruction {
     {
         return ((opt == kRealValue)
 
-                || (opt == kLoadReal) || (opt == kLoadIndexedReal) || (opt == kLoadInput)
+                || (opt == kLoadReal) || (opt == kLoadIndexedReal) || (opt == kLoadIndexedClassReal) || (opt == kLoadInput)
 
                 || (opt == kCastReal) || (opt == kBitcastReal)
 
@@ -391,6 +407,13 @@ struct FBCInstruction {
     static bool isExtendedUnaryMath(Opcode opt) { return (opt >= kAbs) && (opt <= kTanhf); }
     static bool isExtendedBinaryMath(Opcode opt) { return (opt >= kAtan2f) && (opt <= kMinf); }
     static bool isChoice(Opcode opt) { return (opt == kIf) || (opt == kSelectReal) || (opt == kSelectInt); }
+
+    // The class segment lookups are only valid in the loaded factory, so they are written as standard lookups
+    static Opcode getFileOpcode(Opcode opt)
+    {
+        return (opt == kLoadIndexedClassReal) ? kLoadIndexedReal
+                                              : ((opt == kLoadIndexedClassInt) ? kLoadIndexedInt : opt);
+    }
 };
 
 static std::string gFBCInstructionTable[] = {
@@ -478,6 +501,14 @@ static std::string gFBCInstructionTable[] = {
     // Select/if
     "kIf", "kSelectReal", "kSelectInt", "kCondBranch",
 
+    // Superinstructions
+    "kLoadInputHeap", "kStoreOutputHeap", "kStoreIndexedRealHeap", "kLoadIndexedRealStoreReal",
+    "kSubIntValueInvertANDInt", "kAddIntValueStoreInt", "kAddRealStoreReal", "kMultRealHeapAddReal",
+    "kMultRealHeapAddRealStack", "kMultRealValueAddRealStack",
+
+    // Class segment
+    "kLoadIndexedClassReal", "kLoadIndexedClassInt",
+
     // User Interface
     "kOpenVerticalBox", "kOpenHorizontalBox", "kOpenTabBox", "kCloseBox", "kAddButton", "kAddChecButton",
     "kAddHorizontalSlider", "kAddVerticalSlider", "kAddNumEntry", "kAddSoundfile", "kAddHorizontalBargraph",
@@ -485,6 +516,6 @@ static std::string gFBCInstructionTable[] = {
 
     "kNop"};
 
-#define INTERP_FILE_VERSION 7
+#define INTERP_FILE_VERSION 9
 
 #endif
@@ -0,0 +1,1309 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef _FBC_REG_INTERPRETER_H
+#define _FBC_REG_INTERPRETER_H
+
+#include <cmath>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "fbc_interpreter.hh"
+
+/*
+ Register based interpreter.
+
+ The stack/tree shaped FBC code of a block is lowered in a flat three-address code: each instruction directly
+ references its operands (heap locations, constants or registers) and writes its result in a heap location or
+ a register. Loops, 'if' and 'select' are lowered in jumps, so the code is executed without any stack.
+
+ The FBC stacks are simulated while lowering:
+ - 'load' instructions do not produce code, the heap location is directly used as an operand by the consumer
+ - a value produced at a given depth of the simulated stack is written in the register of that depth
+ - a value produced and then stored in the heap is directly written in the heap location
+
+ Operands are resolved as pointers in the heaps of the DSP instance, so blocks are lowered for each instance,
+ from the non-optimized FBC code kept by the factory (only the 'compute' blocks are lowered).
+*/
+
+#define REG_STACK_SIZE 512
+
+template <class T>
+struct FBCRegInstruction {
+    enum Opcode {
+
+        // Moves
+        kMoveReal,
+        kMoveInt,
+
+        // Real math
+        kAddReal,
+        kSubReal,
+        kMultReal,
+        kDivReal,
+        kRemReal,
+        kMaxReal,
+        kMinReal,
+        kAbsReal,
+        kFunReal1,
+        kFunReal2,
+
+        // Int math
+        kAddInt,
+        kSubInt,
+        kMultInt,
+        kDivInt,
+        kRemInt,
+        kLshInt,
+        kRshInt,
+        kANDInt,
+        kORInt,
+        kXORInt,
+        kMaxInt,
+        kMinInt,
+        kAbsInt,
+
+        // Comparison
+        kGTInt,
+        kLTInt,
+        kGEInt,
+        kLEInt,
+        kEQInt,
+        kNEInt,
+        kGTReal,
+        kLTReal,
+        kGEReal,
+        kLEReal,
+        kEQReal,
+        kNEReal,
+
+        // Cast/Bitcast
+        kCastReal,
+        kCastInt,
+        kBitcastInt,
+        kBitcastReal,
+
+        // Memory
+        kLoadIndexedReal,
+        kLoadIndexedInt,
+        kStoreIndexedReal,
+        kStoreIndexedInt,
+        kBlockStoreReal,
+        kBlockStoreInt,
+        kBlockShiftReal,
+        kBlockShiftInt,
+        kLoadInput,
+        kStoreOutput,
+
+        // Control
+        kJump,
+        kJumpIfZero,
+        kJumpIfNotZero,
+        kReturn
+    };
+
+    Opcode fOpcode;
+
+    // Address of the opcode code in the executor (direct threading)
+    void* fAddress;
+
+    // Jump target, input/output channel or block size
+    int fValue;
+
+    // Result and operands
+    union {
+        T*   fRealDst;
+        int* fIntDst;
+    };
+    union {
+        T*   fReal1;
+        int* fInt1;
+    };
+    union {
+        T*   fReal2;
+        int* fInt2;
+    };
+
+    // Called math function
+    union {
+        T (*fFun1)(T);
+        T (*fFun2)(T, T);
+    };
+
+    FBCRegInstruction(Opcode opcode)
+        : fOpcode(opcode), fAddress(nullptr), fValue(0), fRealDst(nullptr), fReal1(nullptr), fReal2(nullptr), fFun1(nullptr)
+    {
+    }
+};
+
+// Math functions called by kFunReal1 and kFunReal2
+template <class T>
+struct FBCRegMath {
+    static T acos(T x) { return std::acos(x); }
+    static T acosh(T x) { return std::acosh(x); }
+    static T asin(T x) { return std::asin(x); }
+    static T asinh(T x) { return std::asinh(x); }
+    static T atan(T x) { return std::atan(x); }
+    static T atanh(T x) { return std::atanh(x); }
+    static T ceil(T x) { return std::ceil(x); }
+    static T cos(T x) { return std::cos(x); }
+    static T cosh(T x) { return std::cosh(x); }
+    static T exp(T x) { return std::exp(x); }
+    static T floor(T x) { return std::floor(x); }
+    static T log(T x) { return std::log(x); }
+    static T log10(T x) { return std::log10(x); }
+    static T rint(T x) { return std::rint(x); }
+    static T round(T x) { return std::round(x); }
+    static T sin(T x) { return std::sin(x); }
+    static T sinh(T x) { return std::sinh(x); }
+    static T sqrt(T x) { return std::sqrt(x); }
+    static T tan(T x) { return std::tan(x); }
+    static T tanh(T x) { return std::tanh(x); }
+
+    static T atan2(T x, T y) { return std::atan2(x, y); }
+    static T fmod(T x, T y) { return std::fmod(x, y); }
+    static T pow(T x, T y) { return std::pow(x, y); }
+};
+
+// Lowering of a FBC block in register code
+template <class T>
+class FBCRegLowering {
+   protected:
+    typedef FBCRegInstruction<T> RegInst;
+
+    enum Kind { kRegister, kHeap, kValue };
+
+    template <class V>
+    struct Operand {
+        V*   fPtr;
+        Kind fKind;  // kHeap : a heap location not yet loaded in a register
+    };
+
+    std::vector<RegInst>& fCode;
+
+    T*               fRealHeap;
+    int*             fIntHeap;
+    T*               fRealRegs;
+    int*             fIntRegs;
+    std::deque<T>&   fRealValues;
+    std::deque<int>& fIntValues;
+
+    // Read by the class segment lookups (see FBCInterpreter)
+    const T*   fClassRealHeap;
+    const int* fClassIntHeap;
+
+    // When set, the class cells are read in the segment of the factory (and not in the instance copy)
+    const FBCClassSegment<T>* fClassSegment;
+    bool                      fWritesClass;
+
+    std::vector<Operand<T>>   fRealStack;
+    std::vector<Operand<int>> fIntStack;
+
+    // Start of the blocks being lowered, target of kCondBranch
+    std::map<FBCBlockInstruction<T>*, int> fBlockStart;
+
+    // Last instruction if it produced a register, so that its result can be directly written elsewhere
+    int fLastReal;
+    int fLastInt;
+
+    int emit(const RegInst& inst)
+    {
+        fCode.push_back(inst);
+        fLastReal = fLastInt = -1;
+        return int(fCode.size()) - 1;
+    }
+
+    // A jump target is bound: the previous instruction cannot be modified anymore
+    int label()
+    {
+        fLastReal = fLastInt = -1;
+        return int(fCode.size());
+    }
+
+    bool pushRealOperand(T* ptr, Kind kind)
+    {
+        if (fRealStack.size() == REG_STACK_SIZE) return false;
+        fRealStack.push_back({ptr, kind});
+        return true;
+    }
+
+    bool pushIntOperand(int* ptr, Kind kind)
+    {
+        if (fIntStack.size() == REG_STACK_SIZE) return false;
+        fIntStack.push_back({ptr, kind});
+        return true;
+    }
+
+    T* popRealOperand()
+    {
+        T* ptr = fRealStack.back().fPtr;
+        fRealStack.pop_back();
+        return ptr;
+    }
+
+    int* popIntOperand()
+    {
+        int* ptr = fIntStack.back().fPtr;
+        fIntStack.pop_back();
+        return ptr;
+    }
+
+    // Emit an instruction writing its result in the register of the current stack depth
+    bool pushRealResult(RegInst inst)
+    {
+        if (fRealStack.size() == REG_STACK_SIZE) return false;
+        inst.fRealDst = &fRealRegs[fRealStack.size()];
+        fLastReal     = emit(inst);
+        return pushRealOperand(inst.fRealDst, kRegister);
+    }
+
+    bool pushIntResult(RegInst inst)
+    {
+        if (fIntStack.size() == REG_STACK_SIZE) return false;
+        inst.fIntDst = &fIntRegs[fIntStack.size()];
+        fLastInt     = emit(inst);
+        return pushIntOperand(inst.fIntDst, kRegister);
+    }
+
+    void flushReal(size_t i)
+    {
+        RegInst inst(RegInst::kMoveReal);
+        inst.fRealDst = &fRealRegs[i];
+        inst.fReal1   = fRealStack[i].fPtr;
+        emit(inst);
+        fRealStack[i] = {inst.fRealDst, kRegister};
+    }
+
+    void flushInt(size_t i)
+    {
+        RegInst inst(RegInst::kMoveInt);
+        inst.fIntDst = &fIntRegs[i];
+        inst.fInt1   = fIntStack[i].fPtr;
+        emit(inst);
+        fIntStack[i] = {inst.fIntDst, kRegister};
+    }
+
+    // Heap location to be read, possibly in the class segment of the factory
+    T* loadReal(int offset)
+    {
+        return (fClassSegment && fClassSegment->isRealCell(offset)) ? const_cast<T*>(&fClassSegment->fRealHeap[offset])
+                                                                     : &fRealHeap[offset];
+    }
+
+    int* loadInt(int offset)
+    {
+        return (fClassSegment && fClassSegment->isIntCell(offset)) ? const_cast<int*>(&fClassSegment->fIntHeap[offset])
+                                                                    : &fIntHeap[offset];
+    }
+
+    // Load the heap locations in [begin, end) still referenced by the stacks before they are written
+    void flushReal(T* begin, T* end)
+    {
+        if (fClassSegment) {
+            for (T* ptr = begin; ptr < end; ptr++) {
+                fWritesClass |= fClassSegment->isRealCell(int(ptr - fRealHeap));
+            }
+        }
+        for (size_t i = 0; i < fRealStack.size(); i++) {
+            if (fRealStack[i].fKind == kHeap && fRealStack[i].fPtr >= begin && fRealStack[i].fPtr < end) {
+                flushReal(i);
+            }
+        }
+    }
+
+    void flushInt(int* begin, int* end)
+    {
+        if (fClassSegment) {
+            for (int* ptr = begin; ptr < end; ptr++) {
+                fWritesClass |= fClassSegment->isIntCell(int(ptr - fIntHeap));
+            }
+        }
+        for (size_t i = 0; i < fIntStack.size(); i++) {
+            if (fIntStack[i].fKind == kHeap && fIntStack[i].fPtr >= begin && fIntStack[i].fPtr < end) {
+                flushInt(i);
+            }
+        }
+    }
+
+    // Before a branch, since the heap may be written in any path
+    void flushAll()
+    {
+        for (size_t i = 0; i < fRealStack.size(); i++) {
+            if (fRealStack[i].fKind == kHeap) flushReal(i);
+        }
+        for (size_t i = 0; i < fIntStack.size(); i++) {
+            if (fIntStack[i].fKind == kHeap) flushInt(i);
+        }
+    }
+
+    void storeReal(T* dst)
+    {
+        T* src = popRealOperand();
+        flushReal(dst, dst + 1);
+        if (fLastReal >= 0 && fCode[fLastReal].fRealDst == src) {
+            fCode[fLastReal].fRealDst = dst;
+        } else if (src != dst) {
+            RegInst inst(RegInst::kMoveReal);
+            inst.fRealDst = dst;
+            inst.fReal1   = src;
+            emit(inst);
+        }
+        fLastReal = -1;
+    }
+
+    void storeInt(int* dst)
+    {
+        int* src = popIntOperand();
+        flushInt(dst, dst + 1);
+        if (fLastInt >= 0 && fCode[fLastInt].fIntDst == src) {
+            fCode[fLastInt].fIntDst = dst;
+        } else if (src != dst) {
+            RegInst inst(RegInst::kMoveInt);
+            inst.fIntDst = dst;
+            inst.fInt1   = src;
+            emit(inst);
+        }
+        fLastInt = -1;
+    }
+
+    bool realBinop(typename RegInst::Opcode opcode)
+    {
+        RegInst inst(opcode);
+        inst.fReal1 = popRealOperand();
+        inst.fReal2 = popRealOperand();
+        return pushRealResult(inst);
+    }
+
+    bool realFunBinop(T (*fun)(T, T))
+    {
+        RegInst inst(RegInst::kFunReal2);
+        inst.fFun2  = fun;
+        inst.fReal1 = popRealOperand();
+        inst.fReal2 = popRealOperand();
+        return pushRealResult(inst);
+    }
+
+    bool realFunUnop(T (*fun)(T))
+    {
+        RegInst inst(RegInst::kFunReal1);
+        inst.fFun1  = fun;
+        inst.fReal1 = popRealOperand();
+        return pushRealResult(inst);
+    }
+
+    bool intBinop(typename RegInst::Opcode opcode)
+    {
+        RegInst inst(opcode);
+        inst.fInt1 = popIntOperand();
+        inst.fInt2 = popIntOperand();
+        return pushIntResult(inst);
+    }
+
+    bool realComp(typename RegInst::Opcode opcode)
+    {
+        RegInst inst(opcode);
+        inst.fReal1 = popRealOperand();
+        inst.fReal2 = popRealOperand();
+        return pushIntResult(inst);
+    }
+
+    bool lowerSelect(FBCBasicInstruction<T>* fbc, bool real)
+    {
+        int* cond = popIntOperand();
+        flushAll();
+        size_t real_depth = fRealStack.size();
+        size_t int_depth  = fIntStack.size();
+
+        RegInst jump_else(RegInst::kJumpIfZero);
+        jump_else.fInt1 = cond;
+        int jump1       = emit(jump_else);
+
+        // Both branches write their value in the register of the current depth
+        if (!lowerBlock(fbc->fBranch1)) return false;
+        if (real) {
+            if (fRealStack.size() != real_depth + 1) return false;
+            storeReal(&fRealRegs[real_depth]);
+        } else {
+            if (fIntStack.size() != int_depth + 1) return false;
+            storeInt(&fIntRegs[int_depth]);
+        }
+        int jump2 = emit(RegInst(RegInst::kJump));
+
+        fCode[jump1].fValue = label();
+        if (!lowerBlock(fbc->fBranch2)) return false;
+        if (real) {
+            if (fRealStack.size() != real_depth + 1) return false;
+            storeReal(&fRealRegs[real_depth]);
+        } else {
+            if (fIntStack.size() != int_depth + 1) return false;
+            storeInt(&fIntRegs[int_depth]);
+        }
+        fCode[jump2].fValue = label();
+
+        return (real) ? pushRealOperand(&fRealRegs[real_depth], kRegister)
+                      : pushIntOperand(&fIntRegs[int_depth], kRegister);
+    }
+
+    bool lowerIf(FBCBasicInstruction<T>* fbc)
+    {
+        int* cond = popIntOperand();
+        flushAll();
+        size_t real_depth = fRealStack.size();
+        size_t int_depth  = fIntStack.size();
+
+        RegInst jump_else(RegInst::kJumpIfZero);
+        jump_else.fInt1 = cond;
+        int jump1       = emit(jump_else);
+
+        if (!lowerBlock(fbc->fBranch1)) return false;
+        // Empty 'else' block
+        if (fbc->fBranch2->fInstructions.size() == 1) {
+            fCode[jump1].fValue = label();
+        } else {
+            int jump2           = emit(RegInst(RegInst::kJump));
+            fCode[jump1].fValue = label();
+            if (!lowerBlock(fbc->fBranch2)) return false;
+            fCode[jump2].fValue = label();
+        }
+
+        return fRealStack.size() == real_depth && fIntStack.size() == int_depth;
+    }
+
+    bool lowerLoop(FBCBasicInstruction<T>* fbc)
+    {
+        flushAll();
+
+        // Loop variable init code
+        if (!lowerBlock(fbc->fBranch1)) return false;
+
+        // Loop code, ended by a kCondBranch on the loop code itself
+        fBlockStart[fbc->fBranch2] = label();
+        bool res                   = lowerBlock(fbc->fBranch2);
+        fBlockStart.erase(fbc->fBranch2);
+        return res;
+    }
+
+    bool lowerInstruction(FBCBasicInstruction<T>* fbc)
+    {
+        switch (fbc->fOpcode) {
+            // Numbers
+            case FBCInstruction::kRealValue:
+                fRealValues.push_back(fbc->fRealValue);
+                return pushRealOperand(&fRealValues.back(), kValue);
+
+            case FBCInstruction::kInt32Value:
+                fIntValues.push_back(fbc->fIntValue);
+                return pushIntOperand(&fIntValues.back(), kValue);
+
+            // Memory
+            case FBCInstruction::kLoadReal:
+                return pushRealOperand(loadReal(fbc->fOffset1), kHeap);
+
+            case FBCInstruction::kLoadInt:
+                return pushIntOperand(loadInt(fbc->fOffset1), kHeap);
+
+            case FBCInstruction::kStoreReal:
+                storeReal(&fRealHeap[fbc->fOffset1]);
+                return true;
+
+            case FBCInstruction::kStoreInt:
+                storeInt(&fIntHeap[fbc->fOffset1]);
+                return true;
+
+            // A constant index is resolved as a simple load/store
+            case FBCInstruction::kLoadIndexedReal: {
+                if (fIntStack.back().fKind == kValue) {
+                    return pushRealOperand(loadReal(fbc->fOffset1 + *popIntOperand()), kHeap);
+                }
+                RegInst inst(RegInst::kLoadIndexedReal);
+                inst.fReal1 = loadReal(fbc->fOffset1);
+                inst.fInt2  = popIntOperand();
+                return pushRealResult(inst);
+            }
+
+            case FBCInstruction::kLoadIndexedInt: {
+                if (fIntStack.back().fKind == kValue) {
+                    return pushIntOperand(loadInt(fbc->fOffset1 + *popIntOperand()), kHeap);
+                }
+                RegInst inst(RegInst::kLoadIndexedInt);
+                inst.fInt1 = loadInt(fbc->fOffset1);
+                inst.fInt2 = popIntOperand();
+                return pushIntResult(inst);
+            }
+
+            // The shared tables are never written
+            case FBCInstruction::kLoadIndexedClassReal: {
+                T* table = const_cast<T*>(&fClassRealHeap[fbc->fOffset1]);
+                if (fIntStack.back().fKind == kValue) {
+                    return pushRealOperand(table + *popIntOperand(), kHeap);
+                }
+                RegInst inst(RegInst::kLoadIndexedReal);
+                inst.fReal1 = table;
+                inst.fInt2  = popIntOperand();
+                return pushRealResult(inst);
+            }
+
+            case FBCInstruction::kLoadIndexedClassInt: {
+                int* table = const_cast<int*>(&fClassIntHeap[fbc->fOffset1]);
+                if (fIntStack.back().fKind == kValue) {
+                    return pushIntOperand(table + *popIntOperand(), kHeap);
+                }
+                RegInst inst(RegInst::kLoadIndexedInt);
+                inst.fInt1 = table;
+                inst.fInt2 = popIntOperand();
+                return pushIntResult(inst);
+            }
+
+            case FBCInstruction::kStoreIndexedReal: {
+                if (fIntStack.back().fKind == kValue) {
+                    storeReal(&fRealHeap[fbc->fOffset1 + *popIntOperand()]);
+                    return true;
+                }
+                RegInst inst(RegInst::kStoreIndexedReal);
+                inst.fInt2    = popIntOperand();
+                inst.fReal1   = popRealOperand();
+                inst.fRealDst = &fRealHeap[fbc->fOffset1];
+                flushReal(inst.fRealDst, inst.fRealDst + fbc->fOffset2);
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kStoreIndexedInt: {
+                if (fIntStack.back().fKind == kValue) {
+                    storeInt(&fIntHeap[fbc->fOffset1 + *popIntOperand()]);
+                    return true;
+                }
+                RegInst inst(RegInst::kStoreIndexedInt);
+                inst.fInt1   = popIntOperand();
+                inst.fInt2   = popIntOperand();
+                inst.fIntDst = &fIntHeap[fbc->fOffset1];
+                flushInt(inst.fIntDst, inst.fIntDst + fbc->fOffset2);
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kBlockStoreReal: {
+                RegInst inst(RegInst::kBlockStoreReal);
+                inst.fRealDst = &fRealHeap[fbc->fOffset1];
+                inst.fReal1   = static_cast<FIRBlockStoreRealInstruction<T>*>(fbc)->fNumTable.data();
+                inst.fValue   = fbc->fOffset2;
+                flushReal(inst.fRealDst, inst.fRealDst + inst.fValue);
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kBlockStoreInt: {
+                RegInst inst(RegInst::kBlockStoreInt);
+                inst.fIntDst = &fIntHeap[fbc->fOffset1];
+                inst.fInt1   = static_cast<FIRBlockStoreIntInstruction<T>*>(fbc)->fNumTable.data();
+                inst.fValue  = fbc->fOffset2;
+                flushInt(inst.fIntDst, inst.fIntDst + inst.fValue);
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kBlockShiftReal: {
+                RegInst inst(RegInst::kBlockShiftReal);
+                inst.fRealDst = &fRealHeap[fbc->fOffset1];
+                inst.fValue   = fbc->fOffset1 - fbc->fOffset2;
+                flushReal(&fRealHeap[fbc->fOffset2], inst.fRealDst + 1);
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kBlockShiftInt: {
+                RegInst inst(RegInst::kBlockShiftInt);
+                inst.fIntDst = &fIntHeap[fbc->fOffset1];
+                inst.fValue  = fbc->fOffset1 - fbc->fOffset2;
+                flushInt(&fIntHeap[fbc->fOffset2], inst.fIntDst + 1);
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kLoadInput: {
+                RegInst inst(RegInst::kLoadInput);
+                inst.fValue = fbc->fOffset1;
+                inst.fInt1  = popIntOperand();
+                return pushRealResult(inst);
+            }
+
+            case FBCInstruction::kStoreOutput: {
+                RegInst inst(RegInst::kStoreOutput);
+                inst.fValue = fbc->fOffset1;
+                inst.fInt2  = popIntOperand();
+                inst.fReal1 = popRealOperand();
+                emit(inst);
+                return true;
+            }
+
+            // Cast/Bitcast
+            case FBCInstruction::kCastReal: {
+                RegInst inst(RegInst::kCastReal);
+                inst.fInt1 = popIntOperand();
+                return pushRealResult(inst);
+            }
+
+            case FBCInstruction::kCastInt: {
+                RegInst inst(RegInst::kCastInt);
+                inst.fReal1 = popRealOperand();
+                return pushIntResult(inst);
+            }
+
+            case FBCInstruction::kBitcastInt: {
+                RegInst inst(RegInst::kBitcastInt);
+                inst.fReal1 = popRealOperand();
+                return pushIntResult(inst);
+            }
+
+            case FBCInstruction::kBitcastReal: {
+                RegInst inst(RegInst::kBitcastReal);
+                inst.fInt1 = popIntOperand();
+                return pushRealResult(inst);
+            }
+
+            // Standard math
+            case FBCInstruction::kAddReal:
+                return realBinop(RegInst::kAddReal);
+            case FBCInstruction::kSubReal:
+                return realBinop(RegInst::kSubReal);
+            case FBCInstruction::kMultReal:
+                return realBinop(RegInst::kMultReal);
+            case FBCInstruction::kDivReal:
+                return realBinop(RegInst::kDivReal);
+            case FBCInstruction::kRemReal:
+                return realBinop(RegInst::kRemReal);
+
+            case FBCInstruction::kAddInt:
+                return intBinop(RegInst::kAddInt);
+            case FBCInstruction::kSubInt:
+                return intBinop(RegInst::kSubInt);
+            case FBCInstruction::kMultInt:
+                return intBinop(RegInst::kMultInt);
+            case FBCInstruction::kDivInt:
+                return intBinop(RegInst::kDivInt);
+            case FBCInstruction::kRemInt:
+                return intBinop(RegInst::kRemInt);
+            case FBCInstruction::kLshInt:
+                return intBinop(RegInst::kLshInt);
+            case FBCInstruction::kRshInt:
+                return intBinop(RegInst::kRshInt);
+            case FBCInstruction::kANDInt:
+                return intBinop(RegInst::kANDInt);
+            case FBCInstruction::kORInt:
+                return intBinop(RegInst::kORInt);
+            case FBCInstruction::kXORInt:
+                return intBinop(RegInst::kXORInt);
+
+            case FBCInstruction::kGTInt:
+                return intBinop(RegInst::kGTInt);
+            case FBCInstruction::kLTInt:
+                return intBinop(RegInst::kLTInt);
+            case FBCInstruction::kGEInt:
+                return intBinop(RegInst::kGEInt);
+            case FBCInstruction::kLEInt:
+                return intBinop(RegInst::kLEInt);
+            case FBCInstruction::kEQInt:
+                return intBinop(RegInst::kEQInt);
+            case FBCInstruction::kNEInt:
+                return intBinop(RegInst::kNEInt);
+
+            case FBCInstruction::kGTReal:
+                return realComp(RegInst::kGTReal);
+            case FBCInstruction::kLTReal:
+                return realComp(RegInst::kLTReal);
+            case FBCInstruction::kGEReal:
+                return realComp(RegInst::kGEReal);
+            case FBCInstruction::kLEReal:
+                return realComp(RegInst::kLEReal);
+            case FBCInstruction::kEQReal:
+                return realComp(RegInst::kEQReal);
+            case FBCInstruction::kNEReal:
+                return realComp(RegInst::kNEReal);
+
+            // Extended unary math
+            case FBCInstruction::kAbs: {
+                RegInst inst(RegInst::kAbsInt);
+                inst.fInt1 = popIntOperand();
+                return pushIntResult(inst);
+            }
+
+            case FBCInstruction::kAbsf: {
+                RegInst inst(RegInst::kAbsReal);
+                inst.fReal1 = popRealOperand();
+                return pushRealResult(inst);
+            }
+
+            case FBCInstruction::kAcosf:
+                return realFunUnop(FBCRegMath<T>::acos);
+            case FBCInstruction::kAcoshf:
+                return realFunUnop(FBCRegMath<T>::acosh);
+            case FBCInstruction::kAsinf:
+                return realFunUnop(FBCRegMath<T>::asin);
+            case FBCInstruction::kAsinhf:
+                return realFunUnop(FBCRegMath<T>::asinh);
+            case FBCInstruction::kAtanf:
+                return realFunUnop(FBCRegMath<T>::atan);
+            case FBCInstruction::kAtanhf:
+                return realFunUnop(FBCRegMath<T>::atanh);
+            case FBCInstruction::kCeilf:
+                return realFunUnop(FBCRegMath<T>::ceil);
+            case FBCInstruction::kCosf:
+                return realFunUnop(FBCRegMath<T>::cos);
+            case FBCInstruction::kCoshf:
+                return realFunUnop(FBCRegMath<T>::cosh);
+            case FBCInstruction::kExpf:
+                return realFunUnop(FBCRegMath<T>::exp);
+            case FBCInstruction::kFloorf:
+                return realFunUnop(FBCRegMath<T>::floor);
+            case FBCInstruction::kLogf:
+                return realFunUnop(FBCRegMath<T>::log);
+            case FBCInstruction::kLog10f:
+                return realFunUnop(FBCRegMath<T>::log10);
+            case FBCInstruction::kRintf:
+                return realFunUnop(FBCRegMath<T>::rint);
+            case FBCInstruction::kRoundf:
+                return realFunUnop(FBCRegMath<T>::round);
+            case FBCInstruction::kSinf:
+                return realFunUnop(FBCRegMath<T>::sin);
+            case FBCInstruction::kSinhf:
+                return realFunUnop(FBCRegMath<T>::sinh);
+            case FBCInstruction::kSqrtf:
+                return realFunUnop(FBCRegMath<T>::sqrt);
+            case FBCInstruction::kTanf:
+                return realFunUnop(FBCRegMath<T>::tan);
+            case FBCInstruction::kTanhf:
+                return realFunUnop(FBCRegMath<T>::tanh);
+
+            // Extended binary math
+            case FBCInstruction::kAtan2f:
+                return realFunBinop(FBCRegMath<T>::atan2);
+            case FBCInstruction::kFmodf:
+                return realFunBinop(FBCRegMath<T>::fmod);
+            case FBCInstruction::kPowf:
+                return realFunBinop(FBCRegMath<T>::pow);
+            case FBCInstruction::kMax:
+                return intBinop(RegInst::kMaxInt);
+            case FBCInstruction::kMaxf:
+                return realBinop(RegInst::kMaxReal);
+            case FBCInstruction::kMin:
+                return intBinop(RegInst::kMinInt);
+            case FBCInstruction::kMinf:
+                return realBinop(RegInst::kMinReal);
+
+            // Control
+            case FBCInstruction::kIf:
+                return lowerIf(fbc);
+
+            case FBCInstruction::kSelectReal:
+                return lowerSelect(fbc, true);
+
+            case FBCInstruction::kSelectInt:
+                return lowerSelect(fbc, false);
+
+            case FBCInstruction::kLoop:
+                return lowerLoop(fbc);
+
+            case FBCInstruction::kCondBranch: {
+                if (fBlockStart.find(fbc->fBranch1) == fBlockStart.end()) return false;
+                RegInst inst(RegInst::kJumpIfNotZero);
+                inst.fInt1 = popIntOperand();
+                flushAll();
+                inst.fValue = fBlockStart[fbc->fBranch1];
+                emit(inst);
+                return true;
+            }
+
+            case FBCInstruction::kNop:
+                return true;
+
+            default:
+                // Soundfiles, and opcodes only produced by the optimizer
+                return false;
+        }
+    }
+
+    bool lowerBlock(FBCBlockInstruction<T>* block)
+    {
+        for (auto& it : block->fInstructions) {
+            if (it->fOpcode == FBCInstruction::kReturn) {
+                return true;
+            } else if (!lowerInstruction(it)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+   public:
+    FBCRegLowering(std::vector<RegInst>& code, T* real_heap, int* int_heap, T* real_regs, int* int_regs,
+                   std::deque<T>& real_values, std::deque<int>& int_values, const T* class_real_heap,
+                   const int* class_int_heap, const FBCClassSegment<T>* class_segment = nullptr)
+        : fCode(code),
+          fRealHeap(real_heap),
+          fIntHeap(int_heap),
+          fRealRegs(real_regs),
+          fIntRegs(int_regs),
+          fRealValues(real_values),
+          fIntValues(int_values),
+          fClassRealHeap(class_real_heap),
+          fClassIntHeap(class_int_heap),
+          fClassSegment(class_segment),
+          fWritesClass(false),
+          fLastReal(-1),
+          fLastInt(-1)
+    {
+    }
+
+    // Returns false if the block cannot be lowered (then 'code' has to be ignored)
+    bool lower(FBCBlockInstruction<T>* block)
+    {
+        if (!lowerBlock(block) || fRealStack.size() > 0 || fIntStack.size() > 0) return false;
+        emit(RegInst(RegInst::kReturn));
+        return true;
+    }
+
+    // The class cells can only be read in the factory segment if the block does not write them
+    bool writesClass() { return fWritesClass; }
+};
+
+// FBC register based interpreter: lowered blocks are executed in place of the FBC ones, the others are interpreted
+template <class T, int TRACE>
+class FBCRegInterpreter : public FBCInterpreter<T, TRACE> {
+   protected:
+    typedef FBCRegInstruction<T> RegInst;
+
+    std::map<FBCBlockInstruction<T>*, std::vector<RegInst>> fLoweredBlocks;
+
+    T   fRealRegs[REG_STACK_SIZE];
+    int fIntRegs[REG_STACK_SIZE];
+
+    // Constants used as operands (deque so that their address is stable)
+    std::deque<T>   fRealValues;
+    std::deque<int> fIntValues;
+
+    // Returns true if the lowered block writes the class cells
+    bool lowerBlock(FBCBlockInstruction<T>* fbc_block, FBCBlockInstruction<T>* block,
+                    const FBCClassSegment<T>* class_segment)
+    {
+        if (!fbc_block) return false;
+        std::vector<RegInst>  code;
+        FBCRegLowering<T> lowering(code, this->fRealHeap, this->fIntHeap, fRealRegs, fIntRegs, fRealValues,
+                                   fIntValues, this->fClassRealHeap, this->fClassIntHeap, class_segment);
+        if (lowering.lower(fbc_block)) {
+            void** dispatch_table = nullptr;
+            ExecuteRegBlock(nullptr, &dispatch_table);
+            for (auto& it : code) {
+                it.fAddress = dispatch_table[it.fOpcode];
+            }
+            fLoweredBlocks[block] = code;
+        }
+        return lowering.writesClass();
+    }
+
+    void lowerBlocks(interpreter_dsp_factory_aux<T, TRACE>* factory, const FBCClassSegment<T>* class_segment)
+    {
+        fLoweredBlocks.clear();
+        bool writes_class = lowerBlock(factory->fRegComputeBlock, factory->fComputeBlock, class_segment);
+        writes_class |= lowerBlock(factory->fRegComputeDSPBlock, factory->fComputeDSPBlock, class_segment);
+        if (writes_class) {
+            // The class cells have to be read in the instance heaps
+            lowerBlocks(factory, nullptr);
+        }
+    }
+
+    // When 'code' is null, only returns the dispatch table
+    void ExecuteRegBlock(RegInst* code, void*** dispatch_table = nullptr)
+    {
+        static void* fDispatchTable[] = {
+
+            // Moves
+            &&do_kMoveReal, &&do_kMoveInt,
+
+            // Real math
+            &&do_kAddReal, &&do_kSubReal, &&do_kMultReal, &&do_kDivReal, &&do_kRemReal, &&do_kMaxReal,
+            &&do_kMinReal, &&do_kAbsReal, &&do_kFunReal1, &&do_kFunReal2,
+
+            // Int math
+            &&do_kAddInt, &&do_kSubInt, &&do_kMultInt, &&do_kDivInt, &&do_kRemInt, &&do_kLshInt, &&do_kRshInt,
+            &&do_kANDInt, &&do_kORInt, &&do_kXORInt, &&do_kMaxInt, &&do_kMinInt, &&do_kAbsInt,
+
+            // Comparison
+            &&do_kGTInt, &&do_kLTInt, &&do_kGEInt, &&do_kLEInt, &&do_kEQInt, &&do_kNEInt, &&do_kGTReal,
+            &&do_kLTReal, &&do_kGEReal, &&do_kLEReal, &&do_kEQReal, &&do_kNEReal,
+
+            // Cast/Bitcast
+            &&do_kCastReal, &&do_kCastInt, &&do_kBitcastInt, &&do_kBitcastReal,
+
+            // Memory
+            &&do_kLoadIndexedReal, &&do_kLoadIndexedInt, &&do_kStoreIndexedReal, &&do_kStoreIndexedInt,
+            &&do_kBlockStoreReal, &&do_kBlockStoreInt, &&do_kBlockShiftReal, &&do_kBlockShiftInt, &&do_kLoadInput,
+            &&do_kStoreOutput,
+
+            // Control
+            &&do_kJump, &&do_kJumpIfZero, &&do_kJumpIfNotZero, &&do_kReturn
+
+        };
+
+#define dispatchFirstReg()  \
+    {                       \
+        goto *it->fAddress; \
+    }
+#define dispatchNextReg()   \
+    {                       \
+        it++;               \
+        goto *it->fAddress; \
+    }
+#define dispatchJumpReg()       \
+    {                           \
+        it = code + it->fValue; \
+        goto *it->fAddress;     \
+    }
+
+        if (!code) {
+            *dispatch_table = fDispatchTable;
+            return;
+        }
+
+        RegInst* it = code;
+        dispatchFirstReg();
+
+        // Moves
+    do_kMoveReal : {
+        *it->fRealDst = *it->fReal1;
+        dispatchNextReg();
+    }
+
+    do_kMoveInt : {
+        *it->fIntDst = *it->fInt1;
+        dispatchNextReg();
+    }
+
+        // Real math
+    do_kAddReal : {
+        *it->fRealDst = *it->fReal1 + *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kSubReal : {
+        *it->fRealDst = *it->fReal1 - *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kMultReal : {
+        *it->fRealDst = *it->fReal1 * *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kDivReal : {
+        *it->fRealDst = *it->fReal1 / *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kRemReal : {
+        *it->fRealDst = std::remainder(*it->fReal1, *it->fReal2);
+        dispatchNextReg();
+    }
+
+    do_kMaxReal : {
+        *it->fRealDst = std::max(*it->fReal1, *it->fReal2);
+        dispatchNextReg();
+    }
+
+    do_kMinReal : {
+        *it->fRealDst = std::min(*it->fReal1, *it->fReal2);
+        dispatchNextReg();
+    }
+
+    do_kAbsReal : {
+        *it->fRealDst = std::fabs(*it->fReal1);
+        dispatchNextReg();
+    }
+
+    do_kFunReal1 : {
+        *it->fRealDst = it->fFun1(*it->fReal1);
+        dispatchNextReg();
+    }
+
+    do_kFunReal2 : {
+        *it->fRealDst = it->fFun2(*it->fReal1, *it->fReal2);
+        dispatchNextReg();
+    }
+
+        // Int math
+    do_kAddInt : {
+        *it->fIntDst = *it->fInt1 + *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kSubInt : {
+        *it->fIntDst = *it->fInt1 - *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kMultInt : {
+        *it->fIntDst = *it->fInt1 * *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kDivInt : {
+        *it->fIntDst = *it->fInt1 / *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kRemInt : {
+        *it->fIntDst = *it->fInt1 % *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kLshInt : {
+        *it->fIntDst = *it->fInt1 << *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kRshInt : {
+        *it->fIntDst = *it->fInt1 >> *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kANDInt : {
+        *it->fIntDst = *it->fInt1 & *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kORInt : {
+        *it->fIntDst = *it->fInt1 | *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kXORInt : {
+        *it->fIntDst = *it->fInt1 ^ *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kMaxInt : {
+        *it->fIntDst = std::max(*it->fInt1, *it->fInt2);
+        dispatchNextReg();
+    }
+
+    do_kMinInt : {
+        *it->fIntDst = std::min(*it->fInt1, *it->fInt2);
+        dispatchNextReg();
+    }
+
+    do_kAbsInt : {
+        *it->fIntDst = std::abs(*it->fInt1);
+        dispatchNextReg();
+    }
+
+        // Comparison
+    do_kGTInt : {
+        *it->fIntDst = *it->fInt1 > *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kLTInt : {
+        *it->fIntDst = *it->fInt1 < *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kGEInt : {
+        *it->fIntDst = *it->fInt1 >= *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kLEInt : {
+        *it->fIntDst = *it->fInt1 <= *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kEQInt : {
+        *it->fIntDst = *it->fInt1 == *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kNEInt : {
+        *it->fIntDst = *it->fInt1 != *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kGTReal : {
+        *it->fIntDst = *it->fReal1 > *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kLTReal : {
+        *it->fIntDst = *it->fReal1 < *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kGEReal : {
+        *it->fIntDst = *it->fReal1 >= *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kLEReal : {
+        *it->fIntDst = *it->fReal1 <= *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kEQReal : {
+        *it->fIntDst = *it->fReal1 == *it->fReal2;
+        dispatchNextReg();
+    }
+
+    do_kNEReal : {
+        *it->fIntDst = *it->fReal1 != *it->fReal2;
+        dispatchNextReg();
+    }
+
+        // Cast/Bitcast
+    do_kCastReal : {
+        *it->fRealDst = T(*it->fInt1);
+        dispatchNextReg();
+    }
+
+    do_kCastInt : {
+        *it->fIntDst = int(*it->fReal1);
+        dispatchNextReg();
+    }
+
+    do_kBitcastInt : {
+        *it->fIntDst = *reinterpret_cast<int*>(it->fReal1);
+        dispatchNextReg();
+    }
+
+    do_kBitcastReal : {
+        *it->fRealDst = *reinterpret_cast<T*>(it->fInt1);
+        dispatchNextReg();
+    }
+
+        // Memory
+    do_kLoadIndexedReal : {
+        *it->fRealDst = it->fReal1[*it->fInt2];
+        dispatchNextReg();
+    }
+
+    do_kLoadIndexedInt : {
+        *it->fIntDst = it->fInt1[*it->fInt2];
+        dispatchNextReg();
+    }
+
+    do_kStoreIndexedReal : {
+        it->fRealDst[*it->fInt2] = *it->fReal1;
+        dispatchNextReg();
+    }
+
+    do_kStoreIndexedInt : {
+        it->fIntDst[*it->fInt1] = *it->fInt2;
+        dispatchNextReg();
+    }
+
+    do_kBlockStoreReal : {
+        for (int i = 0; i < it->fValue; i++) {
+            it->fRealDst[i] = it->fReal1[i];
+        }
+        dispatchNextReg();
+    }
+
+    do_kBlockStoreInt : {
+        for (int i = 0; i < it->fValue; i++) {
+            it->fIntDst[i] = it->fInt1[i];
+        }
+        dispatchNextReg();
+    }
+
+    do_kBlockShiftReal : {
+        for (int i = 0; i < it->fValue; i++) {
+            it->fRealDst[-i] = it->fRealDst[-i - 1];
+        }
+        dispatchNextReg();
+    }
+
+    do_kBlockShiftInt : {
+        for (int i = 0; i < it->fValue; i++) {
+            it->fIntDst[-i] = it->fIntDst[-i - 1];
+        }
+        dispatchNextReg();
+    }
+
+    do_kLoadInput : {
+        *it->fRealDst = this->fInputs[it->fValue][*it->fInt1];
+        dispatchNextReg();
+    }
+
+    do_kStoreOutput : {
+        this->fOutputs[it->fValue][*it->fInt2] = *it->fReal1;
+        dispatchNextReg();
+    }
+
+        // Control
+    do_kJump : {
+        dispatchJumpReg();
+    }
+
+    do_kJumpIfZero : {
+        if (*it->fInt1) {
+            dispatchNextReg();
+        } else {
+            dispatchJumpReg();
+        }
+    }
+
+    do_kJumpIfNotZero : {
+        if (*it->fInt1) {
+            dispatchJumpReg();
+        } else {
+            dispatchNextReg();
+        }
+    }
+
+    do_kReturn : {
+        return;
+    }
+    }
+
+   public:
+    FBCRegInterpreter(interpreter_dsp_factory_aux<T, TRACE>* factory) : FBCInterpreter<T, TRACE>(factory)
+    {
+        // The tables are read in the class segment of the factory, so that the table lookups of all instances
+        // use the same cache lines
+        const FBCClassSegment<T>* class_segment = nullptr;
+        try {
+            class_segment = factory->getClassSegment();
+        } catch (faustexception& e) {
+            // Reported by classInit
+        }
+        lowerBlocks(factory, class_segment);
+    }
+
+    virtual void ExecuteBlock(FBCBlockInstruction<T>* block, bool compile = false)
+    {
+        auto it = fLoweredBlocks.find(block);
+        if (it != fLoweredBlocks.end()) {
+            ExecuteRegBlock(it->second.data());
+        } else {
+            FBCInterpreter<T, TRACE>::ExecuteBlock(block, compile);
+        }
+    }
+};
+
+#endif
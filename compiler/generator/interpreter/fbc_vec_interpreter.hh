@@ -40,7 +40,12 @@
 template <class T, int TRACE>
 struct interpreter_dsp_factory_aux;
 
-// FBC interpreter
+/*
+ FBC interpreter working on VEC values per opcode. It is not created by the interpreter factories, and each opcode
+ still runs its lanes with scalar code: SIMD execution of the interpreted code (requested for the FBC produced
+ with -vec) is not implemented. That FBC is scalar code on the vector loops, and would need a code generator
+ emitting FBC for VEC lanes to be run here.
+*/
 template <class T, int VEC>
 class FBCVecInterpreter : public FBCExecutor<T> {
    protected:
@@ -2522,6 +2527,9 @@ class FBCVecInterpreter : public FBCExecutor<T> {
     void setIntValue(int offset, int value) { fIntHeap[offset] = value; }
     int  getIntValue(int offset) { return fIntHeap[offset]; }
 
+    int* getIntHeap() { return fIntHeap; }
+    T*   getRealHeap() { return fRealHeap; }
+
     virtual void setInput(int offset, T* buffer) { fInputs[offset] = buffer; }
     virtual void setOutput(int offset, T* buffer) { fOutputs[offset] = buffer; }
 };
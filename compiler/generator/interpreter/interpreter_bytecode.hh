@@ -60,7 +60,7 @@ struct FBCBasicInstruction : public FBCInstruction {
 
     FBCBasicInstruction(Opcode opcode, const std::string& name, int val_int, T val_real, int off1, int off2,
                         FBCBlockInstruction<T>* branch1, FBCBlockInstruction<T>* branch2)
-        : fName(""),
+        : fName(name),
           fOpcode(opcode),
           fIntValue(val_int),
           fRealValue(val_real),
@@ -150,10 +150,11 @@ struct FBCBasicInstruction : public FBCInstruction {
     virtual void write(std::ostream* out, bool binary = false, bool small = false, bool recurse = true)
     {
         if (small) {
-            *out << "o " << fOpcode << " k "
+            *out << "o " << getFileOpcode(fOpcode) << " k "
                  << " i " << fIntValue << " r " << fRealValue << " o " << fOffset1 << " o " << fOffset2 << std::endl;
         } else {
-            *out << "opcode " << fOpcode << " " << gFBCInstructionTable[fOpcode] << " int " << fIntValue << " real "
+            *out << "opcode " << getFileOpcode(fOpcode) << " " << gFBCInstructionTable[getFileOpcode(fOpcode)]
+                 << " int " << fIntValue << " real "
                  << fRealValue << " offset1 " << fOffset1 << " offset2 " << fOffset2;
             if (this->fName != "") {
                 *out << " name " << this->fName;
@@ -48,7 +48,7 @@ global memory allocation is implemented)
 */
 
 template <class T>
-map<string, FBCInstruction::Opcode> InterpreterInstVisitor<T>::gMathLibTable;
+thread_local map<string, FBCInstruction::Opcode> InterpreterInstVisitor<T>::gMathLibTable;
 
 template <class T>
 static FBCBlockInstruction<T>* getCurrentBlock()
@@ -201,6 +201,9 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
     // Keep "compute_dsp_block"
     FBCBlockInstruction<T>* compute_dsp_block = generateCompute();
 
+    // The static fields are placed after the instance fields
+    getInterpreterVisitor<T>()->relocateClassFields();
+
     // Generate metadata block and name
     string                   name;
     FIRMetaBlockInstruction* metadata_block = produceMetadata(name);
@@ -209,6 +212,10 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
     const char* trace = getenv("FAUST_INTERP_TRACE");
     int         mode  = (trace) ? std::atoi(trace) : 0;
 
+    // FBC optimization level, INTER_REG_OPT_LEVEL to use the register based interpreter
+    const char* opt       = getenv("FAUST_INTERP_OPT_LEVEL");
+    int         opt_level = (opt) ? std::atoi(opt) : INTER_MAX_OPT_LEVEL;
+
     // Prepare compilation options
     stringstream compile_options;
     gGlobal->printCompilationOptions(compile_options);
@@ -220,7 +227,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         case 2:
@@ -229,7 +236,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         case 3:
@@ -238,7 +245,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         case 4:
@@ -247,7 +254,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         case 5:
@@ -256,7 +263,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         case 6:
@@ -265,7 +272,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         case 7:
@@ -274,7 +281,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
 
         default:
@@ -284,7 +291,7 @@ dsp_factory_base* InterpreterCodeContainer<T>::produceFactory()
                 getInterpreterVisitor<T>()->fIntHeapOffset, getInterpreterVisitor<T>()->fRealHeapOffset,
                 getInterpreterVisitor<T>()->fSoundHeapOffset, getInterpreterVisitor<T>()->getFieldOffset("fSampleRate"),
                 getInterpreterVisitor<T>()->getFieldOffset("count"), getInterpreterVisitor<T>()->getFieldOffset("IOTA"),
-                INTER_MAX_OPT_LEVEL, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
+                opt_level, metadata_block, getInterpreterVisitor<T>()->fUserInterfaceBlock, init_static_block,
                 init_block, resetui_block, clear_block, compute_control_block, compute_dsp_block);
     }
 }
@@ -34,6 +34,9 @@ struct interpreter_comp_dsp_factory_aux : public interpreter_dsp_factory_aux<T,T
     // Shared between all DSP instances
     typename FBCCompiler<T>::CompiledBlocksType* fCompiledBlocks;
 
+    // Tiered mode: the 'compute' block is interpreted until compiled in a background thread
+    bool fTiered;
+
     interpreter_comp_dsp_factory_aux(const std::string& name, const std::string& compile_options, const std::string& sha_key,
                                 int version_num, int inputs, int outputs, int int_heap_size, int real_heap_size,
                                 int sound_heap_size, int sr_offset, int count_offset, int iota_offset, int opt_level,
@@ -50,11 +53,12 @@ struct interpreter_comp_dsp_factory_aux : public interpreter_dsp_factory_aux<T,T
                                   compute_control, compute_dsp)
     {
         fCompiledBlocks = new std::map<FBCBlockInstruction<T>*, FBCExecuteFun<T>*>();
+        fTiered         = getenv("FAUST_INTERP_TIERED") != NULL;
     }
 
     virtual FBCExecutor<T>* createFBCExecutor()
     {
-        return new FBCCompiler<T>(this, fCompiledBlocks);
+        return new FBCCompiler<T>(this, fCompiledBlocks, fTiered);
     }
 
     virtual ~interpreter_comp_dsp_factory_aux()
@@ -184,6 +184,48 @@ interpreter_dsp_factory_aux<T, TRACE>* interpreter_dsp_factory_aux<T, TRACE>::re
 #endif
 }
 
+// Binary factory reader
+template <class T, int TRACE>
+interpreter_dsp_factory_aux<T, TRACE>* interpreter_dsp_factory_aux<T, TRACE>::readBinary(const char* buffer, size_t size)
+{
+    FBCBinaryReader<T>      reader(buffer, size);
+    const FBCBinaryHeader&  header = reader.fHeader;
+    FBCBlockInstruction<T>* blocks[6] = {};
+    
+    std::string factory_name    = reader.getString(header.fName);
+    std::string compile_options = reader.getString(header.fCompileOptions);
+    std::string sha_key         = reader.getString(header.fSHAKey);
+    
+    FIRMetaBlockInstruction*             meta_block = reader.readMetaBlock();
+    FIRUserInterfaceBlockInstruction<T>* ui_block   = nullptr;
+    try {
+        ui_block = reader.readUIBlock();
+        for (int i = 0; i < 6; i++) {
+            blocks[i] = reader.readCodeBlock(header.fRootBlocks[i]);
+        }
+    } catch (...) {
+        delete meta_block;
+        delete ui_block;
+        for (int i = 0; i < 6; i++) delete blocks[i];
+        throw;
+    }
+#ifdef MACHINE
+    return new interpreter_comp_dsp_factory_aux<T,TRACE>(factory_name, compile_options, sha_key, header.fFileVersion,
+                                                         header.fNumInputs, header.fNumOutputs, header.fIntHeapSize,
+                                                         header.fRealHeapSize, header.fSoundHeapSize, header.fSROffset,
+                                                         header.fCountOffset, header.fIOTAOffset, header.fOptLevel,
+                                                         meta_block, ui_block, blocks[0], blocks[1], blocks[2],
+                                                         blocks[3], blocks[4], blocks[5]);
+#else
+    return new interpreter_dsp_factory_aux<T,TRACE>(factory_name, compile_options, sha_key, header.fFileVersion,
+                                                    header.fNumInputs, header.fNumOutputs, header.fIntHeapSize,
+                                                    header.fRealHeapSize, header.fSoundHeapSize, header.fSROffset,
+                                                    header.fCountOffset, header.fIOTAOffset, header.fOptLevel,
+                                                    meta_block, ui_block, blocks[0], blocks[1], blocks[2],
+                                                    blocks[3], blocks[4], blocks[5]);
+#endif
+}
+
 template <class T, int TRACE>
 void interpreter_dsp_factory_aux<T, TRACE>::optimize()
 {
@@ -192,17 +234,218 @@ void interpreter_dsp_factory_aux<T, TRACE>::optimize()
         // Bytecode optimization
         if (TRACE == 0) {
     #ifndef MACHINE
+            // Done before the optimizations, that would fuse the table lookups
+            shareClassSegment();
+
+            // The profile is recorded by the stack based interpreter
+            if (fOptLevel >= INTER_REG_OPT_LEVEL && !getenv("FAUST_INTERP_PROFILE_FILE")) {
+                fRegComputeBlock    = fComputeBlock->copy();
+                fRegComputeDSPBlock = fComputeDSPBlock->copy();
+            }
+    
             fStaticInitBlock = FBCInstructionOptimizer<T>::optimizeBlock(fStaticInitBlock, 1, fOptLevel);
             fInitBlock       = FBCInstructionOptimizer<T>::optimizeBlock(fInitBlock, 1, fOptLevel);
             fResetUIBlock    = FBCInstructionOptimizer<T>::optimizeBlock(fResetUIBlock, 1, fOptLevel);
             fClearBlock      = FBCInstructionOptimizer<T>::optimizeBlock(fClearBlock, 1, fOptLevel);
             fComputeBlock    = FBCInstructionOptimizer<T>::optimizeBlock(fComputeBlock, 1, fOptLevel);
             fComputeDSPBlock = FBCInstructionOptimizer<T>::optimizeBlock(fComputeDSPBlock, 1, fOptLevel);
+    
+            // Display the most frequent opcode sequences of the optimized 'compute' code (to choose superinstructions)
+            const char* stats = getenv("FAUST_INTERP_OPCODE_STATS");
+            if (stats) {
+                int max_count = (std::atoi(stats) > 0) ? std::atoi(stats) : 20;
+                for (int length = 2; length <= 3; length++) {
+                    FBCInstructionProfiler<T> profiler;
+                    profiler.profile(fComputeBlock, length);
+                    profiler.profile(fComputeDSPBlock, length);
+                    std::cerr << "-------- Most frequent sequences of " << length << " opcodes --------" << std::endl;
+                    profiler.write(&std::cerr, max_count);
+                }
+            }
     #endif
         }
     }
 }
 
+/*
+ The 'static init' block is run twice on heaps initialized with different values: the cells having the same
+ value after both runs are the ones it writes. The block only depends on the cells it has previously written
+ (like the C++ 'classInit' that only fills the tables), so the resulting segment is the same for all instances.
+*/
+template <class T, int TRACE>
+const FBCClassSegment<T>* interpreter_dsp_factory_aux<T, TRACE>::getClassSegment()
+{
+    std::lock_guard<std::mutex> lock(fClassSegmentLock);
+    if (!fClassSegment) {
+        // First heaps are initialized with DUMMY_INT/DUMMY_REAL, the second ones with 0
+        FBCInterpreter<T, TRACE> interpreter1(this, true);
+        FBCInterpreter<T, TRACE> interpreter2(this, true);
+        FBCExecutor<T>&          executor1 = interpreter1;
+        FBCExecutor<T>&          executor2 = interpreter2;
+        memset(executor2.getIntHeap(), 0, sizeof(int) * fIntHeapSize);
+        memset(executor2.getRealHeap(), 0, sizeof(T) * fRealHeapSize);
+        executor1.ExecuteBlock(fStaticInitBlock);
+        executor2.ExecuteBlock(fStaticInitBlock);
+        
+        FBCClassSegment<T>* segment = new FBCClassSegment<T>();
+        int* int_heap  = executor1.getIntHeap();
+        T*   real_heap = executor1.getRealHeap();
+        segment->fIntHeap.assign(int_heap, int_heap + fIntHeapSize);
+        segment->fRealHeap.assign(real_heap, real_heap + fRealHeapSize);
+        segment->fIntCells.resize(fIntHeapSize);
+        segment->fRealCells.resize(fRealHeapSize);
+        for (int i = 0; i < fIntHeapSize; i++) {
+            segment->fIntCells[i] = (int_heap[i] == executor2.getIntHeap()[i]);
+        }
+        for (int i = 0; i < fRealHeapSize; i++) {
+            segment->fRealCells[i] = (memcmp(&real_heap[i], &executor2.getRealHeap()[i], sizeof(T)) == 0);
+        }
+        FBCClassSegment<T>::addRuns(segment->fIntCells, segment->fIntRuns);
+        FBCClassSegment<T>::addRuns(segment->fRealCells, segment->fRealRuns);
+        fClassSegment = segment;
+    }
+    return fClassSegment;
+}
+
+// Collect the table lookups in the [int_offset, int_size) and [real_offset, real_size) cells, returns false if these
+// cells are accessed in another way
+template <class T>
+static bool getClassLookups(FBCBlockInstruction<T>* block, int int_offset, int int_size, int real_offset,
+                            int real_size, std::vector<FBCBasicInstruction<T>*>& lookups)
+{
+    auto isIntCell  = [&](int offset) { return int_offset < int_size && offset >= int_offset; };
+    auto isRealCell = [&](int offset) { return real_offset < real_size && offset >= real_offset; };
+
+    for (auto& inst : block->fInstructions) {
+        switch (inst->fOpcode) {
+            case FBCInstruction::kLoadIndexedReal:
+            case FBCInstruction::kLoadIndexedClassReal:
+                inst->fOpcode = FBCInstruction::kLoadIndexedReal;
+                if (inst->fOffset1 >= real_offset) {
+                    lookups.push_back(inst);
+                } else if (inst->fOffset1 + inst->fOffset2 > real_offset) {
+                    return false;
+                }
+                break;
+
+            case FBCInstruction::kLoadIndexedInt:
+            case FBCInstruction::kLoadIndexedClassInt:
+                inst->fOpcode = FBCInstruction::kLoadIndexedInt;
+                if (inst->fOffset1 >= int_offset) {
+                    lookups.push_back(inst);
+                } else if (inst->fOffset1 + inst->fOffset2 > int_offset) {
+                    return false;
+                }
+                break;
+
+            // Offset and size
+            case FBCInstruction::kStoreIndexedReal:
+            case FBCInstruction::kBlockStoreReal:
+                if (inst->fOffset1 + inst->fOffset2 > real_offset) return false;
+                break;
+
+            case FBCInstruction::kStoreIndexedInt:
+            case FBCInstruction::kBlockStoreInt:
+                if (inst->fOffset1 + inst->fOffset2 > int_offset) return false;
+                break;
+
+            case FBCInstruction::kLoadReal:
+            case FBCInstruction::kStoreReal:
+            case FBCInstruction::kStoreRealValue:
+                if (isRealCell(inst->fOffset1)) return false;
+                break;
+
+            case FBCInstruction::kLoadInt:
+            case FBCInstruction::kStoreInt:
+            case FBCInstruction::kStoreIntValue:
+                if (isIntCell(inst->fOffset1)) return false;
+                break;
+
+            case FBCInstruction::kBlockShiftReal:
+                if (isRealCell(inst->fOffset1) || isRealCell(inst->fOffset2)) return false;
+                break;
+
+            case FBCInstruction::kBlockShiftInt:
+                if (isIntCell(inst->fOffset1) || isIntCell(inst->fOffset2)) return false;
+                break;
+
+            // No offset in the int/real heaps
+            case FBCInstruction::kLoadInput:
+            case FBCInstruction::kStoreOutput:
+            case FBCInstruction::kLoadSound:
+            case FBCInstruction::kLoadSoundField:
+            case FBCInstruction::kStoreSound:
+            case FBCInstruction::kLoop:
+            case FBCInstruction::kCondBranch:
+                break;
+
+            // Other opcodes (possibly produced by the optimizer) : any offset in the tables
+            default:
+                if (isIntCell(inst->fOffset1) || isRealCell(inst->fOffset1) || isIntCell(inst->fOffset2) ||
+                    isRealCell(inst->fOffset2)) {
+                    return false;
+                }
+                break;
+        }
+
+        if (inst->getBranch1() &&
+            !getClassLookups(inst->getBranch1(), int_offset, int_size, real_offset, real_size, lookups)) {
+            return false;
+        }
+        if (inst->getBranch2() &&
+            !getClassLookups(inst->getBranch2(), int_offset, int_size, real_offset, real_size, lookups)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ The compiler places the static tables at the end of the heaps. If the instances only read them with
+ kLoadIndexedReal/kLoadIndexedInt, these lookups read the class segment of the factory instead, and the tables
+ are not part of the instance heaps anymore. Otherwise (or with FBC code produced by an older compiler,
+ where the tables start the heaps) the segment is copied in each instance.
+*/
+template <class T, int TRACE>
+void interpreter_dsp_factory_aux<T, TRACE>::shareClassSegment()
+{
+    try {
+        getClassSegment();
+    } catch (faustexception& e) {
+        // Reported by classInit
+        return;
+    }
+    FBCClassSegment<T>* segment = fClassSegment;
+
+    // Class cells at the end of the heaps
+    int int_offset  = fIntHeapSize;
+    int real_offset = fRealHeapSize;
+    while (int_offset > 0 && segment->isIntCell(int_offset - 1)) int_offset--;
+    while (real_offset > 0 && segment->isRealCell(real_offset - 1)) real_offset--;
+    if (int_offset == fIntHeapSize && real_offset == fRealHeapSize) return;
+
+    // Fields used by the architecture and the UI
+    if (fSROffset >= int_offset || fCountOffset >= int_offset || fIOTAOffset >= int_offset) return;
+    for (auto& it : fUserInterfaceBlock->fInstructions) {
+        if (it->fOpcode != FBCInstruction::kAddSoundfile && it->fOffset >= real_offset) return;
+    }
+
+    std::vector<FBCBasicInstruction<T>*> lookups;
+    FBCBlockInstruction<T>*              blocks[] = {fInitBlock, fResetUIBlock, fClearBlock, fComputeBlock,
+                                                     fComputeDSPBlock};
+    for (auto& it : blocks) {
+        if (!getClassLookups(it, int_offset, fIntHeapSize, real_offset, fRealHeapSize, lookups)) return;
+    }
+
+    for (auto& it : lookups) {
+        it->fOpcode = (it->fOpcode == FBCInstruction::kLoadIndexedReal) ? FBCInstruction::kLoadIndexedClassReal
+                                                                        : FBCInstruction::kLoadIndexedClassInt;
+    }
+    segment->share(int_offset, real_offset);
+    fIntClassOffset  = int_offset;
+    fRealClassOffset = real_offset;
+}
+
 template <class T, int TRACE>
 dsp* interpreter_dsp_factory_aux<T, TRACE>::createDSPInstance(dsp_factory* factory)
 {
@@ -19,6 +19,13 @@
  ************************************************************************
  ************************************************************************/
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "interpreter_dsp.hh"
 #include "compatibility.hh"
 #include "libfaust.h"
@@ -127,8 +134,16 @@ static string read_real_type(istream* in)
     return type;
 }
 
+static interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineAux(const char* machine_code, size_t size,
+                                                                        string& error_msg);
+
 static interpreter_dsp_factory* readInterpreterDSPFactoryFromBitcodeAux(const string& bitcode, string& error_msg)
 {
+    // Binary files can also be read here
+    if (FBCBinaryReader<float>::isBinary(bitcode.c_str(), bitcode.size())) {
+        return readInterpreterDSPFactoryFromMachineAux(bitcode.c_str(), bitcode.size(), error_msg);
+    }
+    
     try {
         dsp_factory_table<SDsp_factory>::factory_iterator it;
         
@@ -151,8 +166,8 @@ static interpreter_dsp_factory* readInterpreterDSPFactoryFromBitcodeAux(const st
                 throw faustexception("ERROR : unrecognized file format\n");
             }
 
-            gInterpreterFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            gInterpreterFactoryTable.setFactory(factory);
             factory->setDSPCode(bitcode);
             return factory;
         }
@@ -204,6 +219,103 @@ EXPORT void writeInterpreterDSPFactoryToBitcodeFile(interpreter_dsp_factory* fac
     factory->write(&writer, true);
 }
 
+// Binary format: no parsing, the buffer is directly decoded and can be released after the call
+
+static interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineAux(const char* machine_code, size_t size,
+                                                                        string& error_msg)
+{
+    try {
+        dsp_factory_table<SDsp_factory>::factory_iterator it;
+        
+        string sha_key = generateSHA1(machine_code, size);
+        
+        if (gInterpreterFactoryTable.getFactory(sha_key, it)) {
+            SDsp_factory sfactory = (*it).first;
+            sfactory->addReference();
+            return sfactory;
+        } else {
+            interpreter_dsp_factory* factory   = nullptr;
+            int                      real_size = FBCBinaryReader<float>::getRealSize(machine_code, size);
+            
+            if (real_size == sizeof(float)) {
+                factory = new interpreter_dsp_factory(interpreter_dsp_factory_aux<float, 0>::readBinary(machine_code, size));
+            } else if (real_size == sizeof(double)) {
+                factory = new interpreter_dsp_factory(interpreter_dsp_factory_aux<double, 0>::readBinary(machine_code, size));
+            } else {
+                throw faustexception("ERROR : unrecognized file format\n");
+            }
+            
+            factory->setSHAKey(sha_key);
+            gInterpreterFactoryTable.setFactory(factory);
+            return factory;
+        }
+    } catch (faustexception& e) {
+        error_msg = e.Message();
+        return nullptr;
+    }
+}
+
+EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachine(const string& machine_code, string& error_msg)
+{
+    LOCK_API
+    return readInterpreterDSPFactoryFromMachineAux(machine_code.c_str(), machine_code.size(), error_msg);
+}
+
+EXPORT string writeInterpreterDSPFactoryToMachine(interpreter_dsp_factory* factory)
+{
+    LOCK_API
+    return factory->getBinaryCode();
+}
+
+EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineFile(const string& machine_code_path,
+                                                                         string&       error_msg)
+{
+    LOCK_API
+#ifndef _WIN32
+    // The file is memory-mapped and decoded in place
+    int fd = open(machine_code_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error_msg = "ERROR opening file '" + machine_code_path + "'\n";
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        error_msg = "ERROR reading file '" + machine_code_path + "'\n";
+        return nullptr;
+    }
+    void* buffer = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buffer == MAP_FAILED) {
+        error_msg = "ERROR mapping file '" + machine_code_path + "'\n";
+        return nullptr;
+    }
+    interpreter_dsp_factory* factory =
+        readInterpreterDSPFactoryFromMachineAux(static_cast<const char*>(buffer), size_t(st.st_size), error_msg);
+    munmap(buffer, size_t(st.st_size));
+    return factory;
+#else
+    ifstream reader(machine_code_path.c_str(), ios::in | ios::binary);
+    if (reader.is_open()) {
+        string machine_code(istreambuf_iterator<char>(reader), {});
+        return readInterpreterDSPFactoryFromMachineAux(machine_code.c_str(), machine_code.size(), error_msg);
+    } else {
+        error_msg = "ERROR opening file '" + machine_code_path + "'\n";
+        return nullptr;
+    }
+#endif
+}
+
+EXPORT bool writeInterpreterDSPFactoryToMachineFile(interpreter_dsp_factory* factory, const string& machine_code_path)
+{
+    LOCK_API
+    ofstream writer(machine_code_path.c_str(), ios::out | ios::binary);
+    if (!writer.is_open()) return false;
+    string machine_code = factory->getBinaryCode();
+    writer.write(machine_code.c_str(), streamsize(machine_code.size()));
+    return bool(writer);
+}
+
 EXPORT void interpreter_dsp::metadata(Meta* meta)
 {
     fDSP->metadata(meta);
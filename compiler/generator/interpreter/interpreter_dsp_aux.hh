@@ -27,6 +27,7 @@
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -34,7 +35,9 @@
 #include "dsp_factory.hh"
 #include "export.hh"
 #include "interpreter_bytecode.hh"
+#include "fbc_binary.hh"
 #include "fbc_interpreter.hh"
+#include "fbc_reg_interpreter.hh"
 
 static inline void checkToken(const std::string& token, const std::string& expected)
 {
@@ -75,6 +78,18 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
     FBCBlockInstruction<T>*              fComputeBlock;
     FBCBlockInstruction<T>*              fComputeDSPBlock;
 
+    // Non-optimized 'compute' blocks, kept to be lowered by the register based interpreter
+    FBCBlockInstruction<T>* fRegComputeBlock;
+    FBCBlockInstruction<T>* fRegComputeDSPBlock;
+
+    // Heap cells written by 'fStaticInitBlock', built at first use and copied in each instance
+    FBCClassSegment<T>* fClassSegment;
+    std::mutex          fClassSegmentLock;
+
+    // Start of the tables read in the class segment by all instances (heap size if none), so size of the instance heaps
+    int fIntClassOffset;
+    int fRealClassOffset;
+
     interpreter_dsp_factory_aux(const std::string& name, const std::string& compile_options, const std::string& sha_key,
                                 int version_num, int inputs, int outputs, int int_heap_size, int real_heap_size,
                                 int sound_heap_size, int sr_offset, int count_offset, int iota_offset, int opt_level,
@@ -102,12 +117,21 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
           fResetUIBlock(resetui),
           fClearBlock(clear),
           fComputeBlock(compute_control),
-          fComputeDSPBlock(compute_dsp)
+          fComputeDSPBlock(compute_dsp),
+          fRegComputeBlock(nullptr),
+          fRegComputeDSPBlock(nullptr),
+          fClassSegment(nullptr),
+          fIntClassOffset(int_heap_size),
+          fRealClassOffset(real_heap_size)
     {}
 
     virtual FBCExecutor<T>* createFBCExecutor()
     {
-       return new FBCInterpreter<T, TRACE>(this);
+        if (fRegComputeBlock) {
+            return new FBCRegInterpreter<T, TRACE>(this);
+        } else {
+            return new FBCInterpreter<T, TRACE>(this);
+        }
     }
 
     virtual ~interpreter_dsp_factory_aux()
@@ -121,9 +145,16 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
         delete fClearBlock;
         delete fComputeBlock;
         delete fComputeDSPBlock;
+        delete fRegComputeBlock;
+        delete fRegComputeDSPBlock;
+        delete fClassSegment;
     }
 
     void optimize(); // moved in interpreted_dsp.hh
+
+    const FBCClassSegment<T>* getClassSegment(); // moved in interpreted_dsp.hh
+
+    void shareClassSegment(); // moved in interpreted_dsp.hh
  
     void write(std::ostream* out, bool binary = false, bool small = false)
     {
@@ -206,9 +237,45 @@ struct interpreter_dsp_factory_aux : public dsp_factory_imp {
         }
     }
 
+    // Binary format (see fbc_binary.hh)
+    std::string getBinaryCode()
+    {
+        FBCBinaryWriter<T> writer;
+        FBCBinaryHeader    header;
+        memset(&header, 0, sizeof(header));
+
+        header.fFaustVersion   = writer.addString(FAUSTVERSION);
+        header.fCompileOptions = writer.addString(fCompileOptions);
+        header.fName           = writer.addString(fName);
+        header.fSHAKey         = writer.addString(fSHAKey);
+        header.fOptLevel       = fOptLevel;
+        header.fNumInputs      = fNumInputs;
+        header.fNumOutputs     = fNumOutputs;
+        header.fIntHeapSize    = fIntHeapSize;
+        header.fRealHeapSize   = fRealHeapSize;
+        header.fSoundHeapSize  = fSoundHeapSize;
+        header.fSROffset       = fSROffset;
+        header.fCountOffset    = fCountOffset;
+        header.fIOTAOffset     = fIOTAOffset;
+
+        writer.addMetaBlock(fMetaBlock);
+        writer.addUIBlock(fUserInterfaceBlock);
+        header.fRootBlocks[0] = writer.addCodeBlock(fStaticInitBlock);
+        header.fRootBlocks[1] = writer.addCodeBlock(fInitBlock);
+        header.fRootBlocks[2] = writer.addCodeBlock(fResetUIBlock);
+        header.fRootBlocks[3] = writer.addCodeBlock(fClearBlock);
+        header.fRootBlocks[4] = writer.addCodeBlock(fComputeBlock);
+        header.fRootBlocks[5] = writer.addCodeBlock(fComputeDSPBlock);
+
+        return writer.write(header);
+    }
+
     // Factory reader
     static interpreter_dsp_factory_aux<T, TRACE>* read(std::istream* in);
 
+    // Binary factory reader, 'buffer' is not used anymore after the call (so can be an unmapped file)
+    static interpreter_dsp_factory_aux<T, TRACE>* readBinary(const char* buffer, size_t size);
+
     static std::string parseStringToken(std::stringstream* inst)
     {
         std::string token;
@@ -488,9 +555,40 @@ class interpreter_dsp_aux : public interpreter_dsp_base {
     interpreter_dsp_factory_aux<T, TRACE>* fFactory;
     FBCExecutor<T>*                        fFBCExecutor;
 
+    /*
+     Profiling mode (FAUST_INTERP_PROFILE_FILE=<file>): the block sizes and the 'select' branches are recorded,
+     and added to the file content when the instance is deleted.
+     The file can then be given to the compiler with the '-pgo <file>' option.
+    */
+    DSPProfile* fProfile;
+    std::string fProfileFile;
+
+    void initProfile()
+    {
+        const char* profile_file = getenv("FAUST_INTERP_PROFILE_FILE");
+        if (profile_file && fFBCExecutor->getRealHeap()) {
+            fProfile     = new DSPProfile();
+            fProfileFile = profile_file;
+            fFBCExecutor->setProfile(fProfile);
+        }
+    }
+
+    void writeProfile()
+    {
+        static std::mutex gProfileLock;
+        std::lock_guard<std::mutex> lock(gProfileLock);
+        // Accumulate with the previous runs
+        DSPProfile profile;
+        profile.read(fProfileFile);
+        profile.merge(*fProfile);
+        if (!profile.write(fProfileFile)) {
+            std::cerr << "ERROR : cannot write profile file : " << fProfileFile << std::endl;
+        }
+    }
+
    public:
     interpreter_dsp_aux()
-        : fInitialized(false), fTraceOutput(false), fCycle(0), fFactory(nullptr), fFBCExecutor(nullptr)
+        : fInitialized(false), fTraceOutput(false), fCycle(0), fFactory(nullptr), fFBCExecutor(nullptr), fProfile(nullptr)
     {
     }
 
@@ -500,13 +598,19 @@ class interpreter_dsp_aux : public interpreter_dsp_base {
         fInitialized = false;
         fCycle = 0;
         fTraceOutput = getenv("FAUST_INTERP_OUTPUT") != NULL;
+        fProfile = nullptr;
         // Done before createFBCExecutor that may compile blocks...
         fFactory->optimize();
         fFBCExecutor = factory->createFBCExecutor();
+        initProfile();
     }
 
     virtual ~interpreter_dsp_aux()
     {
+        if (fProfile) {
+            writeProfile();
+            delete fProfile;
+        }
         delete fFBCExecutor;
     }
 
@@ -553,8 +657,15 @@ class interpreter_dsp_aux : public interpreter_dsp_base {
         }
         
         try {
-            // Execute static init instructions
-            fFBCExecutor->ExecuteBlock(fFactory->fStaticInitBlock);
+            // The tables are computed once by the factory, and copied in the instance heaps when not shared
+            int* int_heap  = fFBCExecutor->getIntHeap();
+            T*   real_heap = fFBCExecutor->getRealHeap();
+            if (int_heap && real_heap) {
+                fFactory->getClassSegment()->copy(int_heap, real_heap);
+            } else {
+                // Execute static init instructions
+                fFBCExecutor->ExecuteBlock(fFactory->fStaticInitBlock);
+            }
         } catch (faustexception& e) {
             std::cerr << e.Message();
             exit(1);
@@ -619,7 +730,8 @@ class interpreter_dsp_aux : public interpreter_dsp_base {
             std::cout << "instanceInit " << sample_rate << std::endl;
         }
         
-        // classInit has to be called for each instance since the tables are actually not shared between instances
+        // classInit has to be called for each instance since the tables are part of the instance heaps,
+        // but it only copies the ones computed by the factory
         classInit(sample_rate);
         
         instanceConstants(sample_rate);
@@ -636,7 +748,7 @@ class interpreter_dsp_aux : public interpreter_dsp_base {
         
         fInitialized = true;
         
-        // classInit is not called here since the tables are actually not shared between instances
+        // classInit is not called here since it is done by instanceInit (see above)
         instanceInit(sample_rate);
     }
 
@@ -705,6 +817,8 @@ class interpreter_dsp_aux : public interpreter_dsp_base {
             // Set count in 'count' variable at the correct offset in fIntHeap
             fFBCExecutor->setIntValue(fFactory->fCountOffset, count);
             
+            if (fProfile) fProfile->addCount(count);
+            
             try {
                 
                 // Executes the 'control' block
@@ -865,6 +979,8 @@ class EXPORT interpreter_dsp_factory : public dsp_factory, public faust_smartabl
     dsp_factory_base* getFactory() { return fFactory; }
 
     void write(std::ostream* out, bool binary = false, bool small = false) { fFactory->write(out, binary, small); }
+
+    std::string getBinaryCode() { return fFactory->getBinaryCode(); }
 };
 
 EXPORT interpreter_dsp_factory* getInterpreterDSPFactoryFromSHAKey(const std::string& sha_key);
@@ -885,6 +1001,17 @@ EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromBitcodeFile(const s
 
 EXPORT void writeInterpreterDSPFactoryToBitcodeFile(interpreter_dsp_factory* factory, const std::string& bitcode_path);
 
+EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachine(const std::string& machine_code,
+                                                                     std::string&       error_msg);
+
+EXPORT std::string writeInterpreterDSPFactoryToMachine(interpreter_dsp_factory* factory);
+
+EXPORT interpreter_dsp_factory* readInterpreterDSPFactoryFromMachineFile(const std::string& machine_code_path,
+                                                                         std::string&       error_msg);
+
+EXPORT bool writeInterpreterDSPFactoryToMachineFile(interpreter_dsp_factory* factory,
+                                                    const std::string&       machine_code_path);
+
 EXPORT void deleteAllInterpreterDSPFactories();
 
 #endif
@@ -167,8 +167,8 @@ class interpreter_dsp_aux_pe : public interpreter_dsp_aux<T, TRACE> {
             
         #ifndef MACHINE
             // // LLVM JIT only works on unoptimized FBC
-            this->fComputeBlock    = FBCInstructionOptimizer<T>::optimizeBlock(this->fComputeBlock, 5, 6);
-            this->fComputeDSPBlock = FBCInstructionOptimizer<T>::optimizeBlock(this->fComputeDSPBlock, 5, 6);
+            this->fComputeBlock    = FBCInstructionOptimizer<T>::optimizeBlock(this->fComputeBlock, 5, INTER_MAX_OPT_LEVEL);
+            this->fComputeDSPBlock = FBCInstructionOptimizer<T>::optimizeBlock(this->fComputeDSPBlock, 5, INTER_MAX_OPT_LEVEL);
         #endif
             
             /*
@@ -23,6 +23,8 @@
 #define _INTERPRETER_INSTRUCTIONS_H
 
 #include <cstdlib>
+#include <set>
+#include <vector>
 
 #include "exception.hh"
 #include "fbc_interpreter.hh"
@@ -38,7 +40,7 @@ struct InterpreterInstVisitor : public DispatchVisitor {
      Global functions names table as a static variable in the visitor
      so that each function prototype is generated as most once in the module.
     */
-    static std::map<std::string, FBCInstruction::Opcode> gMathLibTable;
+    static thread_local std::map<std::string, FBCInstruction::Opcode> gMathLibTable;
 
     int  fRealHeapOffset;   // Offset in Real HEAP
     int  fIntHeapOffset;    // Offset in Integer HEAP
@@ -47,17 +49,26 @@ struct InterpreterInstVisitor : public DispatchVisitor {
 
     std::map<std::string, MemoryDesc> fFieldTable;  // Table : field_name, { offset, size, type }
 
+    // Static fields (the tables filled by 'classInit') are placed after the instance fields,
+    // so that they can be shared between instances (see interpreter_dsp_factory_aux::shareClassSegment)
+    int                                                   fClassRealHeapOffset;
+    int                                                   fClassIntHeapOffset;
+    std::set<std::string>                                 fClassFields;
+    std::vector<std::pair<FBCBasicInstruction<T>*, bool>> fClassInstructions;  // { instruction, is_int }
+
     FIRUserInterfaceBlockInstruction<T>* fUserInterfaceBlock;
     FBCBlockInstruction<T>*              fCurrentBlock;
 
     InterpreterInstVisitor()
     {
-        fUserInterfaceBlock = new FIRUserInterfaceBlockInstruction<T>();
-        fCurrentBlock       = new FBCBlockInstruction<T>();
-        fRealHeapOffset     = 0;
-        fIntHeapOffset      = 0;
-        fSoundHeapOffset    = 0;
-        fCommute            = true;
+        fUserInterfaceBlock  = new FIRUserInterfaceBlockInstruction<T>();
+        fCurrentBlock        = new FBCBlockInstruction<T>();
+        fRealHeapOffset      = 0;
+        fIntHeapOffset       = 0;
+        fSoundHeapOffset     = 0;
+        fClassRealHeapOffset = 0;
+        fClassIntHeapOffset  = 0;
+        fCommute             = true;
         initMathTable();
     }
 
@@ -68,6 +79,38 @@ struct InterpreterInstVisitor : public DispatchVisitor {
         return (fFieldTable.find(name) != fFieldTable.end()) ? fFieldTable[name].fOffset : -1;
     }
 
+    // Push an instruction accessing the field 'name', to be relocated if it is a static field
+    void pushField(const std::string& name, FBCBasicInstruction<T>* inst)
+    {
+        if (fClassFields.find(name) != fClassFields.end()) {
+            fClassInstructions.push_back(std::make_pair(inst, fFieldTable[name].fType == Typed::kInt32));
+        }
+        fCurrentBlock->push(inst);
+    }
+
+    // To be called once all blocks are generated: the static fields are moved at the end of the heaps
+    void relocateClassFields()
+    {
+        for (auto& it : fClassInstructions) {
+            int offset = (it.second) ? fIntHeapOffset : fRealHeapOffset;
+            it.first->fOffset1 += offset;
+            if (it.first->fOpcode == FBCInstruction::kBlockShiftReal ||
+                it.first->fOpcode == FBCInstruction::kBlockShiftInt) {
+                it.first->fOffset2 += offset;
+            }
+        }
+        for (auto& it : fClassFields) {
+            MemoryDesc& desc = fFieldTable[it];
+            desc.fOffset += (desc.fType == Typed::kInt32) ? fIntHeapOffset : fRealHeapOffset;
+        }
+        fIntHeapOffset += fClassIntHeapOffset;
+        fRealHeapOffset += fClassRealHeapOffset;
+        fClassIntHeapOffset  = 0;
+        fClassRealHeapOffset = 0;
+        fClassFields.clear();
+        fClassInstructions.clear();
+    }
+
     void initMathTable()
     {
         // Integer version
@@ -254,7 +297,19 @@ struct InterpreterInstVisitor : public DispatchVisitor {
         ArrayTyped* array_typed = dynamic_cast<ArrayTyped*>(inst->fType);
         faustassert(fFieldTable.find(inst->fAddress->getName()) == fFieldTable.end());
 
-        if (array_typed && array_typed->fSize > 1) {
+        if (array_typed && array_typed->fSize > 1 && (inst->fAddress->getAccess() & Address::kStaticStruct)) {
+            // Relocated by 'relocateClassFields'
+            fClassFields.insert(inst->fAddress->getName());
+            if (array_typed->fType->getType() == Typed::kInt32) {
+                fFieldTable[inst->fAddress->getName()] =
+                    MemoryDesc(-1, fClassIntHeapOffset, array_typed->fSize, array_typed->fType->getType());
+                fClassIntHeapOffset += array_typed->fSize;
+            } else {
+                fFieldTable[inst->fAddress->getName()] =
+                    MemoryDesc(-1, fClassRealHeapOffset, array_typed->fSize, array_typed->fType->getType());
+                fClassRealHeapOffset += array_typed->fSize;
+            }
+        } else if (array_typed && array_typed->fSize > 1) {
             if (array_typed->fType->getType() == Typed::kInt32) {
                 fFieldTable[inst->fAddress->getName()] =
                     MemoryDesc(-1, fIntHeapOffset, array_typed->fSize, array_typed->fType->getType());
@@ -301,16 +356,16 @@ struct InterpreterInstVisitor : public DispatchVisitor {
 
             switch (tmp.fType) {
                 case Typed::kInt32:
-                    fCurrentBlock->push(
-                        new FBCBasicInstruction<T>(FBCInstruction::kLoadInt, named->getName(), 0, 0, tmp.fOffset, 0));
+                    pushField(named->getName(),
+                              new FBCBasicInstruction<T>(FBCInstruction::kLoadInt, named->getName(), 0, 0, tmp.fOffset, 0));
                     break;
                 case Typed::kSound_ptr:
                     fCurrentBlock->push(
                         new FBCBasicInstruction<T>(FBCInstruction::kLoadSound, named->getName(), 0, 0, tmp.fOffset, 0));
                     break;
                 default:
-                    fCurrentBlock->push(
-                        new FBCBasicInstruction<T>(FBCInstruction::kLoadReal, named->getName(), 0, 0, tmp.fOffset, 0));
+                    pushField(named->getName(),
+                              new FBCBasicInstruction<T>(FBCInstruction::kLoadReal, named->getName(), 0, 0, tmp.fOffset, 0));
                     break;
             }
 
@@ -332,10 +387,11 @@ struct InterpreterInstVisitor : public DispatchVisitor {
                 } else {
                     MemoryDesc tmp = fFieldTable[indexed->getName()];
                     faustassert(tmp.fOffset >= 0);
-                    fCurrentBlock->push(new FBCBasicInstruction<T>((tmp.fType == Typed::kInt32)
-                                                                       ? FBCInstruction::kLoadIndexedInt
-                                                                       : FBCInstruction::kLoadIndexedReal,
-                                                                   indexed->getName(), 0, 0, tmp.fOffset, tmp.fSize));
+                    pushField(indexed->getName(), new FBCBasicInstruction<T>((tmp.fType == Typed::kInt32)
+                                                                                 ? FBCInstruction::kLoadIndexedInt
+                                                                                 : FBCInstruction::kLoadIndexedReal,
+                                                                             indexed->getName(), 0, 0, tmp.fOffset,
+                                                                             tmp.fSize));
                 }
             }
         }
@@ -358,15 +414,15 @@ struct InterpreterInstVisitor : public DispatchVisitor {
                 case Typed::kInt32: {
                     Int32ArrayNumInst* int_array = dynamic_cast<Int32ArrayNumInst*>(value);
                     faustassert(int_array);
-                    fCurrentBlock->push(new FIRBlockStoreIntInstruction<T>(FBCInstruction::kBlockStoreInt, tmp.fOffset,
-                                                                           int(int_array->fNumTable.size()),
-                                                                           int_array->fNumTable));
+                    pushField(address->getName(),
+                              new FIRBlockStoreIntInstruction<T>(FBCInstruction::kBlockStoreInt, tmp.fOffset,
+                                                                 int(int_array->fNumTable.size()), int_array->fNumTable));
                     break;
                 }
                 case Typed::kFloat: {
                     FloatArrayNumInst* float_array = dynamic_cast<FloatArrayNumInst*>(value);
                     faustassert(float_array);
-                    fCurrentBlock->push(new FIRBlockStoreRealInstruction<T>(
+                    pushField(address->getName(), new FIRBlockStoreRealInstruction<T>(
                         FBCInstruction::kBlockStoreReal, tmp.fOffset, int(float_array->fNumTable.size()),
                         reinterpret_cast<const std::vector<T>&>(float_array->fNumTable)));
                     break;
@@ -374,7 +430,7 @@ struct InterpreterInstVisitor : public DispatchVisitor {
                 case Typed::kDouble: {
                     DoubleArrayNumInst* double_array = dynamic_cast<DoubleArrayNumInst*>(value);
                     faustassert(double_array);
-                    fCurrentBlock->push(new FIRBlockStoreRealInstruction<T>(
+                    pushField(address->getName(), new FIRBlockStoreRealInstruction<T>(
                         FBCInstruction::kBlockStoreReal, tmp.fOffset, int(double_array->fNumTable.size()),
                         reinterpret_cast<const std::vector<T>&>(double_array->fNumTable)));
                     break;
@@ -396,16 +452,16 @@ struct InterpreterInstVisitor : public DispatchVisitor {
 
                 switch (tmp.fType) {
                     case Typed::kInt32:
-                        fCurrentBlock->push(new FBCBasicInstruction<T>(FBCInstruction::kStoreInt, named->getName(), 0,
-                                                                       0, tmp.fOffset, 0));
+                        pushField(named->getName(), new FBCBasicInstruction<T>(FBCInstruction::kStoreInt,
+                                                                               named->getName(), 0, 0, tmp.fOffset, 0));
                         break;
                     case Typed::kSound_ptr:
                         fCurrentBlock->push(new FBCBasicInstruction<T>(FBCInstruction::kStoreSound, named->getName(), 0,
                                                                        0, tmp.fOffset, 0));
                         break;
                     default:
-                        fCurrentBlock->push(new FBCBasicInstruction<T>(FBCInstruction::kStoreReal, named->getName(), 0,
-                                                                       0, tmp.fOffset, 0));
+                        pushField(named->getName(), new FBCBasicInstruction<T>(FBCInstruction::kStoreReal,
+                                                                               named->getName(), 0, 0, tmp.fOffset, 0));
                         break;
                 }
 
@@ -422,10 +478,11 @@ struct InterpreterInstVisitor : public DispatchVisitor {
                 } else {
                     MemoryDesc tmp = fFieldTable[indexed->getName()];
                     faustassert(tmp.fOffset >= 0);
-                    fCurrentBlock->push(new FBCBasicInstruction<T>((tmp.fType == Typed::kInt32)
-                                                                       ? FBCInstruction::kStoreIndexedInt
-                                                                       : FBCInstruction::kStoreIndexedReal,
-                                                                   indexed->getName(), 0, 0, tmp.fOffset, tmp.fSize));
+                    pushField(indexed->getName(), new FBCBasicInstruction<T>((tmp.fType == Typed::kInt32)
+                                                                                 ? FBCInstruction::kStoreIndexedInt
+                                                                                 : FBCInstruction::kStoreIndexedReal,
+                                                                             indexed->getName(), 0, 0, tmp.fOffset,
+                                                                             tmp.fSize));
                 }
             }
         }
@@ -436,7 +493,7 @@ struct InterpreterInstVisitor : public DispatchVisitor {
     virtual void visit(ShiftArrayVarInst* inst)
     {
         MemoryDesc tmp = fFieldTable[inst->fAddress->getName()];
-        fCurrentBlock->push(new FBCBasicInstruction<T>(
+        pushField(inst->fAddress->getName(), new FBCBasicInstruction<T>(
             (tmp.fType == Typed::kInt32) ? FBCInstruction::kBlockShiftInt : FBCInstruction::kBlockShiftReal, 0, 0,
             tmp.fOffset + inst->fDelay, tmp.fOffset));
     }
@@ -589,9 +646,9 @@ struct InterpreterInstVisitor : public DispatchVisitor {
         // Add kReturn in block
         else_block->push(new FBCBasicInstruction<T>(FBCInstruction::kReturn));
 
-        // Compile 'select'
+        // Compile 'select' (the profile key is kept to record the taken branches, see FAUST_INTERP_PROFILE_FILE)
         current->push(new FBCBasicInstruction<T>((real_t1) ? FBCInstruction::kSelectReal : FBCInstruction::kSelectInt,
-                                                  "", 0, 0, 0, 0, then_block, else_block));
+                                                  "", inst->fProfileKey, 0, 0, 0, then_block, else_block));
 
         // Restore current block
         fCurrentBlock = current;
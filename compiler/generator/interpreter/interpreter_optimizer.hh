@@ -22,15 +22,21 @@
 #ifndef _FIR_INTERPRETER_OPTIMIZER_H
 #define _FIR_INTERPRETER_OPTIMIZER_H
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "exception.hh"
 #include "interpreter_bytecode.hh"
 
-#define INTER_MAX_OPT_LEVEL 6
+#define INTER_MAX_OPT_LEVEL 7
+
+// Factory opt level using the register based interpreter for the 'compute' blocks
+#define INTER_REG_OPT_LEVEL 8
 
 // Tables for math optimization
 
@@ -46,6 +52,9 @@ static std::map<FBCInstruction::Opcode, FBCInstruction::Opcode> gFIRExtendedMath
 static std::map<FBCInstruction::Opcode, FBCInstruction::Opcode> gFIRExtendedMath2Value;
 static std::map<FBCInstruction::Opcode, FBCInstruction::Opcode> gFIRExtendedMath2ValueInvert;
 
+// Factories may be compiled and optimized concurrently : tables are filled once, under this lock
+static std::mutex gFIRMathTablesLock;
+
 //=======================
 // Optimization
 //=======================
@@ -254,6 +263,7 @@ struct FBCInstructionMathOptimizer : public FBCInstructionOptimizer<T> {
     
     FBCInstructionMathOptimizer()
     {
+        std::lock_guard<std::mutex> lock(gFIRMathTablesLock);
         if (gFIRMath2Heap.size() > 0) {
             // Already initialized
             return;
@@ -563,6 +573,139 @@ struct FBCInstructionMathOptimizer : public FBCInstructionOptimizer<T> {
     }
 };
 
+/*
+ Superinstructions: fuse the most frequent opcode sequences of the optimized code (found with
+ FBCInstructionProfiler on typical filters, reverbs and delays) in a single opcode, to lower the dispatch cost.
+ 
+ opcode 3 kLoadInt int 0 real 0 offset1 10 offset2 0
+ opcode 25 kLoadInput int 0 real 0 offset1 0 offset2 0
+ 
+ ==> opcode 272 kLoadInputHeap int 0 real 0 offset1 0 offset2 10
+ 
+ opcode 64 kMultRealHeap int 0 real 0 offset1 6 offset2 30
+ opcode 33 kAddReal int 0 real 0 offset1 -1 offset2 -1
+ 
+ ==> opcode 279 kMultRealHeapAddReal int 0 real 0 offset1 6 offset2 30
+ */
+
+template <class T>
+struct FBCInstructionFusionOptimizer : public FBCInstructionOptimizer<T> {
+    FBCInstructionFusionOptimizer() {}
+    
+    virtual ~FBCInstructionFusionOptimizer() {}
+    
+    FBCBasicInstruction<T>* rewrite(InstructionIT cur, InstructionIT& end)
+    {
+        FBCBasicInstruction<T>* &inst1 = *cur;
+        
+        // The last instruction of a block is always kReturn, so the next one can be accessed
+        if (inst1->fOpcode == FBCInstruction::kReturn) {
+            end = cur + 1;
+            return (*cur)->copy();
+        }
+        
+        FBCBasicInstruction<T>* &inst2 = *(cur + 1);
+        
+        if (inst1->fOpcode == FBCInstruction::kLoadInt && inst2->fOpcode == FBCInstruction::kLoadInput) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kLoadInputHeap, 0, 0, inst2->fOffset1, inst1->fOffset1);
+        } else if (inst1->fOpcode == FBCInstruction::kLoadInt && inst2->fOpcode == FBCInstruction::kStoreOutput) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kStoreOutputHeap, 0, 0, inst2->fOffset1, inst1->fOffset1);
+        } else if (inst1->fOpcode == FBCInstruction::kLoadInt &&
+                   inst2->fOpcode == FBCInstruction::kStoreIndexedReal) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kStoreIndexedRealHeap, inst1->fOffset1, 0,
+                                              inst2->fOffset1, inst2->fOffset2);
+        } else if (inst1->fOpcode == FBCInstruction::kLoadIndexedReal && inst2->fOpcode == FBCInstruction::kStoreReal) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kLoadIndexedRealStoreReal, inst2->fOffset1, 0,
+                                              inst1->fOffset1, inst1->fOffset2);
+        } else if (inst1->fOpcode == FBCInstruction::kSubIntValueInvert &&
+                   inst2->fOpcode == FBCInstruction::kANDIntStackValue) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kSubIntValueInvertANDInt, inst1->fIntValue, 0,
+                                              inst1->fOffset1, inst2->fIntValue);
+        } else if (inst1->fOpcode == FBCInstruction::kAddIntValue && inst2->fOpcode == FBCInstruction::kStoreInt) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kAddIntValueStoreInt, inst1->fIntValue, 0,
+                                              inst1->fOffset1, inst2->fOffset1);
+        } else if (inst1->fOpcode == FBCInstruction::kAddReal && inst2->fOpcode == FBCInstruction::kStoreReal) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kAddRealStoreReal, 0, 0, inst2->fOffset1, 0);
+        } else if (inst1->fOpcode == FBCInstruction::kMultRealHeap && inst2->fOpcode == FBCInstruction::kAddReal) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kMultRealHeapAddReal, 0, 0, inst1->fOffset1,
+                                              inst1->fOffset2);
+        } else if (inst1->fOpcode == FBCInstruction::kMultRealHeap && inst2->fOpcode == FBCInstruction::kAddRealStack) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kMultRealHeapAddRealStack, inst2->fOffset1, 0,
+                                              inst1->fOffset1, inst1->fOffset2);
+        } else if (inst1->fOpcode == FBCInstruction::kMultRealValue &&
+                   inst2->fOpcode == FBCInstruction::kAddRealStack) {
+            end = cur + 2;
+            return new FBCBasicInstruction<T>(FBCInstruction::kMultRealValueAddRealStack, 0, inst1->fRealValue,
+                                              inst1->fOffset1, inst2->fOffset1);
+        } else {
+            end = cur + 1;
+            return (*cur)->copy();
+        }
+    }
+};
+
+/*
+ Count the opcode sequences of a block (including sub-blocks), the ones inside loops being weighted
+ by kLoopWeight at each loop level, so that the most frequently executed sequences come first.
+ Used to choose the sequences to be fused as superinstructions.
+ */
+
+template <class T>
+struct FBCInstructionProfiler {
+    static const int kLoopWeight = 64;
+    
+    typedef std::vector<FBCInstruction::Opcode> Sequence;
+    
+    std::map<Sequence, long long> fSequences;
+    
+    void profile(FBCBlockInstruction<T>* block, int length, long long weight = 1)
+    {
+        for (InstructionIT it = block->fInstructions.begin(); it != block->fInstructions.end(); it++) {
+            if ((*it)->fOpcode == FBCInstruction::kLoop) {
+                profile((*it)->fBranch2, length, weight * kLoopWeight);
+            } else if (FBCInstruction::isChoice((*it)->fOpcode)) {
+                profile((*it)->fBranch1, length, weight);
+                profile((*it)->fBranch2, length, weight);
+            }
+            if (std::distance(it, block->fInstructions.end()) >= length) {
+                Sequence seq;
+                for (int i = 0; i < length; i++) {
+                    seq.push_back((*(it + i))->fOpcode);
+                }
+                fSequences[seq] += weight;
+            }
+        }
+    }
+    
+    void write(std::ostream* out, int max_count)
+    {
+        std::vector<std::pair<long long, Sequence>> sorted;
+        for (auto& it : fSequences) {
+            sorted.push_back(std::make_pair(it.second, it.first));
+        }
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const std::pair<long long, Sequence>& a, const std::pair<long long, Sequence>& b) {
+                             return a.first > b.first;
+                         });
+        for (int i = 0; i < int(sorted.size()) && i < max_count; i++) {
+            *out << sorted[i].first;
+            for (auto& opcode : sorted[i].second) {
+                *out << " " << gFBCInstructionTable[opcode];
+            }
+            *out << std::endl;
+        }
+    }
+};
+
 //============================================
 // Partial evaluation by constant propagation
 //============================================
@@ -1308,6 +1451,12 @@ struct FBCInstructionOptimizer {
             block = FBCInstructionOptimizer<T>::optimize(block, opt6);
         }
         
+        if (min_level <= 7 && 7 <= max_level) {
+            // 7) fuse frequent sequences in superinstructions
+            FBCInstructionFusionOptimizer<T> opt7;
+            block = FBCInstructionOptimizer<T>::optimize(block, opt7);
+        }
+        
         return block;
     }
 };
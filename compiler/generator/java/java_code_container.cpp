@@ -27,8 +27,8 @@
 
 using namespace std;
 
-map<string, bool>   JAVAInstVisitor::gFunctionSymbolTable;
-map<string, string> JAVAInstVisitor::gMathLibTable;
+thread_local map<string, bool>   JAVAInstVisitor::gFunctionSymbolTable;
+thread_local map<string, string> JAVAInstVisitor::gMathLibTable;
 
 dsp_factory_base* JAVACodeContainer::produceFactory()
 {
@@ -186,20 +186,21 @@ static void sha1_final(SHA1_CTX* ctx, uchar hash[])
 }
 
 /**
- * Generate SHA1 key from a string
+ * Generate SHA1 key from a memory buffer
  *
- * @param data - the string to be converted in SHA1 key
+ * @param data - the buffer to be converted in SHA1 key
+ * @param size - the buffer size in bytes
  *
  * @return the SHA key
  */
-LIBEXPORT inline std::string generateSHA1(const std::string& data)
+LIBEXPORT inline std::string generateSHA1(const char* data, size_t size)
 {
     SHA1_CTX      ctx;
     unsigned char obuf[20] = {0};
 
     // Hash one
     sha1_init(&ctx);
-    sha1_update(&ctx, (unsigned char*)data.c_str(), int(data.size()));
+    sha1_update(&ctx, (unsigned char*)data, int(size));
     sha1_final(&ctx, obuf);
 
     // convert SHA1 key into hexadecimal string
@@ -215,6 +216,18 @@ LIBEXPORT inline std::string generateSHA1(const std::string& data)
     return sha1key;
 }
 
+/**
+ * Generate SHA1 key from a string
+ *
+ * @param data - the string to be converted in SHA1 key
+ *
+ * @return the SHA key
+ */
+LIBEXPORT inline std::string generateSHA1(const std::string& data)
+{
+    return generateSHA1(data.c_str(), data.size());
+}
+
 /**
  * Expand a DSP source code into a self-contained DSP where all library import have been inlined starting from a
  * filename.
@@ -49,7 +49,7 @@ bool      linkModules(Module* dst, ModulePTR src, string& error);
 ModulePTR loadModule(const string& module_name, llvm::LLVMContext* context);
 Module*   linkAllModules(llvm::LLVMContext* context, Module* dst, string& error);
 
-list<string> LLVMInstVisitor::gMathLibTable;
+thread_local list<string> LLVMInstVisitor::gMathLibTable;
 
 CodeContainer* LLVMCodeContainer::createScalarContainer(const string& name, int sub_container_type)
 {
@@ -479,8 +479,8 @@ llvm_dsp_factory* llvm_dsp_factory_aux::readDSPFactoryFromMachineAux(MEMORY_BUFF
         llvm_dsp_factory_aux* factory_aux = new llvm_dsp_factory_aux(sha_key, MEMORY_BUFFER_GET(buffer).str(), target);
         if (factory_aux->initJIT(error_msg)) {
             llvm_dsp_factory* factory = new llvm_dsp_factory(factory_aux);
-            llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
             return factory;
         } else {
             error_msg = "ERROR : " + error_msg + "\n";
@@ -24,8 +24,11 @@
 #endif
 
 #include <string.h>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 
 #include "Text.hh"
@@ -380,8 +383,8 @@ static llvm_dsp_factory* readDSPFactoryFromBitcodeAux(MEMORY_BUFFER buffer, cons
 
         if (factory_aux->initJIT(error_msg)) {
             llvm_dsp_factory* factory = new llvm_dsp_factory(factory_aux);
-            llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
             return factory;
         } else {
             error_msg = "ERROR : " + error_msg;
@@ -503,8 +506,8 @@ static llvm_dsp_factory* readDSPFactoryFromIRAux(MEMORY_BUFFER buffer, const str
         
         if (factory_aux->initJIT(error_msg)) {
             llvm_dsp_factory* factory = new llvm_dsp_factory(factory_aux);
-            llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
             return factory;
         } else {
             error_msg = "ERROR : " + error_msg;
@@ -584,11 +587,20 @@ EXPORT llvm_dsp_factory* createDSPFactoryFromFile(const string& filename, int ar
     }
 }
 
-EXPORT llvm_dsp_factory* createDSPFactoryFromString(const string& name_app, const string& dsp_content, int argc,
-                                                    const char* argv[], const string& target, string& error_msg,
-                                                    int opt_level)
+// Path of the machine code entry in the persistent cache (see FAUST_CACHE_DIR), or "" if the cache is not activated
+static string getMachineCachePath(const string& name_app, const string& dsp_content, int argc, const char* argv[],
+                                  const string& target, int opt_level)
+{
+    string target_aux = (target == "") ? getDSPMachineTarget() : target;
+    stringstream cache_target;
+    cache_target << target_aux << ":" << opt_level;
+    return getFactoryCachePath(name_app, dsp_content, argc, argv, "llvm", cache_target.str());
+}
+
+static llvm_dsp_factory* createDSPFactoryFromStringAux(const string& name_app, const string& dsp_content, int argc,
+                                                       const char* argv[], const string& target, string& error_msg,
+                                                       int opt_level, bool use_cache)
 {
-    LOCK_API
     string expanded_dsp_content, sha_key;
     
     //if ((expanded_dsp_content = expandDSPFromString(name_app, dsp_content, argc, argv, sha_key, error_msg)) == "") {
@@ -599,52 +611,460 @@ EXPORT llvm_dsp_factory* createDSPFactoryFromString(const string& name_app, cons
         dsp_factory_table<SDsp_factory>::factory_iterator it;
         llvm_dsp_factory* factory = nullptr;
         
+        {
+            LOCK_API
+            if (llvm_dsp_factory_aux::gLLVMFactoryTable.getFactory(sha_key, it)) {
+                SDsp_factory sfactory = (*it).first;
+                sfactory->addReference();
+                return sfactory;
+            }
+        }
+        
+        // Possibly restore the machine code from the persistent cache
+        string target_aux = (target == "") ? getDSPMachineTarget() : target;
+        string cache_path = (use_cache) ? getMachineCachePath(name_app, dsp_content, argc, argv, target, opt_level) : "";
+        string machine_code;
+        if (cache_path != "" && readFactoryCacheFile(cache_path, machine_code)) {
+            llvm_dsp_factory_aux* factory_aux = new llvm_dsp_factory_aux(sha_key, base64_decode(machine_code), target_aux);
+            factory_aux->setClassName(getParam(argc, argv, "-cn", "mydsp"));
+            factory_aux->setName(name_app);
+            // A corrupted or outdated entry is ignored, and the DSP is compiled again
+            if (factory_aux->initJIT(error_msg)) {
+                LOCK_API
+                if (llvm_dsp_factory_aux::gLLVMFactoryTable.getFactory(sha_key, it)) {
+                    delete factory_aux;
+                    SDsp_factory sfactory = (*it).first;
+                    sfactory->addReference();
+                    return sfactory;
+                }
+                factory = new llvm_dsp_factory(factory_aux);
+                factory->setSHAKey(sha_key);
+                llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
+                factory->setDSPCode(expanded_dsp_content);
+                return factory;
+            } else {
+                delete factory_aux;
+                error_msg = "";
+            }
+        }
+        
+        int         argc1 = 0;
+        const char* argv1[64];
+        argv1[argc1++] = "faust";
+        argv1[argc1++] = "-lang";
+        // argv1[argc1++] = "cllvm";
+        argv1[argc1++] = "llvm";
+        argv1[argc1++] = "-o";
+        argv1[argc1++] = "string";
+        // Copy arguments
+        for (int i = 0; i < argc; i++) {
+            argv1[argc1++] = argv[i];
+        }
+        argv1[argc1] = nullptr;  // NULL terminated argv
+        
+        llvm_dynamic_dsp_factory_aux* factory_aux = nullptr;
+        try {
+            // The Faust compiler uses a per thread state, the LLVM optimization and JIT compilation
+            // work on the factory own module and context : both are done without holding the API lock.
+            // The timing reports (-time, -time-json) are written once the JIT compilation is done.
+            deferTimingReports(true);
+            factory_aux = static_cast<llvm_dynamic_dsp_factory_aux*>(
+                                                                     compileFaustFactory(argc1, argv1, name_app.c_str(), dsp_content.c_str(), error_msg, true));
+            deferTimingReports(false);
+            if (factory_aux) {
+                factory_aux->setTarget(target);
+                factory_aux->setOptlevel(opt_level);
+                factory_aux->setClassName(getParam(argc, argv, "-cn", "mydsp"));
+                factory_aux->setName(name_app);
+                if (!factory_aux->initJIT(error_msg)) {
+                    goto error;
+                }
+                writeTimingReports();
+                if (cache_path != "") {
+                    writeFactoryCacheFile(cache_path, factory_aux->writeDSPFactoryToMachine(""),
+                                          factory_aux->getLibraryList());
+                }
+                LOCK_API
+                // The same factory may have been created by another thread in the meantime
+                if (llvm_dsp_factory_aux::gLLVMFactoryTable.getFactory(sha_key, it)) {
+                    delete factory_aux;
+                    SDsp_factory sfactory = (*it).first;
+                    sfactory->addReference();
+                    return sfactory;
+                }
+                factory = new llvm_dsp_factory(factory_aux);
+                factory->setSHAKey(sha_key);
+                llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
+                factory->setDSPCode(expanded_dsp_content);
+                return factory;
+            }
+        } catch (faustexception& e) {
+            error_msg = e.what();
+            goto error;
+        }
+    error:
+        delete factory_aux;
+        return nullptr;
+    }
+}
+
+/*
+ Auto-tuning: the option families of dsp-optimizer.h are compiled and measured on the host CPU. In each family the
+ vector size is doubled until two steps in a row do not improve the family best result, the -mcd refinement of the
+ winner follows the same rule, and the search ends when the time budget is spent (keeping the best options found so
+ far). The winning options are kept in memory and in the persistent cache (see FAUST_CACHE_DIR), next to the machine
+ code, so that later loads of the same DSP with the same options directly give the tuned factory.
+*/
+
+// Options chosen by the tuning: a DSP compiled with one of them is not tuned
+static const char* gTunedParams[] = {"-scal", "-vec", "-vs", "-lv", "-fun", "-dfs", "-g", "-mcd", "-sch", "-omp", nullptr};
+
+// Tuned options (or an empty entry when the DSP has not been tuned), indexed by SHA key, target and optimization level.
+// The entries are also in the persistent cache, so the table is simply emptied when it gets too big.
+static mutex                                  gTunedOptionsLock;
+static map<string, pair<bool, vector<string>>> gTunedOptions;
+static const size_t                           gTunedOptionsMax = 1024;
+
+// To be called with gTunedOptionsLock held
+static void addTunedOptions(const string& key, bool tuned, const vector<string>& options)
+{
+    if (gTunedOptions.size() >= gTunedOptionsMax && gTunedOptions.find(key) == gTunedOptions.end()) {
+        gTunedOptions.clear();
+    }
+    gTunedOptions[key] = make_pair(tuned, options);
+}
+
+static bool hasParam(int argc, const char* argv[], const string& param)
+{
+    for (int i = 0; i < argc; i++) {
+        if (string(argv[i]) == param) return true;
+    }
+    return false;
+}
+
+static bool hasTunedParam(int argc, const char* argv[])
+{
+    for (int i = 0; gTunedParams[i]; i++) {
+        if (hasParam(argc, argv, gTunedParams[i])) return true;
+    }
+    return false;
+}
+
+static string getTuningCachePath(const string& name_app, const string& dsp_content, int argc, const char* argv[],
+                                 const string& target, int opt_level)
+{
+    string target_aux = (target == "") ? getDSPMachineTarget() : target;
+    stringstream cache_target;
+    cache_target << target_aux << ":" << opt_level;
+    return getFactoryCachePath(name_app, dsp_content, argc, argv, "tuning", cache_target.str());
+}
+
+static string getTuningKey(const string& name_app, const string& dsp_content, int argc, const char* argv[],
+                           const string& target, int opt_level)
+{
+    string sha_key;
+    sha1FromDSP(name_app, dsp_content, argc, argv, sha_key);
+    stringstream key;
+    key << sha_key << ":" << target << ":" << opt_level;
+    return key.str();
+}
+
+static bool getTunedOptions(const string& name_app, const string& dsp_content, int argc, const char* argv[],
+                            const string& target, int opt_level, vector<string>& options)
+{
+    string key = getTuningKey(name_app, dsp_content, argc, argv, target, opt_level);
+    {
+        lock_guard<mutex> lock(gTunedOptionsLock);
+        auto it = gTunedOptions.find(key);
+        if (it != gTunedOptions.end()) {
+            options = (*it).second.second;
+            return (*it).second.first;
+        }
+    }
+
+    // Otherwise look in the persistent cache, and remember the result (including a missing entry)
+    string path = getTuningCachePath(name_app, dsp_content, argc, argv, target, opt_level);
+    string content;
+    bool   found = (path != "") && readFactoryCacheFile(path, content);
+    options.clear();
+    if (found) {
+        stringstream reader(content);
+        string       option;
+        while (getline(reader, option)) {
+            if (option != "") options.push_back(option);
+        }
+    }
+    lock_guard<mutex> lock(gTunedOptionsLock);
+    addTunedOptions(key, found, options);
+    return found;
+}
+
+static void setTunedOptions(const string& name_app, const string& dsp_content, int argc, const char* argv[],
+                            const string& target, int opt_level, const vector<string>& options,
+                            const vector<string>& pathnames)
+{
+    {
+        lock_guard<mutex> lock(gTunedOptionsLock);
+        addTunedOptions(getTuningKey(name_app, dsp_content, argc, argv, target, opt_level), true, options);
+    }
+    string path = getTuningCachePath(name_app, dsp_content, argc, argv, target, opt_level);
+    if (path != "") {
+        stringstream writer;
+        for (const auto& it : options) writer << it << "\n";
+        writeFactoryCacheFile(path, writer.str(), pathnames);
+    }
+}
+
+static llvm_dsp_factory* createDSPFactoryWithOptions(const string& name_app, const string& dsp_content, int argc,
+                                                     const char* argv[], const vector<string>& options,
+                                                     const string& target, string& error_msg, int opt_level,
+                                                     bool use_cache)
+{
+    vector<const char*> argv1(argv, argv + argc);
+    for (const auto& it : options) argv1.push_back(it.c_str());
+    argv1.push_back(nullptr);  // NULL terminated argv
+    return createDSPFactoryFromStringAux(name_app, dsp_content, int(argv1.size()) - 1, argv1.data(), target,
+                                         error_msg, opt_level, use_cache);
+}
+
+class dsp_tuner {
+   private:
+    const string&      fNameApp;
+    const string&      fDSPContent;
+    int                fArgc;
+    const char**       fArgv;
+    const string&      fTarget;
+    int                fOptLevel;
+    int                fBufferSize;
+    bool               fDouble;
+    int                fBlocks;  // number of 'compute' calls in a measure, calibrated on the first measured DSP
+    chrono::time_point<chrono::steady_clock> fDeadline;
+
+    vector<vector<char>> fBuffers;
+    vector<FAUSTFLOAT*>  fChannels;
+
+    llvm_dsp_factory* fBestFactory;
+    double            fBest;  // in samples per second
+    vector<string>    fBestOptions;
+
+    bool timeOut() { return chrono::steady_clock::now() > fDeadline; }
+
+    // Duration in seconds of 'fBlocks' calls to 'compute'
+    double computeBlocks(dsp* dsp)
+    {
+        FAUSTFLOAT** inputs  = fChannels.data();
+        FAUSTFLOAT** outputs = fChannels.data() + dsp->getNumInputs();
+        auto         start   = chrono::steady_clock::now();
+        for (int i = 0; i < fBlocks; i++) {
+            dsp->compute(fBufferSize, inputs, outputs);
+        }
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Returns the best throughput of a few measures
+    double measure(dsp* dsp)
+    {
+        int ins   = dsp->getNumInputs();
+        int chans = ins + dsp->getNumOutputs();
+        int size  = fBufferSize * (fDouble ? sizeof(double) : sizeof(float));
+        fBuffers.resize(chans);
+        fChannels.resize(chans);
+        for (int i = 0; i < chans; i++) {
+            fBuffers[i].assign(size, 0);
+            fChannels[i] = reinterpret_cast<FAUSTFLOAT*>(fBuffers[i].data());
+        }
+        // Write noise in inputs (to avoid 'speedup' effect due to null values)
+        for (int i = 0; i < ins; i++) {
+            uint32_t seed = 0;
+            for (int j = 0; j < fBufferSize; j++) {
+                seed         = 12345 + 1103515245 * seed;
+                double noise = 4.656613e-10 * int32_t(seed);
+                if (fDouble) {
+                    reinterpret_cast<double*>(fChannels[i])[j] = noise;
+                } else {
+                    reinterpret_cast<float*>(fChannels[i])[j] = float(noise);
+                }
+            }
+        }
+        dsp->init(44100);
+
+        // A measure lasts about 20 ms
+        if (fBlocks == 0) {
+            fBlocks = 1;
+            while (computeBlocks(dsp) < 0.02 && fBlocks < (1 << 24)) fBlocks *= 2;
+        } else {
+            computeBlocks(dsp);
+        }
+        double best = computeBlocks(dsp);
+        for (int i = 0; i < 4; i++) best = min(best, computeBlocks(dsp));
+        return (double(fBlocks) * fBufferSize) / max(best, 1e-9);
+    }
+
+    // Compile and measure one set of options, returns the throughput (0 on error)
+    double run(const vector<string>& options)
+    {
+        string            error_msg;
+        llvm_dsp_factory* factory = createDSPFactoryWithOptions(fNameApp, fDSPContent, fArgc, fArgv, options, fTarget,
+                                                                error_msg, fOptLevel, false);
+        if (!factory) return 0.;
+        dsp*   dsp = factory->createDSPInstance();
+        double res = (dsp) ? measure(dsp) : 0.;
+        delete dsp;
+        if (res > fBest) {
+            if (fBestFactory) deleteDSPFactory(fBestFactory);
+            fBestFactory = factory;
+            fBest        = res;
+            fBestOptions = options;
+        } else {
+            deleteDSPFactory(factory);
+        }
+        return res;
+    }
+
+    // Add 'param' with each value to 'options', until two values in a row do not improve the result
+    void explore(const vector<string>& options, const string& param, const vector<int>& values)
+    {
+        double best = 0.;
+        int    fail = 0;
+        for (size_t i = 0; i < values.size() && fail < 2 && !timeOut(); i++) {
+            vector<string> options1 = options;
+            options1.push_back(param);
+            options1.push_back(to_string(values[i]));
+            double res = run(options1);
+            if (res > best) {
+                best = res;
+                fail = 0;
+            } else {
+                fail++;
+            }
+        }
+    }
+
+   public:
+    dsp_tuner(const string& name_app, const string& dsp_content, int argc, const char* argv[], const string& target,
+              int opt_level, int buffer_size, double time_budget)
+        : fNameApp(name_app),
+          fDSPContent(dsp_content),
+          fArgc(argc),
+          fArgv(argv),
+          fTarget(target),
+          fOptLevel(opt_level),
+          fBufferSize(buffer_size),
+          fDouble(hasParam(argc, argv, "-double")),
+          fBlocks(0),
+          fBestFactory(nullptr),
+          fBest(0.)
+    {
+        fDeadline = chrono::steady_clock::now() + chrono::microseconds(int64_t(time_budget * 1e6));
+    }
+
+    virtual ~dsp_tuner()
+    {
+        if (fBestFactory) deleteDSPFactory(fBestFactory);
+    }
+
+    // Returns the best factory (to be deleted with deleteDSPFactory) and its options
+    llvm_dsp_factory* tune(vector<string>& best_options, string& error_msg)
+    {
+        // The default (scalar) options : an error here is a DSP compilation error
+        llvm_dsp_factory* factory = createDSPFactoryWithOptions(fNameApp, fDSPContent, fArgc, fArgv, {}, fTarget,
+                                                                error_msg, fOptLevel, false);
+        if (!factory) return nullptr;
+        dsp* dsp = factory->createDSPInstance();
+        if (dsp) {
+            fBest = measure(dsp);
+            delete dsp;
+        }
+        fBestFactory = factory;
+
+        vector<int> sizes;
+        for (int size = 4; size <= fBufferSize; size *= 2) sizes.push_back(size);
+        const vector<vector<string>> families = {
+            {"-vec", "-lv", "0"},         {"-vec", "-lv", "0", "-fun"}, {"-vec", "-lv", "0", "-g"},
+            {"-vec", "-lv", "0", "-dfs"}, {"-vec", "-lv", "1"},         {"-vec", "-lv", "1", "-g"},
+            {"-vec", "-lv", "1", "-dfs"}};
+        for (const auto& it : families) {
+            explore(it, "-vs", sizes);
+        }
+
+        vector<int> delays;
+        for (int size = 2; size <= 256; size *= 2) delays.push_back(size);
+        explore(vector<string>(fBestOptions), "-mcd", delays);
+
+        best_options = fBestOptions;
+        factory      = fBestFactory;
+        fBestFactory = nullptr;
+        return factory;
+    }
+};
+
+EXPORT llvm_dsp_factory* createDSPFactoryFromString(const string& name_app, const string& dsp_content, int argc,
+                                                    const char* argv[], const string& target, string& error_msg,
+                                                    int opt_level)
+{
+    // A factory already compiled with the same options is directly returned
+    string sha_key;
+    sha1FromDSP(name_app, dsp_content, argc, argv, sha_key);
+    {
+        LOCK_API
+        dsp_factory_table<SDsp_factory>::factory_iterator it;
         if (llvm_dsp_factory_aux::gLLVMFactoryTable.getFactory(sha_key, it)) {
             SDsp_factory sfactory = (*it).first;
             sfactory->addReference();
             return sfactory;
-        } else {
-            int         argc1 = 0;
-            const char* argv1[64];
-            argv1[argc1++] = "faust";
-            argv1[argc1++] = "-lang";
-            // argv1[argc1++] = "cllvm";
-            argv1[argc1++] = "llvm";
-            argv1[argc1++] = "-o";
-            argv1[argc1++] = "string";
-            // Copy arguments
-            for (int i = 0; i < argc; i++) {
-                argv1[argc1++] = argv[i];
-            }
-            argv1[argc1] = nullptr;  // NULL terminated argv
-            
-            llvm_dynamic_dsp_factory_aux* factory_aux = nullptr;
-            try {
-                factory_aux = static_cast<llvm_dynamic_dsp_factory_aux*>(
-                                                                         compileFaustFactory(argc1, argv1, name_app.c_str(), dsp_content.c_str(), error_msg, true));
-                if (factory_aux) {
-                    factory_aux->setTarget(target);
-                    factory_aux->setOptlevel(opt_level);
-                    factory_aux->setClassName(getParam(argc, argv, "-cn", "mydsp"));
-                    factory_aux->setName(name_app);
-                    if (!factory_aux->initJIT(error_msg)) {
-                        goto error;
-                    }
-                    factory = new llvm_dsp_factory(factory_aux);
-                    llvm_dsp_factory_aux::gLLVMFactoryTable.setFactory(factory);
-                    factory->setSHAKey(sha_key);
-                    factory->setDSPCode(expanded_dsp_content);
-                    return factory;
-                }
-            } catch (faustexception& e) {
-                error_msg = e.what();
-                goto error;
-            }
-        error:
-            delete factory_aux;
-            return nullptr;
         }
     }
+
+    // Otherwise use the options found by a previous tuning of the same DSP
+    vector<string> options;
+    if (!hasTunedParam(argc, argv) && getTunedOptions(name_app, dsp_content, argc, argv, target, opt_level, options)) {
+        return createDSPFactoryWithOptions(name_app, dsp_content, argc, argv, options, target, error_msg, opt_level,
+                                           true);
+    } else {
+        return createDSPFactoryFromStringAux(name_app, dsp_content, argc, argv, target, error_msg, opt_level, true);
+    }
+}
+
+EXPORT llvm_dsp_factory* createOptimizedDSPFactoryFromFile(const string& filename, int argc, const char* argv[],
+                                                           const string& target, string& error_msg,
+                                                           double time_budget, int buffer_size, int opt_level)
+{
+    string base = basename((char*)filename.c_str());
+    size_t pos  = filename.find(".dsp");
+
+    if (pos != string::npos) {
+        return createOptimizedDSPFactoryFromString(base.substr(0, pos), pathToContent(filename), argc, argv, target,
+                                                   error_msg, time_budget, buffer_size, opt_level);
+    } else {
+        error_msg = "ERROR : file extension is not the one expected (.dsp expected)\n";
+        return nullptr;
+    }
+}
+
+EXPORT llvm_dsp_factory* createOptimizedDSPFactoryFromString(const string& name_app, const string& dsp_content,
+                                                             int argc, const char* argv[], const string& target,
+                                                             string& error_msg, double time_budget, int buffer_size,
+                                                             int opt_level)
+{
+    // Already tuned, or options explicitly chosen by the caller
+    vector<string> options;
+    if (hasTunedParam(argc, argv) || getTunedOptions(name_app, dsp_content, argc, argv, target, opt_level, options)) {
+        return createDSPFactoryFromString(name_app, dsp_content, argc, argv, target, error_msg, opt_level);
+    }
+
+    dsp_tuner         tuner(name_app, dsp_content, argc, argv, target, opt_level, buffer_size, time_budget);
+    llvm_dsp_factory* factory = tuner.tune(options, error_msg);
+    if (!factory) return nullptr;
+    setTunedOptions(name_app, dsp_content, argc, argv, target, opt_level, options, getLibraryList(factory));
+
+    // The winning machine code also goes in the persistent cache
+    vector<const char*> argv1(argv, argv + argc);
+    for (const auto& it : options) argv1.push_back(it.c_str());
+    string cache_path = getMachineCachePath(name_app, dsp_content, int(argv1.size()), argv1.data(), target, opt_level);
+    if (cache_path != "") {
+        writeFactoryCacheFile(cache_path, writeDSPFactoryToMachine(factory, ""), getLibraryList(factory));
+    }
+    return factory;
 }
 
 EXPORT llvm_dsp_factory* readDSPFactoryFromBitcode(const string& bit_code, const string& target, string& error_msg,
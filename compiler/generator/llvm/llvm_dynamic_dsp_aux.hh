@@ -66,6 +66,17 @@ EXPORT llvm_dsp_factory* createDSPFactoryFromString(const std::string& name_app,
                                                     int argc, const char* argv[], const std::string& target,
                                                     std::string& error_msg, int opt_level = -1);
 
+EXPORT llvm_dsp_factory* createOptimizedDSPFactoryFromFile(const std::string& filename, int argc, const char* argv[],
+                                                           const std::string& target, std::string& error_msg,
+                                                           double time_budget = 10., int buffer_size = 512,
+                                                           int opt_level = -1);
+
+EXPORT llvm_dsp_factory* createOptimizedDSPFactoryFromString(const std::string& name_app,
+                                                             const std::string& dsp_content, int argc,
+                                                             const char* argv[], const std::string& target,
+                                                             std::string& error_msg, double time_budget = 10.,
+                                                             int buffer_size = 512, int opt_level = -1);
+
 // Bitcode <==> string
 EXPORT llvm_dsp_factory* readDSPFactoryFromBitcode(const std::string& bit_code, const std::string& target,
                                                    std::string& error_msg, int opt_level = 0);
@@ -32,6 +32,7 @@
 
 #include "Text.hh"
 #include "binop.hh"
+#include "dsp_profile.hh"
 #include "exception.hh"
 #include "fir_to_fir.hh"
 #include "global.hh"
@@ -42,6 +43,7 @@
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/raw_ostream.h>
@@ -224,7 +226,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
     map<string, LLVMValue>       fStackVars;    // Variables on the stack
     map<string, GlobalVariable*> fStringTable;  // Global strings
 
-    static list<string> gMathLibTable;
+    static thread_local list<string> gMathLibTable;
     
     void printVarTable()
     {
@@ -817,10 +819,19 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
     }
     */
     
-    // Actually faster...
+    /*
+     Actually faster... except when the runtime profile (-pgo) shows that the condition has no dominant value:
+     the branch would then be often mispredicted, so a select on simple values (that can be computed
+     without any side effect) is compiled without branch. Otherwise the profile gives the branch weights.
+    */
     virtual void visit(Select2Inst* inst)
     {
-        visitIf(inst);
+        double ratio = (gGlobal->gProfile) ? gGlobal->gProfile->getSelectRatio(inst->fProfileKey) : -1.;
+        if (ratio > 0.1 && ratio < 0.9 && inst->fThen->isSimpleValue() && inst->fElse->isSimpleValue()) {
+            visitSelect(inst);
+        } else {
+            visitIf(inst, ratio);
+        }
     }
  
     // Select that computes both branches
@@ -856,7 +867,7 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
      LLVM passes will later one create a unique PHI node that groups all results,
      especially when hierarchical 'select' are compiled.
     */
-    virtual void visitIf(Select2Inst* inst)
+    virtual void visitIf(Select2Inst* inst, double ratio = -1.)
     {
         // Compile condition, result in fCurValue
         inst->fCond->accept(this);
@@ -872,7 +883,15 @@ class LLVMInstVisitor : public InstVisitor, public LLVMTypeHelper {
         BasicBlock* else_block  = genBlock("select_else_block");
         BasicBlock* merge_block = genBlock("select_merge_block");
         
-        fBuilder->CreateCondBr(cond_value, then_block, else_block);
+        if (ratio >= 0.) {
+            // Probability of the 'then' branch in the runtime profile
+            MDBuilder md_builder(fBuilder->getContext());
+            fBuilder->CreateCondBr(cond_value, then_block, else_block,
+                                   md_builder.createBranchWeights(1 + uint32_t(ratio * 1e6),
+                                                                  1 + uint32_t((1. - ratio) * 1e6)));
+        } else {
+            fBuilder->CreateCondBr(cond_value, then_block, else_block);
+        }
         
         // Emit then block
         fBuilder->SetInsertPoint(then_block);
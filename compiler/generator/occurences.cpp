@@ -173,9 +173,9 @@ void OccMarkup::incOcc(Tree env, int v, int r, int d, Tree t)
 
 Occurences* OccMarkup::getOcc(Tree t)
 {
-    Tree p = t->getProperty(fPropKey);
+    PropertyValue* p = t->getValueProperty(fPropKey);
     if (p) {
-        return (Occurences*)tree2ptr(p);
+        return static_cast<Occurences*>(p->fPointer);
     } else {
         return 0;
     }
@@ -183,7 +183,9 @@ Occurences* OccMarkup::getOcc(Tree t)
 
 void OccMarkup::setOcc(Tree t, Occurences* occ)
 {
-    t->setProperty(fPropKey, tree(occ));
+    PropertyValue p;
+    p.fPointer = occ;
+    t->setValueProperty(fPropKey, p);
 }
 
 #if 0
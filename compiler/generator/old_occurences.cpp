@@ -182,9 +182,9 @@ void old_OccMarkup::incOcc(Tree env, int v, int r, int d, Tree xc, Tree t)
 
 old_Occurences* old_OccMarkup::getOcc(Tree t)
 {
-    Tree p = t->getProperty(fPropKey);
+    PropertyValue* p = t->getValueProperty(fPropKey);
     if (p) {
-        return (old_Occurences*)tree2ptr(p);
+        return static_cast<old_Occurences*>(p->fPointer);
     } else {
         return 0;
     }
@@ -192,7 +192,9 @@ old_Occurences* old_OccMarkup::getOcc(Tree t)
 
 void old_OccMarkup::setOcc(Tree t, old_Occurences* occ)
 {
-    t->setProperty(fPropKey, tree(occ));
+    PropertyValue p;
+    p.fPointer = occ;
+    t->setValueProperty(fPropKey, p);
 }
 
 #if 0
@@ -22,6 +22,7 @@
 #include "omp_code_container.hh"
 #include "fir_to_fir.hh"
 #include "global.hh"
+#include "timing.hh"
 
 using namespace std;
 
@@ -117,8 +118,8 @@ StatementInst* OpenMPCodeContainer::generateDAGLoopOMP(const string& counter)
     // Generates the loop DAG
     lclgraph dag;
     CodeLoop::sortGraph(fCurLoop, dag);
-    int  loop_num  = 0;
-    bool is_single = false;  // Generates "#pragma omp single" once when we stay if a sequence of "single" loops
+    int        loop_num     = 0;
+    BlockInst* single_block = nullptr;  // Consecutive "single" loops share the same "#pragma omp single" block
 
     for (int l = int(dag.size()) - 1; l >= 0; l--) {
         BlockInst* omp_sections_block = InstBuilder::genBlockInst();
@@ -129,20 +130,21 @@ StatementInst* OpenMPCodeContainer::generateDAGLoopOMP(const string& counter)
         for (auto& p : dag[l]) {
             BlockInst* omp_section_block = InstBuilder::genBlockInst();
             if (dag[l].size() == 1) {  // Only one loop
-                if (!p->isRecursive() && gGlobal->gOpenMPLoop) {
+                if (!p->hasRecursiveLoop() && gGlobal->gOpenMPLoop) {
+                    single_block = nullptr;
                     generateDAGLoopAux(p, omp_section_block, count_dec, loop_num++, true);
                 } else {
-                    omp_section_block->setIndent(true);
-                    if (!is_single) {
+                    if (!single_block) {
+                        single_block = InstBuilder::genBlockInst();
+                        single_block->setIndent(true);
                         omp_sections_block->pushBackInst(InstBuilder::genLabelInst("#pragma omp single"));
-                        is_single = true;
-                    } else {
-                        omp_sections_block->pushBackInst(InstBuilder::genLabelInst("/* Still in a single section */"));
+                        omp_sections_block->pushBackInst(single_block);
                     }
-                    generateDAGLoopAux(p, omp_section_block, count_dec, loop_num++);
+                    generateDAGLoopAux(p, single_block, count_dec, loop_num++);
+                    continue;
                 }
             } else {
-                is_single = false;
+                single_block = nullptr;
                 omp_section_block->setIndent(true);
                 omp_sections_block->pushBackInst(InstBuilder::genLabelInst("#pragma omp section"));
                 generateDAGLoopAux(p, omp_section_block, count_dec, loop_num++);
@@ -174,5 +176,7 @@ void OpenMPCodeContainer::processFIR()
     // fComputeBlockInstructions->fCode.sort(sortArrayDeclarations);
 
     // Prepare global loop
+    startTiming("generateDAGLoop");
     fGlobalLoopBlock = generateDAGLoopOMP(fFullCount);
+    endTiming("generateDAGLoop");
 }
@@ -69,7 +69,7 @@ class RustInstVisitor : public TextInstVisitor {
      Global functions names table as a static variable in the visitor
      so that each function prototype is generated as most once in the module.
      */
-    static map<string, bool> gFunctionSymbolTable;
+    static thread_local map<string, bool> gFunctionSymbolTable;
     map<string, string>      fMathLibTable;
 
    public:
@@ -59,10 +59,10 @@ Compile a list of FAUST signals into a C++ class.
 int ScalarCompiler::getSharingCount(Tree sig)
 {
     // cerr << "getSharingCount of : " << *sig << " = ";
-    Tree c;
-    if (getProperty(sig, fSharingKey, c)) {
-        // cerr << c->node().getInt() << endl;
-        return c->node().getInt();
+    PropertyValue* c = sig->getValueProperty(fSharingKey);
+    if (c) {
+        // cerr << c->fInt << endl;
+        return c->fInt;
     } else {
         // cerr << 0 << endl;
         return 0;
@@ -72,7 +72,9 @@ int ScalarCompiler::getSharingCount(Tree sig)
 void ScalarCompiler::setSharingCount(Tree sig, int count)
 {
     // cerr << "setSharingCount of : " << *sig << " <- " << count << endl;
-    setProperty(sig, fSharingKey, tree(count));
+    PropertyValue c;
+    c.fInt = count;
+    sig->setValueProperty(fSharingKey, c);
 }
 
 //------------------------------------------------------------------------------
@@ -29,6 +29,7 @@
 #include <map>
 
 #include "Text.hh"
+#include "dsp_profile.hh"
 #include "fir_to_fir.hh"
 #include "instructions.hh"
 #include "type_manager.hh"
@@ -281,6 +282,26 @@ class TextInstVisitor : public InstVisitor {
         *fOut << ")";
     }
 
+    /*
+     Select2 for the C and C++ backends: when the runtime profile (-pgo) shows that the condition has a dominant value,
+     it is given to the compiler with the FAUST_EXPECT macro (see CodeContainer::printExpectMacro).
+    */
+    void visitExpect(Select2Inst* inst)
+    {
+        double ratio = (gGlobal->gProfile) ? gGlobal->gProfile->getSelectRatio(inst->fProfileKey) : -1.;
+        if (ratio >= 0.9 || (ratio >= 0. && ratio <= 0.1)) {
+            *fOut << "(FAUST_EXPECT(";
+            inst->fCond->accept(this);
+            *fOut << ", " << ((ratio >= 0.9) ? 1 : 0) << ") ? ";
+            inst->fThen->accept(this);
+            *fOut << " : ";
+            inst->fElse->accept(this);
+            *fOut << ")";
+        } else {
+            TextInstVisitor::visit(inst);
+        }
+    }
+
     virtual void visit(IfInst* inst)
     {
         *fOut << "if ";
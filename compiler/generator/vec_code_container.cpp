@@ -24,6 +24,7 @@
 #include "fir_code_checker.hh"
 #include "fir_to_fir.hh"
 #include "global.hh"
+#include "timing.hh"
 
 using namespace std;
 
@@ -209,12 +210,15 @@ void VectorCodeContainer::processFIR(void)
 
     if (counter.fSizeBytes > gGlobal->gMachineMaxStackSize) {
         // Transform stack array variables in struct variables
+        startTiming("moveStack2Struct");
         moveStack2Struct();
+        endTiming("moveStack2Struct");
     } else {
         // Sort arrays to be at the begining
         // fComputeBlockInstructions->fCode.sort(sortArrayDeclarations);
     }
 
+    startTiming("generateDAGLoop");
     if (gGlobal->gVectorLoopVariant == 0) {
         fDAGBlock = generateDAGLoopVariant0(fFullCount);
     } else if (gGlobal->gVectorLoopVariant == 1) {
@@ -222,6 +226,7 @@ void VectorCodeContainer::processFIR(void)
     } else {
         faustassert(false);
     }
+    endTiming("generateDAGLoop");
 
     // Possibly remove LoadVarAddress
     if (gGlobal->gRemoveVarAddress) {
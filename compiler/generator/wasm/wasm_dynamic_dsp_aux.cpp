@@ -112,8 +112,8 @@ EXPORT wasm_dsp_factory* createWasmDSPFactoryFromString(const string& name_app,
         if (dsp_factory_aux) {
             dsp_factory_aux->setName(name_app);
             wasm_dsp_factory* factory = new wasm_dsp_factory(dsp_factory_aux);
-            wasm_dsp_factory::gWasmFactoryTable.setFactory(factory);
             factory->setSHAKey(sha_key);
+            wasm_dsp_factory::gWasmFactoryTable.setFactory(factory);
             factory->setDSPCode(expanded_dsp_content);
             return factory;
         } else {
@@ -22,6 +22,7 @@
 #include "wss_code_container.hh"
 #include "fir_to_fir.hh"
 #include "global.hh"
+#include "timing.hh"
 
 using namespace std;
 
@@ -454,8 +455,11 @@ void WSSCodeContainer::processFIR(void)
     CodeContainer::processFIR();
 
     // Transform some stack variables in struct variables, move some variables from "compute" to "computeThread"
+    startTiming("moveCompute2ComputeThread");
     moveCompute2ComputeThread();
+    endTiming("moveCompute2ComputeThread");
 
+    startTiming("generateDAGLoop");
     lclgraph    dag;
     vector<int> ready_loop;
     int         loop_count;
@@ -469,6 +473,7 @@ void WSSCodeContainer::processFIR(void)
     fThreadLoopBlock = generateDAGLoopWSS(dag);
 
     generateDAGLoopWSSAux2(dag, fFullCount);
+    endTiming("generateDAGLoop");
 
     if (gGlobal->gRemoveVarAddress) {
         VarAddressRemover remover;
@@ -30,6 +30,7 @@
 #include "binop.hh"
 #include "ceilprim.hh"
 #include "cosprim.hh"
+#include "dsp_profile.hh"
 #include "exp10prim.hh"
 #include "expprim.hh"
 #include "floorprim.hh"
@@ -79,12 +80,12 @@
 #endif
 
 // Parser
-extern FILE*       yyin;
-extern const char* yyfilename;
+extern thread_local const char* yyfilename;
 
 // CG globals
-list<Garbageable*> global::gObjectTable;
-bool               global::gHeapCleanup = false;
+thread_local vector<Garbageable*> global::gObjectTable;
+thread_local GarbageableArena     global::gObjectArena;
+thread_local bool                 global::gHeapCleanup = false;
 
 /*
 faust1 uses a loop size of 512, but 512 makes faust2 crash (stack allocation error).
@@ -116,11 +117,14 @@ global::global() : TABBER(1), gLoopDetector(1024, 400), gStackOverflowDetector(M
     gSimplifyDiagrams = false;
     gLessTempSwitch   = false;
     gMaxCopyDelay     = 16;
+    gProfile          = nullptr;
 
     gVectorSwitch      = false;
     gDeepFirstSwitch   = false;
     gVecSize           = 32;
     gVectorLoopVariant = 0;
+    gLookAheadStep     = 0;
+    gControlRate       = 0;
 
     gOpenMPSwitch    = false;
     gOpenMPLoop      = false;
@@ -129,6 +133,7 @@ global::global() : TABBER(1), gLoopDetector(1024, 400), gStackOverflowDetector(M
     gCUDASwitch      = false;
     gGroupTaskSwitch = false;
     gFunTaskSwitch   = false;
+    gTaskGranularity = 2048;
 
     gUIMacroSwitch = false;
     gDumpNorm      = false;
@@ -169,6 +174,7 @@ global::global() : TABBER(1), gLoopDetector(1024, 400), gStackOverflowDetector(M
     gOneSampleControl     = false;
     gFastMathLib          = "default";
     gNameSpace            = "";
+    gMultiVersion         = false;
 
     // Fastmath mapping float version
     gFastMathLibTable["fabsf"]      = "fast_fabsf";
@@ -434,12 +440,8 @@ global::global() : TABBER(1), gLoopDetector(1024, 400), gStackOverflowDetector(M
 
     gTimeout = 120;  // Time out to abort compiler (in seconds)
 
-    // Globals to transfer results in thread based evaluation
-    gProcessTree  = 0;
-    gLsignalsTree = 0;
-    gNumInputs    = 0;
-    gNumOutputs   = 0;
-    gErrorMessage = "";
+    gNumInputs  = 0;
+    gNumOutputs = 0;
 
     // By default use "cpp" output
     gOutputLang = (getenv("FAUST_DEFAULT_BACKEND")) ? string(getenv("FAUST_DEFAULT_BACKEND")) : "cpp";
@@ -511,19 +513,25 @@ void global::init()
 
     // yyfilename is defined in errormsg.cpp but must be redefined at each compilation.
     yyfilename = "";
-    yyin       = 0;
 
     gLatexheaderfilename = "latexheader.tex";
     gDocTextsDefaultFile = "mathdoctexts-default.txt";
 
+    // Setup standard "C" local, only in the compilation thread since several compilations may run concurrently
+    // (workaround for a bug in bitcode generation : http://lists.cs.uiuc.edu/pipermail/llvmbugs/2012-May/023530.html)
+#if defined(_WIN32) || defined(EMCC)
+#ifdef _WIN32
+    gCurrentLocalMode = _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+#endif
     gCurrentLocal = setlocale(LC_ALL, NULL);
     if (gCurrentLocal != NULL) {
         gCurrentLocal = strdup(gCurrentLocal);
     }
-
-    // Setup standard "C" local
-    // (workaround for a bug in bitcode generation : http://lists.cs.uiuc.edu/pipermail/llvmbugs/2012-May/023530.html)
     setlocale(LC_ALL, "C");
+#else
+    gCLocale      = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    gCurrentLocal = uselocale(gCLocale);
+#endif
 
     // Source file injection
     gInjectFlag = false;  // inject an external source file into the architecture file
@@ -582,10 +590,14 @@ void global::printCompilationOptions(ostream& dst, bool backend)
     }
     if (gInPlace) dst << "-inpl ";
     if (gOneSample) dst << "-os ";
+    if (gMultiVersion) dst << "-mv ";
+    if (gLookAheadStep > 1) dst << "-la " << gLookAheadStep << " ";
+    if (gControlRate > 1) dst << "-cr " << gControlRate << " ";
     if (gLightMode) dst << "-light ";
     if (gSchedulerSwitch) {
         dst << "-sch"
             << " -vs " << gVecSize << ((gFunTaskSwitch) ? " -fun" : "") << ((gGroupTaskSwitch) ? " -g" : "")
+            << " -tgs " << gTaskGranularity
             << ((gDeepFirstSwitch) ? " -dfs" : "")
             << ((gFloatSize == 2) ? " -double" : (gFloatSize == 3) ? " -quad" : "") << " -ftz " << gFTZMode << " -mcd "
             << gGlobal->gMaxCopyDelay << ((gMemoryManager) ? " -mem" : "");
@@ -598,7 +610,7 @@ void global::printCompilationOptions(ostream& dst, bool backend)
     } else if (gOpenMPSwitch) {
         dst << "-omp"
             << " -vs " << gVecSize << " -vs " << gVecSize << ((gFunTaskSwitch) ? " -fun" : "")
-            << ((gGroupTaskSwitch) ? " -g" : "") << ((gDeepFirstSwitch) ? " -dfs" : "")
+            << ((gGroupTaskSwitch) ? " -g" : "") << " -tgs " << gTaskGranularity << ((gDeepFirstSwitch) ? " -dfs" : "")
             << ((gFloatSize == 2) ? " -double" : (gFloatSize == 3) ? " -quad" : "") << " -ftz " << gFTZMode << " -mcd "
             << gGlobal->gMaxCopyDelay << ((gMemoryManager) ? " -mem" : "");
     } else {
@@ -657,11 +669,21 @@ int global::audioSampleSize()
 
 global::~global()
 {
+    delete gProfile;
     Garbageable::cleanup();
     BasicTyped::cleanup();
     DeclareVarInst::cleanup();
+    CTree::cleanup();
+#if defined(_WIN32) || defined(EMCC)
     setlocale(LC_ALL, gCurrentLocal);
     free(gCurrentLocal);
+#ifdef _WIN32
+    _configthreadlocale(gCurrentLocalMode);
+#endif
+#else
+    uselocale(gCurrentLocal);
+    freelocale(gCLocale);
+#endif
 
     // Cleanup
 #ifdef C_BUILD
@@ -743,57 +765,153 @@ Garbageable::~Garbageable()
 
 void Garbageable::cleanup()
 {
-    std::list<Garbageable*>::iterator it;
-
-    // Here removing the deleted pointer from the list is pointless
-    // and takes time, thus we don't do it.
     global::gHeapCleanup = true;
-    for (it = global::gObjectTable.begin(); it != global::gObjectTable.end(); it++) {
+
+    // Objects are deleted in reverse allocation order. A deleted object has its
+    // entry reset in the table, so that objects deleted by the destructor of another one are skipped.
+    for (size_t i = global::gObjectTable.size(); i-- > 0;) {
+        Garbageable* obj = global::gObjectTable[i];
+        if (obj) {
 #ifdef _WIN32
-        // Hack : "this" and actual pointer are not the same: destructor cannot be called...
-        Garbageable::operator delete(*it);
+            // Hack : "this" and actual pointer are not the same: destructor cannot be called...
+            Garbageable::operator delete(obj);
 #else
-        delete (*it);
+            delete obj;
 #endif
+        }
     }
 
     // Reset to default state
     global::gObjectTable.clear();
+    global::gObjectArena.release();
     global::gHeapCleanup = false;
 }
 
-void* Garbageable::operator new(size_t size)
+void Garbageable::printStats(ostream& fout, bool json)
+{
+    global::gObjectArena.printStats(fout, json);
+}
+
+// Header placed before each Garbageable object
+struct alignas(16) GarbageableHeader {
+    size_t fIndex;  // index of the object in global::gObjectTable
+    size_t fSize;   // size of the block, header included
+};
+
+static void* allocateGarbageable(size_t size)
 {
     // HACK : add 16 bytes to avoid unsolved memory smashing bug...
-    Garbageable* res = (Garbageable*)malloc(size + 16);
-    global::gObjectTable.push_front(res);
+    size_t             real   = (sizeof(GarbageableHeader) + size + 16 + 15) & ~size_t(15);
+    GarbageableHeader* header = static_cast<GarbageableHeader*>(global::gObjectArena.allocate(real));
+    header->fIndex            = global::gObjectTable.size();
+    header->fSize             = real;
+    Garbageable* res          = reinterpret_cast<Garbageable*>(header + 1);
+    global::gObjectTable.push_back(res);
     return res;
 }
 
-void Garbageable::operator delete(void* ptr)
+static void deallocateGarbageable(void* ptr)
 {
+    if (!ptr) return;
+    GarbageableHeader* header = static_cast<GarbageableHeader*>(ptr) - 1;
     // We may have cases when a pointer will be deleted during
-    // a compilation, thus the pointer has to be removed from the list.
-    if (!global::gHeapCleanup) {
-        global::gObjectTable.remove(static_cast<Garbageable*>(ptr));
+    // a compilation, thus the pointer has to be removed from the table.
+    global::gObjectTable[header->fIndex] = nullptr;
+    // During cleanup, all pages are released at once afterwards
+    if (!global::gHeapCleanup || header->fSize > GarbageableArena::kMaxObjectSize) {
+        global::gObjectArena.deallocate(header, header->fSize);
     }
-    free(ptr);
+}
+
+void* Garbageable::operator new(size_t size)
+{
+    return allocateGarbageable(size);
+}
+
+void Garbageable::operator delete(void* ptr)
+{
+    deallocateGarbageable(ptr);
 }
 
 void* Garbageable::operator new[](size_t size)
 {
-    // HACK : add 16 bytes to avoid unsolved memory smashing bug...
-    Garbageable* res = (Garbageable*)malloc(size + 16);
-    global::gObjectTable.push_front(res);
-    return res;
+    return allocateGarbageable(size);
 }
 
 void Garbageable::operator delete[](void* ptr)
 {
-    // We may have cases when a pointer will be deleted during
-    // a compilation, thus the pointer has to be removed from the list.
-    if (!global::gHeapCleanup) {
-        global::gObjectTable.remove(static_cast<Garbageable*>(ptr));
+    deallocateGarbageable(ptr);
+}
+
+void* GarbageableArena::allocate(size_t size)
+{
+    fObjects++;
+    fBytes += size;
+
+    if (size > kMaxObjectSize) {
+        fBigObjects++;
+        fBigBytes += size;
+        void* res = malloc(size);
+        if (!res) throw std::bad_alloc();
+        return res;
+    }
+
+    void*& free_block = fFreeBlocks[size / 16];
+    if (free_block) {
+        fReused++;
+        void* res  = free_block;
+        free_block = *static_cast<void**>(res);
+        return res;
+    }
+
+    if (size > fRemaining) {
+        fCurrent = static_cast<char*>(malloc(kPageSize));
+        if (!fCurrent) throw std::bad_alloc();
+        fPages.push_back(fCurrent);
+        fRemaining = kPageSize;
+    }
+    void* res = fCurrent;
+    fCurrent += size;
+    fRemaining -= size;
+    return res;
+}
+
+void GarbageableArena::deallocate(void* ptr, size_t size)
+{
+    if (size > kMaxObjectSize) {
+        free(ptr);
+    } else {
+        // The block is chained in the free list of its size, to be reused by a later allocation
+        *static_cast<void**>(ptr) = fFreeBlocks[size / 16];
+        fFreeBlocks[size / 16]    = ptr;
+    }
+}
+
+void GarbageableArena::release()
+{
+    for (size_t i = 0; i < fPages.size(); i++) {
+        free(fPages[i]);
+    }
+    fPages.clear();
+    for (size_t i = 0; i <= kMaxObjectSize / 16; i++) fFreeBlocks[i] = nullptr;
+    fCurrent    = nullptr;
+    fRemaining  = 0;
+    fObjects    = 0;
+    fBytes      = 0;
+    fReused     = 0;
+    fBigObjects = 0;
+    fBigBytes   = 0;
+}
+
+void GarbageableArena::printStats(ostream& fout, bool json)
+{
+    if (json) {
+        fout << "{ \"objects\": " << fObjects << ", \"reused\": " << fReused << ", \"bytes\": " << fBytes
+             << ", \"pages\": " << fPages.size() << ", \"page_size\": " << kPageSize << ", \"big_objects\": "
+             << fBigObjects << ", \"big_bytes\": " << fBigBytes << " }";
+        return;
     }
-    free(ptr);
+    fout << "Garbageable arena : " << fObjects << " objects (" << fReused << " in reused blocks), " << fBytes
+         << " bytes, " << fPages.size() << " pages of " << kPageSize << " bytes, " << fBigObjects << " big objects ("
+         << fBigBytes << " bytes)" << endl;
 }
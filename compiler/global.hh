@@ -22,6 +22,7 @@
 #ifndef __FAUST_GLOBAL__
 #define __FAUST_GLOBAL__
 
+#include <locale.h>
 #include <stdio.h>
 #include <string.h>
 #include <list>
@@ -33,6 +34,9 @@
 #ifndef _WIN32
 #include <unistd.h>
 #endif
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
 
 #include "exception.hh"
 #include "instructions_type.hh"
@@ -63,6 +67,7 @@ struct Typed;
 struct BasicTyped;
 
 class dsp_factory_base;
+struct DSPProfile;
 
 typedef long double quad;
 
@@ -118,10 +123,14 @@ struct global {
     int    gMaxCopyDelay;
     string gOutputFile;
 
+    DSPProfile* gProfile;  // Runtime profile given with -pgo, or nullptr
+
     bool gVectorSwitch;
     bool gDeepFirstSwitch;
     int  gVecSize;
     int  gVectorLoopVariant;
+    int  gLookAheadStep;  // Look-ahead step of the linear recursive filters (0 : no look-ahead)
+    int  gControlRate;    // Decimation factor of the smoothed controls (0 : computed at sample rate)
 
     bool gOpenMPSwitch;
     bool gOpenMPLoop;
@@ -130,6 +139,7 @@ struct global {
     bool gCUDASwitch;
     bool gGroupTaskSwitch;
     bool gFunTaskSwitch;
+    int  gTaskGranularity;  // Minimal estimated cost of a task in -sch and -omp modes (0 to deactivate)
 
     bool gUIMacroSwitch;
     bool gDumpNorm;
@@ -168,6 +178,7 @@ struct global {
     bool   gOneSampleControl;      // Generate one sample computation control structure in DSP module
     string gFastMathLib;           // The fastmath code mapping file
     string gNameSpace;             // Wrapping namespace used with the C++ backend
+    bool   gMultiVersion;          // Generate several 'compute' versions (AVX512/AVX2/default) chosen at init time
 
     map<string, string> gFastMathLibTable;      // Mapping table for fastmath functions
     map<string, bool>   gMathForeignFunctions;  // Map of math foreign functions
@@ -476,7 +487,14 @@ struct global {
     // to keep track of already injected files
     set<string> gAlreadyIncluded;
 
+    // Locale of the compilation thread, restored at the end of the compilation
+#if defined(_WIN32) || defined(EMCC)
     char* gCurrentLocal;
+    int   gCurrentLocalMode;
+#else
+    locale_t gCLocale;
+    locale_t gCurrentLocal;
+#endif
 
     int gAllocationCount;  // Internal signal types counter
 
@@ -521,16 +539,14 @@ struct global {
 
     int gTimeout;  // Time out to abort compiler (in seconds)
 
-    // Globals to transfer results in thread based evaluation
-    Tree   gProcessTree;
-    Tree   gLsignalsTree;
-    int    gNumInputs;
-    int    gNumOutputs;
-    string gErrorMessage;
+    // Number of inputs and outputs of 'process'
+    int gNumInputs;
+    int gNumOutputs;
 
-    // GC
-    static list<Garbageable*> gObjectTable;
-    static bool               gHeapCleanup;
+    // GC (per thread, like the rest of the compiler state)
+    static thread_local vector<Garbageable*> gObjectTable;
+    static thread_local GarbageableArena     gObjectArena;
+    static thread_local bool                 gHeapCleanup;
 
     global();
     ~global();
@@ -570,8 +586,8 @@ struct global {
     int audioSampleSize();
 };
 
-// Unique shared global pointer
-extern global* gGlobal;
+// Global pointer of the compilation running in the current thread
+extern thread_local global* gGlobal;
 
 #define FAUST_LIB_PATH "FAUST_LIB_PATH"
 #define MAX_MACHINE_STACK_SIZE 65536
@@ -27,7 +27,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <cstdlib>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <sstream>
@@ -40,6 +42,7 @@
 #include "description.hh"
 #include "doc.hh"
 #include "drawschema.hh"
+#include "dsp_profile.hh"
 #include "enrobage.hh"
 #include "errormsg.hh"
 #include "eval.hh"
@@ -112,19 +115,18 @@
 
 using namespace std;
 
-static unique_ptr<ifstream> injcode;
-static unique_ptr<ifstream> enrobage;
+// Compilation state is per thread, like gGlobal (see callFun)
+static thread_local unique_ptr<ifstream> injcode;
+static thread_local unique_ptr<ifstream> enrobage;
 
 #ifdef OCPP_BUILD
 // Old CPP compiler
-Compiler* old_comp = nullptr;
+static thread_local Compiler* old_comp = nullptr;
 #endif
 
 // FIR container
-InstructionsCompiler* new_comp  = nullptr;
-CodeContainer*        container = nullptr;
-
-typedef void* (*compile_fun)(void* arg);
+static thread_local InstructionsCompiler* new_comp  = nullptr;
+static thread_local CodeContainer*        container = nullptr;
 
 string reorganizeCompilationOptions(int argc, const char* argv[]);
 
@@ -172,59 +174,61 @@ static void enumBackends(ostream& out)
 #endif
 }
 
-static void callFun(compile_fun fun)
+#if !defined(EMCC) && !defined(_WIN32)
+struct CompilationThread {
+    const function<void()>* fFun;
+    TimingContext*          fTiming;
+    exception_ptr           fException;
+};
+
+static void* runCompilationThread(void* arg)
+{
+    CompilationThread* task = static_cast<CompilationThread*>(arg);
+    setTimingContext(task->fTiming);
+    try {
+        (*task->fFun)();
+    } catch (...) {
+        task->fException = current_exception();
+    }
+    return nullptr;
+}
+#endif
+
+// The whole compilation runs in its own thread : with more stack size for the evaluation and propagation steps,
+// and with its own compiler state (gGlobal and the other thread local variables), so that several compilations
+// can run concurrently. The caller timing context is used by the thread.
+static void callFun(const function<void()>& fun)
 {
 #if defined(EMCC) || defined(_WIN32)
     // No thread support in JS or WIN32
-    fun(NULL);
+    fun();
 #else
-    pthread_t      thread;
-    pthread_attr_t attr;
+    CompilationThread task = {&fun, getTimingContext(), nullptr};
+    pthread_t         thread;
+    pthread_attr_t    attr;
     faustassert(pthread_attr_init(&attr) == 0);
     faustassert(pthread_attr_setstacksize(&attr, MAX_STACK_SIZE) == 0);
     faustassert(pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE) == 0);
-    faustassert(pthread_create(&thread, &attr, fun, nullptr) == 0);
+    faustassert(pthread_create(&thread, &attr, runCompilationThread, &task) == 0);
     pthread_join(thread, nullptr);
-#endif
-}
-
-static Tree evaluateBlockDiagram(Tree expandedDefList, int& numInputs, int& numOutputs);
-
-static void* threadEvaluateBlockDiagram(void* arg)
-{
-    try {
-        gGlobal->gProcessTree =
-            evaluateBlockDiagram(gGlobal->gExpandedDefList, gGlobal->gNumInputs, gGlobal->gNumOutputs);
-    } catch (faustexception& e) {
-        gGlobal->gErrorMessage = e.Message();
-    }
-    return 0;
-}
-
-static void* threadBoxPropagateSig(void* arg)
-{
-    try {
-        gGlobal->gLsignalsTree =
-            boxPropagateSig(gGlobal->nil, gGlobal->gProcessTree, makeSigInputList(gGlobal->gNumInputs));
-    } catch (faustexception& e) {
-        gGlobal->gErrorMessage = e.Message();
+    pthread_attr_destroy(&attr);
+    if (task.fException) {
+        rethrow_exception(task.fException);
     }
-    return 0;
+#endif
 }
 
 /****************************************************************
                         Global context variable
 *****************************************************************/
 
-global* gGlobal = nullptr;
-
-// Timing can be used outside of the scope of 'gGlobal'
-extern bool gTimingSwitch;
+thread_local global* gGlobal = nullptr;
 
 /****************************************************************
                         Parser variables
 *****************************************************************/
 
+// Shared by all compilations, only used under the parser lock (see SourceReader::getList)
 int yyerr;
 
 /****************************************************************
@@ -249,6 +253,8 @@ static bool processCmdline(int argc, const char* argv[])
     int          err = 0;
     stringstream parse_error;
     bool         float_size = false;
+    bool         vec_size   = false;
+    string       profile_file;
 
     /*
     for (int i = 0; i < argc; i++) {
@@ -378,6 +384,10 @@ static bool processCmdline(int argc, const char* argv[])
             gGlobal->gMaxCopyDelay = std::atoi(argv[i + 1]);
             i += 2;
 
+        } else if (isCmd(argv[i], "-pgo", "--profile-guided") && (i + 1 < argc)) {
+            profile_file = argv[i + 1];
+            i += 2;
+
         } else if (isCmd(argv[i], "-mem", "--memory-manager")) {
             gGlobal->gMemoryManager = true;
             i += 1;
@@ -400,12 +410,21 @@ static bool processCmdline(int argc, const char* argv[])
 
         } else if (isCmd(argv[i], "-vs", "--vec-size") && (i + 1 < argc)) {
             gGlobal->gVecSize = std::atoi(argv[i + 1]);
+            vec_size          = true;
             i += 2;
 
         } else if (isCmd(argv[i], "-lv", "--loop-variant") && (i + 1 < argc)) {
             gGlobal->gVectorLoopVariant = std::atoi(argv[i + 1]);
             i += 2;
 
+        } else if (isCmd(argv[i], "-la", "--look-ahead") && (i + 1 < argc)) {
+            gGlobal->gLookAheadStep = std::atoi(argv[i + 1]);
+            i += 2;
+
+        } else if (isCmd(argv[i], "-cr", "--control-rate") && (i + 1 < argc)) {
+            gGlobal->gControlRate = std::atoi(argv[i + 1]);
+            i += 2;
+
         } else if (isCmd(argv[i], "-omp", "--openmp")) {
             gGlobal->gOpenMPSwitch = true;
             i += 1;
@@ -430,6 +449,10 @@ static bool processCmdline(int argc, const char* argv[])
             gGlobal->gGroupTaskSwitch = true;
             i += 1;
 
+        } else if (isCmd(argv[i], "-tgs", "--task-grain-size") && (i + 1 < argc)) {
+            gGlobal->gTaskGranularity = std::atoi(argv[i + 1]);
+            i += 2;
+
         } else if (isCmd(argv[i], "-fun", "--funTasks")) {
             gGlobal->gFunTaskSwitch = true;
             i += 1;
@@ -443,9 +466,13 @@ static bool processCmdline(int argc, const char* argv[])
             i += 2;
 
         } else if (isCmd(argv[i], "-time", "--compilation-time")) {
-            gTimingSwitch = true;
+            setTimingTrace();
             i += 1;
 
+        } else if (isCmd(argv[i], "-time-json", "--compilation-time-json") && (i + 1 < argc)) {
+            setTimingJSONFile(argv[i + 1]);
+            i += 2;
+
             // double float options
         } else if (isCmd(argv[i], "-single", "--single-precision-floats")) {
             if (float_size && gGlobal->gFloatSize != 1) {
@@ -540,6 +567,10 @@ static bool processCmdline(int argc, const char* argv[])
             gGlobal->gNameSpace = argv[i + 1];
             i += 2;
 
+        } else if (isCmd(argv[i], "-mv", "--multi-version")) {
+            gGlobal->gMultiVersion = true;
+            i += 1;
+
         } else if (isCmd(argv[i], "-I", "--import-dir") && (i + 1 < argc)) {
             if ((strstr(argv[i + 1], "http://") != 0) || (strstr(argv[i + 1], "https://") != 0)) {
                 // We want to search user given directories *before* the standard ones, so insert at the beginning
@@ -637,6 +668,21 @@ static bool processCmdline(int argc, const char* argv[])
     // Adjust related options
     if (gGlobal->gOpenMPSwitch || gGlobal->gSchedulerSwitch) gGlobal->gVectorSwitch = true;
 
+    // Runtime profile recorded by the interpreter (see FAUST_INTERP_PROFILE_FILE)
+    if (profile_file != "") {
+        gGlobal->gProfile = new DSPProfile();
+        if (!gGlobal->gProfile->read(profile_file)) {
+            stringstream error;
+            error << "ERROR : cannot read profile file '" << profile_file << "'" << endl;
+            throw faustexception(error.str());
+        }
+        // If 'compute' is always called with the same block size, smaller than the vector size, use it as vector size
+        int count = gGlobal->gProfile->getFixedCount();
+        if (gGlobal->gVectorSwitch && !vec_size && count > 0 && count < gGlobal->gVecSize) {
+            gGlobal->gVecSize = std::max(count, 4);
+        }
+    }
+
     // Check options coherency
     if (gGlobal->gInPlace && gGlobal->gVectorSwitch) {
         throw faustexception("ERROR : 'in-place' option can only be used in scalar mode\n");
@@ -654,6 +700,18 @@ static bool processCmdline(int argc, const char* argv[])
     if (gGlobal->gOneSample && gGlobal->gVectorSwitch) {
         throw faustexception("ERROR : '-os' option cannot only be used in scalar mode\n");
     }
+
+    if (gGlobal->gControlRate != 0) {
+        int n = gGlobal->gControlRate;
+        if (n < 2 || (n & (n - 1)) != 0) {
+            stringstream error;
+            error << "ERROR : invalid control rate [-cr = " << n << "] should be 0 or a power of 2" << endl;
+            throw faustexception(error.str());
+        }
+        if (gGlobal->gVectorSwitch || gGlobal->gOneSample) {
+            throw faustexception("ERROR : '-cr' option can only be used in scalar mode, without '-os'\n");
+        }
+    }
     
     if (gGlobal->gFTZMode == 2 && gGlobal->gOutputLang == "soul") {
         throw faustexception("ERROR : '-ftz 2' option cannot only be used in 'soul' backend\n");
@@ -670,6 +728,13 @@ static bool processCmdline(int argc, const char* argv[])
         error << "ERROR : invalid vector size [-vs = " << gGlobal->gVecSize << "] should be at least 4" << endl;
         throw faustexception(error.str());
     }
+
+    if (gGlobal->gLookAheadStep < 0 || gGlobal->gLookAheadStep == 1) {
+        stringstream error;
+        error << "ERROR : invalid look-ahead step [-la = " << gGlobal->gLookAheadStep << "] should be 0 or at least 2"
+              << endl;
+        throw faustexception(error.str());
+    }
     
     if (gGlobal->gFunTaskSwitch) {
         if (!(gGlobal->gOutputLang == "c"
@@ -692,6 +757,16 @@ static bool processCmdline(int argc, const char* argv[])
     if (gGlobal->gNameSpace != "" && gGlobal->gOutputLang != "cpp") {
         throw faustexception("ERROR : -ns can only be used with cpp backend\n");
     }
+
+    if (gGlobal->gMultiVersion) {
+        if (gGlobal->gOutputLang != "cpp") {
+            throw faustexception("ERROR : -mv can only be used with cpp backend\n");
+        }
+        if (gGlobal->gOneSample || gGlobal->gSchedulerSwitch || gGlobal->gFunTaskSwitch || gGlobal->gOpenCLSwitch ||
+            gGlobal->gCUDASwitch) {
+            throw faustexception("ERROR : -mv cannot be used with -os, -sch, -fun, -ocl or -cuda options\n");
+        }
+    }
     
     if (gGlobal->gArchFile != ""
         && ((gGlobal->gOutputLang == "wast")
@@ -842,6 +917,10 @@ static void printHelp()
     cout << tab
          << "-mem        --memory                    allocate static in global state using a custom memory manager."
          << endl;
+    cout << tab
+         << "-pgo <file> --profile-guided <file>     use the runtime profile <file> recorded by the interpreter "
+            "(see FAUST_INTERP_PROFILE_FILE)."
+         << endl;
     cout << tab
          << "-ftz <n>    --flush-to-zero <n>         code added to recursive signals [0:no (default), 1:fabs based, "
             "2:mask based (fastest)]."
@@ -851,6 +930,10 @@ static void printHelp()
             "a dsp file."
          << endl;
     cout << tab << "-scal      --scalar                     generate non-vectorized code." << endl;
+    cout << tab
+         << "-cr <n>    --control-rate <n>           compute the smoothed controls and their expressions every <n> "
+            "samples with linear interpolation (scalar mode, <n> power of 2, default 0: at sample rate)."
+         << endl;
     cout << tab
          << "-inpl      --in-place                   generates code working when input and output buffers are the same "
             "(scalar mode only)."
@@ -858,6 +941,11 @@ static void printHelp()
     cout << tab << "-vec       --vectorize                  generate easier to vectorize code." << endl;
     cout << tab << "-vs <n>    --vec-size <n>               size of the vector (default 32 samples)." << endl;
     cout << tab << "-lv <n>    --loop-variant <n>           [0:fastest (default), 1:simple]." << endl;
+    cout << tab
+         << "-la <n>    --look-ahead <n>             rewrite 1st and 2nd order linear recursive filters to depend on "
+            "samples <n> steps back, so that -vec loops can be vectorized (default 0: no look-ahead). Only the "
+            "filters with constant coefficients are rewritten."
+         << endl;
     cout << tab << "-omp       --openmp                     generate OpenMP pragmas, activates --vectorize option."
          << endl;
     cout << tab << "-pl        --par-loop                   generate parallel loops in --openmp mode." << endl;
@@ -872,6 +960,10 @@ static void printHelp()
          << "-g         --group-tasks                group single-threaded sequential tasks together when -omp or -sch "
             "is used."
          << endl;
+    cout << tab
+         << "-tgs <n>   --task-grain-size <n>        group tasks to reach <n> estimated operations per vector when -omp "
+            "or -sch is used (default 2048, 0 to deactivate)."
+         << endl;
     cout << tab
          << "-fun       --fun-tasks                  separate tasks code as separated functions (in -vec, -sch, or "
             "-omp mode)."
@@ -884,6 +976,10 @@ static void printHelp()
     cout << tab
          << "-ns <name> --namespace <name>           generate C++ code in a namespace <name> "
          << endl;
+    cout << tab
+         << "-mv        --multi-version              generate AVX512, AVX2 and default versions of 'compute' with the cpp "
+            "backend, chosen at init time."
+         << endl;
     cout << endl << "Block diagram options:" << line;
     cout << tab << "-ps        --postscript                 print block-diagram to a postscript file." << endl;
     cout << tab << "-svg       --svg                        print block-diagram to a svg file." << endl;
@@ -918,6 +1014,10 @@ static void printHelp()
     cout << endl << "Debug options:" << line;
     cout << tab << "-d          --details                   print compilation details." << endl;
     cout << tab << "-time       --compilation-time          display compilation phases timing information." << endl;
+    cout << tab
+         << "-time-json <file> --compilation-time-json <file> write compilation phases timing and memory report in "
+            "<file> (JSON format)."
+         << endl;
     cout << tab << "-tg         --task-graph                print the internal task graph in dot format." << endl;
     cout << tab << "-sg         --signal-graph              print the internal signal graph in dot format." << endl;
     cout << tab << "-norm       --normalized-form           print signals in normalized form and exit." << endl;
@@ -1530,7 +1630,9 @@ static void generateCode(Tree signals, int numInputs, int numOutputs, bool gener
                 }
 
                 container->printFloatDef();
+                startTiming("produceClass");
                 container->produceClass();
+                endTiming("produceClass");
 
                 streamCopyUntilEnd(*enrobage.get(), *dst.get());
 
@@ -1541,7 +1643,9 @@ static void generateCode(Tree signals, int numInputs, int numOutputs, bool gener
                 container->printFooter();
    
                 // Generate factory
+                startTiming("produceFactory");
                 gGlobal->gDSPFactory = container->produceFactory();
+                endTiming("produceFactory");
                 
                 if (gGlobal->gOutputFile == "string") {
                     gGlobal->gDSPFactory->write(dst.get(), false, false);
@@ -1572,11 +1676,15 @@ static void generateCode(Tree signals, int numInputs, int numOutputs, bool gener
         } else {
             container->printHeader();
             container->printFloatDef();
+            startTiming("produceClass");
             container->produceClass();
+            endTiming("produceClass");
             container->printFooter();
          
             // Generate factory
+            startTiming("produceFactory");
             gGlobal->gDSPFactory = container->produceFactory();
+            endTiming("produceFactory");
             
             if (gGlobal->gOutputFile == "string") {
                 gGlobal->gDSPFactory->write(dst.get(), false, false);
@@ -1783,10 +1891,7 @@ static string expandDSPInternal(int argc, const char* argv[], const char* name,
     /****************************************************************
      3 - evaluate 'process' definition
     *****************************************************************/
-    callFun(threadEvaluateBlockDiagram);  // In a thread with more stack size...
-    if (!gGlobal->gProcessTree) {
-        throw faustexception(gGlobal->gErrorMessage);
-    }
+    Tree process = evaluateBlockDiagram(gGlobal->gExpandedDefList, gGlobal->gNumInputs, gGlobal->gNumOutputs);
 
     // Encode compilation options as a 'declare' : has to be located first in the string
     stringstream out;
@@ -1800,7 +1905,7 @@ static string expandDSPInternal(int argc, const char* argv[], const char* name,
     }
 
     printDeclareHeader(out);
-    out << "process = " << boxpp(gGlobal->gProcessTree) << ';' << endl;
+    out << "process = " << boxpp(process) << ';' << endl;
     return out.str();
 }
 
@@ -1877,11 +1982,7 @@ static void compileFaustFactoryAux(int argc, const char* argv[], const char* nam
      3 - evaluate 'process' definition
     *****************************************************************/
 
-    callFun(threadEvaluateBlockDiagram);  // In a thread with more stack size...
-    if (!gGlobal->gProcessTree) {
-        throw faustexception(gGlobal->gErrorMessage);
-    }
-    Tree process    = gGlobal->gProcessTree;
+    Tree process    = evaluateBlockDiagram(gGlobal->gExpandedDefList, gGlobal->gNumInputs, gGlobal->gNumOutputs);
     int  numInputs  = gGlobal->gNumInputs;
     int  numOutputs = gGlobal->gNumOutputs;
 
@@ -1913,11 +2014,7 @@ static void compileFaustFactoryAux(int argc, const char* argv[], const char* nam
     *****************************************************************/
     startTiming("propagation");
 
-    callFun(threadBoxPropagateSig);  // In a thread with more stack size...
-    if (!gGlobal->gLsignalsTree) {
-        throw faustexception(gGlobal->gErrorMessage);
-    }
-    Tree lsignals = gGlobal->gLsignalsTree;
+    Tree lsignals = boxPropagateSig(gGlobal->nil, process, makeSigInputList(numInputs));
 
     if (gGlobal->gDetailsSwitch) {
         cout << "output signals are : " << endl;
@@ -1936,6 +2033,10 @@ static void compileFaustFactoryAux(int argc, const char* argv[], const char* nam
      6 - generate xml description, documentation or dot files
     *****************************************************************/
     generateOutputFiles();
+
+    if (!isTimingReportDeferred()) {
+        writeTimingReports();
+    }
 }
 
 // ============
@@ -1945,37 +2046,45 @@ static void compileFaustFactoryAux(int argc, const char* argv[], const char* nam
 dsp_factory_base* compileFaustFactory(int argc, const char* argv[], const char* name, const char* dsp_content,
                                       string& error_msg, bool generate)
 {
-    gGlobal                   = nullptr;
     dsp_factory_base* factory = nullptr;
-
-    try {
-        global::allocate();
-        compileFaustFactoryAux(argc, argv, name, dsp_content, generate);
-        error_msg = gGlobal->gErrorMsg;
-        factory   = gGlobal->gDSPFactory;
-    } catch (faustexception& e) {
-        error_msg = e.Message();
-    }
-
-    global::destroy();
+    resetTimingReport();
+
+    callFun([&]() {
+        gGlobal = nullptr;
+        try {
+            global::allocate();
+            compileFaustFactoryAux(argc, argv, name, dsp_content, generate);
+            error_msg = gGlobal->gErrorMsg;
+            factory   = gGlobal->gDSPFactory;
+        } catch (faustexception& e) {
+            error_msg = e.Message();
+        }
+        // Reports written by the backend after the compilation need the statistics of the compiler state
+        if (isTimingReportDeferred()) {
+            keepTimingStats();
+        }
+        global::destroy();
+    });
     return factory;
 }
 
 string expandDSP(int argc, const char* argv[], const char* name, const char* dsp_content, string& sha_key,
                  string& error_msg)
 {
-    gGlobal    = nullptr;
     string res = "";
-
-    try {
-        global::allocate();
-        res       = expandDSPInternal(argc, argv, name, dsp_content);
-        sha_key   = generateSHA1(res);
-        error_msg = gGlobal->gErrorMsg;
-    } catch (faustexception& e) {
-        error_msg = e.Message();
-    }
-
-    global::destroy();
+    resetTimingReport();
+
+    callFun([&]() {
+        gGlobal = nullptr;
+        try {
+            global::allocate();
+            res       = expandDSPInternal(argc, argv, name, dsp_content);
+            sha_key   = generateSHA1(res);
+            error_msg = gGlobal->gErrorMsg;
+        } catch (faustexception& e) {
+            error_msg = e.Message();
+        }
+        global::destroy();
+    });
     return res;
 }
@@ -24,12 +24,18 @@
 // Global API access lock
 TLockAble* gDSPFactoriesLock = nullptr;
 
+// Faust parser access lock
+TLockAble* gDSPParserLock = nullptr;
+
 extern "C" EXPORT bool startMTDSPFactories()
 {
     try {
         if (!gDSPFactoriesLock) {
             gDSPFactoriesLock = new TLockAble();
         }
+        if (!gDSPParserLock) {
+            gDSPParserLock = new TLockAble();
+        }
         return true;
     } catch (...) {
         return false;
@@ -40,4 +46,6 @@ extern "C" EXPORT void stopMTDSPFactories()
 {
     delete gDSPFactoriesLock;
     gDSPFactoriesLock = nullptr;
+    delete gDSPParserLock;
+    gDSPParserLock = nullptr;
 }
@@ -23,8 +23,15 @@
 #include "export.hh"
 
 extern TLockAble* gDSPFactoriesLock;
+extern TLockAble* gDSPParserLock;
 
+// Protects the factory tables and the other shared structures of the API
 #define LOCK_API TLock lock(gDSPFactoriesLock);
 
+// The compiler state (gGlobal, hash consing and symbol tables...) is per thread, so compilations run concurrently,
+// but the flex/bison parser uses global variables : a source file is parsed by one compilation at a time.
+// Never take LOCK_API while holding LOCK_PARSER.
+#define LOCK_PARSER TLock parser_lock(gDSPParserLock);
+
 extern "C" EXPORT bool startMTDSPFactories();
 extern "C" EXPORT void stopMTDSPFactories();
@@ -29,7 +29,7 @@
 
 using namespace std;
 
-typedef map<Tree, mterm> SM;
+typedef map<Tree, mterm, CompareTree> SM;
 
 aterm::aterm()
 {
@@ -44,7 +44,7 @@ using namespace std;
  */
 
 class aterm : public virtual Garbageable {
-    map<Tree, mterm> fSig2MTerms;  ///< mapping between signatures and corresponding mterms
+    map<Tree, mterm, CompareTree> fSig2MTerms;  ///< mapping between signatures and corresponding mterms
 
    public:
     aterm();        ///< create an empty aterm (equivalent to 0)
@@ -28,6 +28,7 @@
 
 ***********************************************************************/
 
+#include <algorithm>
 #include <list>
 #include <map>
 #include <set>
@@ -37,6 +38,7 @@
 #include "code_loop.hh"
 #include "floats.hh"
 #include "global.hh"
+#include "instructions_complexity.hh"
 
 using namespace std;
 
@@ -188,6 +190,56 @@ void CodeLoop::absorb(CodeLoop* l)
     fLoopIndex = l->fLoopIndex;
 }
 
+/**
+ * Merge a loop as an extra loop of this one, its code will be generated before the code of this one.
+ * The loop is either a dependency only used by this loop, or a loop of the same level in the DAG.
+ * @param l the Loop to be merged
+ * @param before whether to generate it before the current extra loops
+ */
+void CodeLoop::merge(CodeLoop* l, bool before)
+{
+    if (before) {
+        fExtraLoops.push_front(l);
+    } else {
+        fExtraLoops.push_back(l);
+    }
+    fBackwardLoopDependencies.erase(l);
+    for (auto& d : l->fBackwardLoopDependencies) {
+        // 'd' was already a dependency of this loop : it has now one user less
+        if (!fBackwardLoopDependencies.insert(d).second) {
+            d->fUseCount--;
+        }
+    }
+}
+
+bool CodeLoop::hasRecursiveLoop()
+{
+    if (fIsRecursive) return true;
+    for (auto& l : fExtraLoops) {
+        if (l->hasRecursiveLoop()) return true;
+    }
+    return false;
+}
+
+/**
+ * Estimate the cost of a loop with InstComplexityVisitor: the compute code is done
+ * for each sample of the vector, the pre and post code once per vector.
+ */
+int CodeLoop::getCost()
+{
+    InstComplexityVisitor compute;
+    fComputeInst->accept(&compute);
+    InstComplexityVisitor pre_post;
+    fPreInst->accept(&pre_post);
+    fPostInst->accept(&pre_post);
+
+    int cost = gGlobal->gVecSize * compute.cost() + pre_post.cost();
+    for (auto& l : fExtraLoops) {
+        cost += l->getCost();
+    }
+    return cost;
+}
+
 void CodeLoop::concat(CodeLoop* l)
 {
     // faustassert(l->fUseCount == 1);
@@ -301,3 +353,137 @@ void CodeLoop::groupSeqLoops(CodeLoop* l, set<CodeLoop*>& visited)
         }
     }
 }
+
+// Task grouping
+
+void CodeLoop::listLoops(CodeLoop* l, set<CodeLoop*>& visited, vector<CodeLoop*>& loops)
+{
+    if (visited.find(l) == visited.end()) {
+        visited.insert(l);
+        loops.push_back(l);
+        for (auto& p : l->fBackwardLoopDependencies) {
+            listLoops(p, visited, loops);
+        }
+    }
+}
+
+void CodeLoop::resetUseCount(CodeLoop* root)
+{
+    set<CodeLoop*>    visited;
+    vector<CodeLoop*> loops;
+    listLoops(root, visited, loops);
+    for (auto& l : loops) {
+        l->fUseCount = 0;
+    }
+    computeUseCount(root);
+}
+
+/**
+ * Merge loops only used by one other loop into it, when they are its only dependency
+ * (like groupSeqLoops, no parallelism is lost), or when the resulting task costs at most 'granularity'.
+ */
+void CodeLoop::groupCheapLoops(CodeLoop* root, int granularity)
+{
+    set<CodeLoop*>  visited;
+    list<CodeLoop*> todo;
+    todo.push_back(root);
+
+    while (!todo.empty()) {
+        CodeLoop* l = todo.front();
+        todo.pop_front();
+        if (visited.find(l) != visited.end()) continue;
+        visited.insert(l);
+
+        int  cost = l->getCost();
+        bool merged;
+        do {
+            merged = false;
+            for (auto& f : l->fBackwardLoopDependencies) {
+                if (f->fUseCount == 1) {
+                    int f_cost = f->getCost();
+                    if (l->fBackwardLoopDependencies.size() == 1 || cost + f_cost <= granularity) {
+                        l->merge(f, true);
+                        cost += f_cost;
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        } while (merged);
+
+        todo.insert(todo.end(), l->fBackwardLoopDependencies.begin(), l->fBackwardLoopDependencies.end());
+    }
+}
+
+/**
+ * Pack the loops of a same level of the DAG that are cheaper than 'granularity' together,
+ * in tasks costing at most 'granularity'. Loops of a same level do not depend on each other.
+ */
+void CodeLoop::groupLevelLoops(CodeLoop* root, int granularity)
+{
+    lclgraph G;
+    sortGraph(root, G);
+
+    // Level 0 only contains the root loop
+    for (int level = int(G.size()) - 1; level > 0; level--) {
+        if (G[level].size() < 2) continue;
+
+        // Cheapest loops first
+        vector<pair<int, CodeLoop*>> loops;
+        for (auto& l : G[level]) {
+            int cost = l->getCost();
+            if (cost < granularity) {
+                loops.push_back(make_pair(cost, l));
+            }
+        }
+        stable_sort(loops.begin(), loops.end(),
+                    [](const pair<int, CodeLoop*>& a, const pair<int, CodeLoop*>& b) { return a.first < b.first; });
+        if (loops.size() < 2) continue;
+
+        // Users of the loops of this level
+        set<CodeLoop*>    visited;
+        vector<CodeLoop*> all_loops;
+        listLoops(root, visited, all_loops);
+        map<CodeLoop*, vector<CodeLoop*>> users;
+        for (auto& u : all_loops) {
+            for (auto& d : u->fBackwardLoopDependencies) {
+                if (G[level].find(d) != G[level].end()) {
+                    users[d].push_back(u);
+                }
+            }
+        }
+
+        CodeLoop* task = nullptr;
+        int       task_cost = 0;
+        for (auto& it : loops) {
+            if (!task || task_cost + it.first > granularity) {
+                // Start a new task
+                task      = it.second;
+                task_cost = it.first;
+            } else {
+                task->merge(it.second, false);
+                task_cost += it.first;
+                // Users of the merged loop now depend on the task
+                for (auto& u : users[it.second]) {
+                    u->fBackwardLoopDependencies.erase(it.second);
+                    if (u->fBackwardLoopDependencies.insert(task).second) {
+                        task->fUseCount++;
+                    }
+                }
+                it.second->fUseCount = 0;
+            }
+        }
+    }
+}
+
+/**
+ * Group loops in tasks of at least 'granularity' estimated operations per vector (when possible)
+ * to lower the synchronisation overhead of the parallel code (-sch and -omp modes):
+ * cheap loops of a same level are packed together, then cheap loops are merged in the loop using them.
+ */
+void CodeLoop::groupTasks(CodeLoop* root, int granularity)
+{
+    resetUseCount(root);
+    groupLevelLoops(root, granularity);
+    groupCheapLoops(root, granularity);
+}
@@ -103,12 +103,19 @@ class CodeLoop : public virtual Garbageable {
 
     void absorb(CodeLoop* l);  ///< absorb a loop inside this one
     void concat(CodeLoop* l);
+    void merge(CodeLoop* l, bool before);  ///< merge a loop as an extra loop of this one
 
     // Graph sorting
     static void setOrder(CodeLoop* l, int order, lclgraph& V);
     static void setLevel(int order, const lclset& T1, lclset& T2, lclgraph& V);
     static void resetOrder(CodeLoop* l, set<CodeLoop*>& visited);
 
+    // Task grouping
+    static void listLoops(CodeLoop* l, set<CodeLoop*>& visited, vector<CodeLoop*>& loops);
+    static void resetUseCount(CodeLoop* root);
+    static void groupCheapLoops(CodeLoop* root, int granularity);
+    static void groupLevelLoops(CodeLoop* root, int granularity);
+
    public:
     ///< create a recursive loop
     CodeLoop(Tree recsymbol, CodeLoop* encl, const string& index_name, int size = 0)
@@ -159,6 +166,9 @@ class CodeLoop : public virtual Garbageable {
     }
 
     bool isRecursive() { return fIsRecursive; }
+    bool hasRecursiveLoop();  ///< true when this loop or one of its extra loops is recursive
+
+    int getCost();  ///< estimated number of operations to compute one vector (extra loops included)
 
     int getIndex() { return fIndex; }
 
@@ -192,6 +202,7 @@ class CodeLoop : public virtual Garbageable {
     static void sortGraph(CodeLoop* root, lclgraph& V);
     static void computeUseCount(CodeLoop* l);
     static void groupSeqLoops(CodeLoop* l, set<CodeLoop*>& visited);
+    static void groupTasks(CodeLoop* root, int granularity);
 };
 
 #endif
@@ -91,7 +91,7 @@
 using namespace std;
 
 extern char* 		yytext;
-extern const char* 	yyfilename;
+extern thread_local const char* 	yyfilename;
 extern int 			yylineno;
 extern int 			yyerr;
 
@@ -59,10 +59,11 @@ int hideUserAgent = 0;
 int hideReferer = 1;
 static int followRedirects = DEFAULT_REDIRECTS;	/* # of redirects to  follow */
 extern const char* http_errlist[];              /* Array of HTTP Fetcher error messages */
-extern char convertedError[128];                /* Buffer to used when errors contain %d */
-static int errorSource = 0;
-static int http_errno = 0;
-static int errorInt = 0;                        /* When the error message has a %d in it, this variable is inserted */
+extern thread_local char convertedError[128];   /* Buffer to used when errors contain %d */
+/* Error state is per thread, since several compilations may fetch files concurrently */
+static thread_local int errorSource = 0;
+static thread_local int http_errno = 0;
+static thread_local int errorInt = 0;           /* When the error message has a %d in it, this variable is inserted */
 
 const char* http_errlist[] =
 {
@@ -84,7 +85,7 @@ const char* http_errlist[] =
  * Used to copy in messages from http_errlist[] and replace %d's with the
  * value of errorInt.  Then we can pass the pointer to THIS
  */
-char convertedError[128];
+thread_local char convertedError[128];
 
 /*
  * Actually downloads the page, registering a hit (donation) If the fileBuf
@@ -46,6 +46,7 @@
 #include "ppbox.hh"
 #include "exception.hh"
 #include "global.hh"
+#include "lock_api.hh"
 #include "Text.hh"
 
 using namespace std;
@@ -63,7 +64,7 @@ extern int yyerr;
 extern int yydebug;
 extern FILE* yyin;
 extern int yylineno;
-extern const char* yyfilename;
+extern thread_local const char* yyfilename;
 
 /**
  * Checks an argument list for containing only
@@ -418,7 +419,11 @@ Tree SourceReader::getList(const char* fname)
 	if (!cached(fname)) {
         // Previous metadata need to be cleared before parsing a file
         gGlobal->gFunMDSet.clear();
-        Tree ldef = (gGlobal->gInputString) ? parseString(fname) : parseFile(fname);
+        Tree ldef;
+        {
+            LOCK_PARSER
+            ldef = (gGlobal->gInputString) ? parseString(fname) : parseFile(fname);
+        }
         // Definitions with metadata have to be wrapped into a boxMetadata construction
         fFileCache[fname] = addFunctionMetadata(ldef, gGlobal->gFunMDSet);
 	}
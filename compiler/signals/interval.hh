@@ -307,6 +307,22 @@ inline interval fmod(const interval& x, const interval& y)
     return x - n * y;
 }
 
+// Relative margin used when intervals prove that an operation can be removed:
+// intervals are computed in double while the signals may be computed in float.
+#define INTERVAL_MARGIN 1e-5
+
+// True when x is always lower or equal to y, with the margin
+inline bool isAlwaysLE(const interval& x, const interval& y)
+{
+    return x.valid && y.valid && (x.hi + INTERVAL_MARGIN * max(fabs(x.hi), fabs(y.lo)) <= y.lo);
+}
+
+// True when x % y (and fmod(x, y)) is always x, with the margin
+inline bool isRemIdentity(const interval& x, const interval& y)
+{
+    return x.valid && y.valid && (x.lo >= 0) && (y.lo > 0) && (x.hi * (1 + INTERVAL_MARGIN) < y.lo);
+}
+
 inline interval abs(const interval& x)
 {
     if (x.valid) {
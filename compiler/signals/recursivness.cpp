@@ -131,47 +131,57 @@ static int position(Tree env, Tree t, int p)
 //-----------------------------------list recursive symbols-----------------------
 
 /**
- * return the set of recursive symbols appearing in a signal.
+ * collect the recursive symbols appearing in a signal.
  * @param sig the signal to analyze
- * @return the set of symbols
+ * @param visited the already visited signals
+ * @param symbols the set of symbols to fill
  */
 
-Tree symlistVisit(Tree sig, set<Tree>& visited)
+static void symlistVisit(Tree sig, set<Tree>& visited, set<Tree>& symbols)
 {
     Tree S;
 
     if (gGlobal->gSymListProp->get(sig, S)) {
-        return S;
-    } else if (visited.count(sig) > 0) {
-        return gGlobal->nil;
-    } else {
+        for (; isList(S); S = tl(S)) {
+            symbols.insert(hd(S));
+        }
+    } else if (visited.count(sig) == 0) {
         visited.insert(sig);
         Tree id, body;
         if (isRec(sig, id, body)) {
-            Tree U = singleton(sig);
+            symbols.insert(sig);
             for (int i = 0; i < len(body); i++) {
-                U = setUnion(U, symlistVisit(nth(body, i), visited));
+                symlistVisit(nth(body, i), visited, symbols);
             }
-            return U;
         } else {
             vector<Tree> subsigs;
             int          n = getSubSignals(sig, subsigs, true);  // il faut visiter aussi les tables
-            Tree         U = gGlobal->nil;
             for (int i = 0; i < n; i++) {
-                U = setUnion(U, symlistVisit(subsigs[i], visited));
+                symlistVisit(subsigs[i], visited, symbols);
             }
-            return U;
         }
     }
 }
 
+/**
+ * return the set of recursive symbols appearing in a signal.
+ * @param sig the signal to analyze
+ * @return the set of symbols
+ */
+
 Tree symlist(Tree sig)
 {
     Tree S;
 
     if (!gGlobal->gSymListProp->get(sig, S)) {
-        set<Tree> visited;
-        S = symlistVisit(sig, visited);
+        set<Tree> visited, symbols;
+        symlistVisit(sig, visited, symbols);
+        // The ordered list (see addElement) is built at once : merging the partial lists with setUnion
+        // could allocate a quadratic number of cells, depending on the addresses of the symbols
+        S = gGlobal->nil;
+        for (set<Tree>::reverse_iterator it = symbols.rbegin(); it != symbols.rend(); it++) {
+            S = cons(*it, S);
+        }
         gGlobal->gSymListProp->set(sig, S);
     }
     // cerr << "SYMLIST " << *S << " OF " << ppsig(sig) << endl;
@@ -31,8 +31,8 @@ class property : public virtual Garbageable {
 
     P* access(Tree t)
     {
-        Tree d = t->getProperty(fKey);
-        return d ? (P*)(d->node().getPointer()) : 0;
+        PropertyValue* v = t->getValueProperty(fKey);
+        return v ? static_cast<P*>(v->fPointer) : 0;
     }
 
    public:
@@ -46,7 +46,9 @@ class property : public virtual Garbageable {
         if (p) {
             *p = data;
         } else {
-            t->setProperty(fKey, tree(Node((new GarbageablePtr<P>(data))->getPointer())));
+            PropertyValue v;
+            v.fPointer = (new GarbageablePtr<P>(data))->getPointer();
+            t->setValueProperty(fKey, v);
         }
     }
 
@@ -67,7 +69,7 @@ class property : public virtual Garbageable {
         if (p) {
             delete p;
         }
-        t->clearProperty(fKey);
+        t->clearValueProperty(fKey);
     }
 };
 
@@ -105,20 +107,25 @@ class property<int> : public virtual Garbageable {
 
     property(const char* keyname) : fKey(tree(Node(keyname))) {}
 
-    void set(Tree t, int i) { t->setProperty(fKey, tree(Node(i))); }
+    void set(Tree t, int i)
+    {
+        PropertyValue v;
+        v.fInt = i;
+        t->setValueProperty(fKey, v);
+    }
 
     bool get(Tree t, int& i)
     {
-        Tree d = t->getProperty(fKey);
-        if (d) {
-            i = d->node().getInt();
+        PropertyValue* v = t->getValueProperty(fKey);
+        if (v) {
+            i = v->fInt;
             return true;
         } else {
             return false;
         }
     }
 
-    void clear(Tree t) { t->clearProperty(fKey); }
+    void clear(Tree t) { t->clearValueProperty(fKey); }
 };
 
 template <>
@@ -130,20 +137,25 @@ class property<double> : public virtual Garbageable {
 
     property(const char* keyname) : fKey(tree(Node(keyname))) {}
 
-    void set(Tree t, double x) { t->setProperty(fKey, tree(Node(x))); }
+    void set(Tree t, double x)
+    {
+        PropertyValue v;
+        v.fDouble = x;
+        t->setValueProperty(fKey, v);
+    }
 
     bool get(Tree t, double& x)
     {
-        Tree d = t->getProperty(fKey);
-        if (d) {
-            x = d->node().getDouble();
+        PropertyValue* v = t->getValueProperty(fKey);
+        if (v) {
+            x = v->fDouble;
             return true;
         } else {
             return false;
         }
     }
 
-    void clear(Tree t) { t->clearProperty(fKey); }
+    void clear(Tree t) { t->clearValueProperty(fKey); }
 };
 
 #endif
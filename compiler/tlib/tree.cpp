@@ -74,11 +74,13 @@ storage of trees.
 *****************************************************************************/
 
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <cstdlib>
 #include <fstream>
+#include <iostream>
 
 #include "exception.hh"
 #include "tree.hh"
@@ -92,12 +94,28 @@ storage of trees.
         throw faustexception(s); \
     }
 
-Tree         CTree::gHashTable[kHashTableSize];
-bool         CTree::gDetails       = false;
-unsigned int CTree::gVisitTime     = 0;
-size_t       CTree::gSerialCounter = 0;
+thread_local Tree*        CTree::gHashTable      = nullptr;
+thread_local size_t       CTree::gHashTableSize  = 0;
+thread_local size_t       CTree::gHashTableCount = 0;
+thread_local size_t       CTree::gLookupCount    = 0;
+thread_local size_t       CTree::gProbeCount     = 0;
+thread_local size_t       CTree::gMaxProbeLength = 0;
+thread_local size_t       CTree::gRehashCount    = 0;
+thread_local bool         CTree::gDetails        = false;
+thread_local unsigned int CTree::gVisitTime      = 0;
+thread_local size_t       CTree::gSerialCounter  = 0;
+
+// The hash key is mostly made of pointers, so its bits are mixed before being masked
+static inline size_t hashIndex(size_t hk, size_t mask)
+{
+    uint64_t h = uint64_t(hk);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return size_t(h) & mask;
+}
 
-// Constructor : add the tree to the hash table
+// Constructor : the tree is added in the hash table by CTree::make
 CTree::CTree(size_t hk, const Node& n, const tvec& br)
     : fNode(n),
       fType(0),
@@ -107,30 +125,34 @@ CTree::CTree(size_t hk, const Node& n, const tvec& br)
       fVisitTime(0),
       fBranch(br)
 {
-    // link dans la hash table
-    int j         = hk % kHashTableSize;
-    fNext         = gHashTable[j];
-    gHashTable[j] = this;
 }
 
-// Destructor : remove the tree from the hash table
+// Destructor : remove the tree from the hash table (backward shift deletion)
 CTree::~CTree()
 {
-    int  i = fHashKey % kHashTableSize;
-    Tree t = gHashTable[i];
+    size_t mask = gHashTableSize - 1;
+    size_t i    = hashIndex(fHashKey, mask);
 
-    // printf("Delete of "); this->print(); printf("\n");
-    if (t == this) {
-        gHashTable[i] = fNext;
-    } else {
-        Tree p = nullptr;
-        while (t != this) {
-            p = t;
-            t = t->fNext;
+    while (gHashTable[i] != this) {
+        faustassert(gHashTable[i]);
+        i = (i + 1) & mask;
+    }
+
+    // Move back the following trees of the cluster that would not be reachable anymore
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        Tree t = gHashTable[j];
+        if (!t) break;
+        size_t k = hashIndex(t->fHashKey, mask);
+        // t can fill the hole at i if its home slot k is not in ]i, j]
+        if ((i <= j) ? ((k <= i) || (k > j)) : ((k <= i) && (k > j))) {
+            gHashTable[i] = t;
+            i             = j;
         }
-        faustassert(p);
-        p->fNext = fNext;
     }
+    gHashTable[i] = nullptr;
+    gHashTableCount--;
 }
 
 // equivalence
@@ -141,41 +163,84 @@ bool CTree::equiv(const Node& n, const tvec& br) const
 
 size_t CTree::calcTreeHash(const Node& n, const tvec& br)
 {
-    size_t               hk = size_t(n.getPointer());
+    size_t               hk = size_t(n.getPointer()) ^ size_t(n.type());
     tvec::const_iterator b  = br.begin();
     tvec::const_iterator z  = br.end();
 
+    // Combine the branches keys with enough mixing to avoid collisions
+    // between trees that only differ by small constants
     while (b != z) {
-        hk = (hk << 1) ^ (hk >> 20) ^ ((*b)->fHashKey);
+        hk ^= (*b)->fHashKey + size_t(0x9e3779b97f4a7c15ULL) + (hk << 6) + (hk >> 2);
         ++b;
     }
     return hk;
 }
 
+size_t CTree::lookup(size_t hk, const Node& n, const tvec& br)
+{
+    size_t mask  = gHashTableSize - 1;
+    size_t i     = hashIndex(hk, mask);
+    size_t probe = 1;
+
+    for (Tree t = gHashTable[i]; t && !(t->fHashKey == hk && t->equiv(n, br)); t = gHashTable[i]) {
+        i = (i + 1) & mask;
+        probe++;
+    }
+
+    gLookupCount++;
+    gProbeCount += probe;
+    if (probe > gMaxProbeLength) gMaxProbeLength = probe;
+    return i;
+}
+
+void CTree::rehash(size_t size)
+{
+    Tree*  old_table = gHashTable;
+    size_t old_size  = gHashTableSize;
+
+    gHashTable     = static_cast<Tree*>(calloc(size, sizeof(Tree)));
+    gHashTableSize = size;
+    if (!gHashTable) throw faustexception("ERROR : cannot allocate the tree hash table\n");
+
+    size_t mask = size - 1;
+    for (size_t i = 0; i < old_size; i++) {
+        Tree t = old_table[i];
+        if (t) {
+            size_t j = hashIndex(t->fHashKey, mask);
+            while (gHashTable[j]) j = (j + 1) & mask;
+            gHashTable[j] = t;
+        }
+    }
+
+    free(old_table);
+    gRehashCount++;
+}
+
 Tree CTree::make(const Node& n, int ar, Tree* tbl)
 {
     tvec br(ar);
 
     for (int i = 0; i < ar; i++) br[i] = tbl[i];
 
-    size_t hk = calcTreeHash(n, br);
-    Tree   t  = gHashTable[hk % kHashTableSize];
-
-    while (t && !t->equiv(n, br)) {
-        t = t->fNext;
-    }
-    return (t) ? t : new CTree(hk, n, br);
+    return make(n, br);
 }
 
 Tree CTree::make(const Node& n, const tvec& br)
 {
     size_t hk = calcTreeHash(n, br);
-    Tree   t  = gHashTable[hk % kHashTableSize];
+    size_t i  = lookup(hk, n, br);
+
+    if (gHashTable[i]) return gHashTable[i];
+
+    // Creating the tree does not touch the hash table, so the slot is still free
+    Tree t        = new CTree(hk, n, br);
+    gHashTable[i] = t;
 
-    while (t && !t->equiv(n, br)) {
-        t = t->fNext;
+    // Keep the load factor under 1/2 so that probe sequences stay short
+    if (++gHashTableCount * 2 > gHashTableSize) {
+        rehash(gHashTableSize * 2);
     }
-    return (t) ? t : new CTree(hk, n, br);
+    return t;
 }
 
 ostream& CTree::print(ostream& fout) const
@@ -202,24 +267,51 @@ ostream& CTree::print(ostream& fout) const
 void CTree::control()
 {
     printf("\ngHashTable Content :\n\n");
-    for (int i = 0; i < kHashTableSize; i++) {
+    for (size_t i = 0; i < gHashTableSize; i++) {
         Tree t = gHashTable[i];
         if (t) {
-            printf("%4d = ", i);
-            while (t) {
-                /*t->print();*/
-                printf(" => ");
-                t = t->fNext;
-            }
-            printf("VOID\n");
+            printf("%4zu = %p (home %zu)\n", i, (void*)t, hashIndex(t->fHashKey, gHashTableSize - 1));
         }
     }
     printf("\nEnd gHashTable\n");
+    printStats(cout);
+}
+
+void CTree::printStats(ostream& fout, bool json)
+{
+    if (json) {
+        fout << "{ \"trees\": " << gHashTableCount << ", \"slots\": " << gHashTableSize << ", \"rehash\": "
+             << gRehashCount << ", \"lookups\": " << gLookupCount << ", \"probes\": " << gProbeCount
+             << ", \"max_probe_length\": " << gMaxProbeLength << " }";
+        return;
+    }
+    fout << "CTree hash table : " << gHashTableCount << " trees in " << gHashTableSize << " slots (load "
+         << double(gHashTableCount) / double(gHashTableSize) << "), " << gRehashCount << " rehash, " << gLookupCount
+         << " lookups, average probe length "
+         << ((gLookupCount > 0) ? double(gProbeCount) / double(gLookupCount) : 0.) << ", max probe length "
+         << gMaxProbeLength << endl;
 }
 
 void CTree::init()
 {
-    memset(gHashTable, 0, sizeof(Tree) * kHashTableSize);
+    free(gHashTable);
+    gHashTable      = static_cast<Tree*>(calloc(kHashTableInitSize, sizeof(Tree)));
+    gHashTableSize  = kHashTableInitSize;
+    gHashTableCount = 0;
+    gLookupCount    = 0;
+    gProbeCount     = 0;
+    gMaxProbeLength = 0;
+    gRehashCount    = 0;
+    if (!gHashTable) throw faustexception("ERROR : cannot allocate the tree hash table\n");
+}
+
+// Release the hash table once all trees have been deleted
+void CTree::cleanup()
+{
+    free(gHashTable);
+    gHashTable      = nullptr;
+    gHashTableSize  = 0;
+    gHashTableCount = 0;
 }
 
 // if t has a node of type int, return it otherwise error
@@ -402,8 +494,5 @@ void* getUserData(Tree t)
 
 void CTree::exportProperties(vector<Tree>& keys, vector<Tree>& values)
 {
-    for (plist::const_iterator p = fProperties.begin(); p != fProperties.end(); p++) {
-        keys.push_back(p->first);
-        values.push_back(p->second);
-    }
+    fProperties.exportProperties(keys, values);
 }
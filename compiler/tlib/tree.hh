@@ -85,8 +85,106 @@
 class CTree;
 typedef CTree* Tree;
 
-typedef map<Tree, Tree> plist;
-typedef vector<Tree>    tvec;
+typedef vector<Tree> tvec;
+
+/**
+ * Value of a property that is not a tree : ints, doubles and pointers are
+ * stored directly, without allocating a tree node to hold them.
+ */
+union PropertyValue {
+    int    fInt;
+    double fDouble;
+    void*  fPointer;
+};
+
+/**
+ * A compact property list. Most trees only carry a few properties : they are kept
+ * in a small flat array searched linearly. Trees with many properties (typically
+ * the environments of the evaluator) switch to a map.
+ */
+template <class V>
+class PropertyList {
+   private:
+    static const size_t kMaxFlatSize = 8;  ///< number of properties above which the map is used
+
+    vector<pair<Tree, V> > fFlat;  ///< the properties, as long as there are less than kMaxFlatSize
+    map<Tree, V>*          fMap;   ///< the properties, when there are more than kMaxFlatSize
+
+    PropertyList(const PropertyList&);
+    PropertyList& operator=(const PropertyList&);
+
+   public:
+    PropertyList() : fMap(nullptr) {}
+    ~PropertyList() { delete fMap; }
+
+    V* find(Tree key)
+    {
+        if (fMap) {
+            typename map<Tree, V>::iterator it = fMap->find(key);
+            return (it == fMap->end()) ? nullptr : &it->second;
+        }
+        for (size_t i = 0; i < fFlat.size(); i++) {
+            if (fFlat[i].first == key) return &fFlat[i].second;
+        }
+        return nullptr;
+    }
+
+    void set(Tree key, const V& value)
+    {
+        V* v = find(key);
+        if (v) {
+            *v = value;
+        } else if (fMap) {
+            (*fMap)[key] = value;
+        } else if (fFlat.size() < kMaxFlatSize) {
+            fFlat.push_back(make_pair(key, value));
+        } else {
+            fMap = new map<Tree, V>(fFlat.begin(), fFlat.end());
+            (*fMap)[key] = value;
+            vector<pair<Tree, V> >().swap(fFlat);
+        }
+    }
+
+    void erase(Tree key)
+    {
+        if (fMap) {
+            fMap->erase(key);
+            return;
+        }
+        for (size_t i = 0; i < fFlat.size(); i++) {
+            if (fFlat[i].first == key) {
+                fFlat[i] = fFlat.back();
+                fFlat.pop_back();
+                return;
+            }
+        }
+    }
+
+    void clear()
+    {
+        delete fMap;
+        fMap = nullptr;
+        vector<pair<Tree, V> >().swap(fFlat);
+    }
+
+    void exportProperties(vector<Tree>& keys, vector<V>& values) const
+    {
+        if (fMap) {
+            for (typename map<Tree, V>::const_iterator it = fMap->begin(); it != fMap->end(); it++) {
+                keys.push_back(it->first);
+                values.push_back(it->second);
+            }
+        } else {
+            for (size_t i = 0; i < fFlat.size(); i++) {
+                keys.push_back(fFlat[i].first);
+                values.push_back(fFlat[i].second);
+            }
+        }
+    }
+};
+
+typedef PropertyList<Tree>          plist;
+typedef PropertyList<PropertyValue> vlist;
 
 /**
  * A CTree = (Node x [CTree]) is a Node associated with a list of subtrees called branches.
@@ -107,20 +205,29 @@ typedef vector<Tree>    tvec;
 
 class CTree : public virtual Garbageable {
    private:
-    static const int kHashTableSize = 400009;     ///< size of the hash table (prime number)
-    static size_t    gSerialCounter;              ///< the serial number counter
-    static Tree      gHashTable[kHashTableSize];  ///< hash table used for "hash consing"
+    static const size_t kHashTableInitSize = 1 << 17;  ///< initial size of the hash table (power of 2)
+    // the hash consing state belongs to the compilation running in the current thread
+    static thread_local size_t gSerialCounter;   ///< the serial number counter
+    static thread_local Tree*  gHashTable;       ///< open addressing hash table used for "hash consing"
+    static thread_local size_t gHashTableSize;   ///< current size of the hash table (always a power of 2)
+    static thread_local size_t gHashTableCount;  ///< number of trees stored in the hash table
+
+    // hash table statistics
+    static thread_local size_t gLookupCount;     ///< number of lookups done in the hash table
+    static thread_local size_t gProbeCount;      ///< total number of probes done by the lookups
+    static thread_local size_t gMaxProbeLength;  ///< longest probe sequence seen so far
+    static thread_local size_t gRehashCount;     ///< number of times the hash table has been grown
 
    public:
-    static bool         gDetails;    ///< Ctree::print() print with more details when true
-    static unsigned int gVisitTime;  ///< Should be incremented for each new visit to keep track of visited tree.
+    static thread_local bool         gDetails;    ///< Ctree::print() print with more details when true
+    static thread_local unsigned int gVisitTime;  ///< Should be incremented for each new visit to keep track of visited tree.
 
    private:
     // fields
-    Tree         fNext;        ///< next tree in the same hashtable entry
     Node         fNode;        ///< the node content of the tree
     void*        fType;        ///< the type of a tree
     plist        fProperties;  ///< the properties list attached to the tree
+    vlist        fValueProperties;  ///< the properties list attached to the tree, for non tree values
     size_t       fHashKey;     ///< the hashtable key
     size_t       fSerial;      ///< the increasing serial number
     int          fAperture;    ///< how "open" is a tree (synthezised field)
@@ -133,6 +240,9 @@ class CTree : public virtual Garbageable {
     static size_t calcTreeHash(const Node& n,
                                const tvec& br);  ///< compute the hash key of a tree according to its node and branches
     static int    calcTreeAperture(const Node& n, const tvec& br);  ///< compute how open is a tree
+    static size_t lookup(size_t hk, const Node& n,
+                         const tvec& br);  ///< index of the equivalent tree, or of the free slot where to put it
+    static void   rehash(size_t size);     ///< move all trees in a new hash table of the given size
 
    public:
     virtual ~CTree();
@@ -153,8 +263,12 @@ class CTree : public virtual Garbageable {
     // Print a tree and the hash table (for debugging purposes)
     ostream&    print(ostream& fout) const;  ///< print recursively the content of a tree on a stream
     static void control();                   ///< print the hash table content (for debug purpose)
+    static void printStats(ostream& fout, bool json = false);  ///< print the hash table statistics
 
     static void init();
+    static void cleanup();
+
+    static size_t serialCounter() { return gSerialCounter; }  ///< return the number of trees created so far
 
     // type information
     void  setType(void* t) { fType = t; }
@@ -169,21 +283,26 @@ class CTree : public virtual Garbageable {
     }
 
     // Property list of a tree
-    void setProperty(Tree key, Tree value) { fProperties[key] = value; }
+    void setProperty(Tree key, Tree value) { fProperties.set(key, value); }
     void clearProperty(Tree key) { fProperties.erase(key); }
-    void clearProperties() { fProperties = plist(); }
+    void clearProperties()
+    {
+        fProperties.clear();
+        fValueProperties.clear();
+    }
 
     void exportProperties(vector<Tree>& keys, vector<Tree>& values);
 
     Tree getProperty(Tree key)
     {
-        plist::iterator i = fProperties.find(key);
-        if (i == fProperties.end()) {
-            return 0;
-        } else {
-            return i->second;
-        }
+        Tree* v = fProperties.find(key);
+        return (v) ? *v : 0;
     }
+
+    // Non tree valued properties of a tree
+    void           setValueProperty(Tree key, const PropertyValue& value) { fValueProperties.set(key, value); }
+    void           clearValueProperty(Tree key) { fValueProperties.erase(key); }
+    PropertyValue* getValueProperty(Tree key) { return fValueProperties.find(key); }
 };
 
 //---------------------------------API---------------------------------------
@@ -0,0 +1,250 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#include "sigLookAhead.hh"
+#include <map>
+#include <vector>
+#include "global.hh"
+#include "normalize.hh"
+#include "signals.hh"
+#include "sigtyperules.hh"
+#include "simplify.hh"
+#include "tlib.hh"
+#include "tree.hh"
+
+/********************************************************************
+ Linear form of a recursion body : x + c[1]*y@1 + c[2]*y@2
+ (null trees stand for missing terms)
+**********************************************************************/
+
+struct LinearForm {
+    Tree fInput;
+    Tree fCoefs[3];
+
+    LinearForm() : fInput(nullptr) { fCoefs[0] = fCoefs[1] = fCoefs[2] = nullptr; }
+};
+
+static Tree addTerm(Tree a, Tree b)
+{
+    return (a) ? ((b) ? sigAdd(a, b) : a) : b;
+}
+
+static Tree subTerm(Tree a, Tree b)
+{
+    return (b) ? ((a) ? sigSub(a, b) : sigSub(sigReal(0.0), b)) : a;
+}
+
+static Tree mulTerm(Tree a, Tree f)
+{
+    return (a) ? sigMul(a, f) : a;
+}
+
+static Tree divTerm(Tree a, Tree f)
+{
+    return (a) ? sigDiv(a, f) : a;
+}
+
+// Test if the recursive group 'rec' is used by sig, without entering the other recursive groups
+static bool dependsOn(Tree sig, Tree rec, map<Tree, bool>& memo)
+{
+    auto it = memo.find(sig);
+    if (it != memo.end()) return (*it).second;
+
+    Tree var, body;
+    bool res = false;
+    if (sig == rec) {
+        res = true;
+    } else if (!isRec(sig, var, body)) {
+        for (Tree b : sig->branches()) {
+            if (dependsOn(b, rec, memo)) {
+                res = true;
+                break;
+            }
+        }
+    }
+    memo[sig] = res;
+    return res;
+}
+
+// Test if sig uses a recursive group being visited (other than 'rec'), that is if 'rec' is nested in another group
+static bool isNested(Tree sig, Tree rec, map<Tree, bool>& memo)
+{
+    auto it = memo.find(sig);
+    if (it != memo.end()) return (*it).second;
+
+    Tree var, body;
+    bool res = false;
+    if (isRec(sig, var, body)) {
+        res = (sig != rec) && isNil(body);
+    } else {
+        for (Tree b : sig->branches()) {
+            if (isNested(b, rec, memo)) {
+                res = true;
+                break;
+            }
+        }
+    }
+    memo[sig] = res;
+    return res;
+}
+
+// The delay of sig if sig is the first signal of 'rec' delayed by a constant, or -1
+static int recDelay(Tree sig, Tree rec)
+{
+    int  i, d;
+    Tree x, y;
+
+    if (isProj(sig, &i, x)) {
+        return (x == rec && i == 0) ? 0 : -1;
+    } else if (isSigDelay1(sig, x)) {
+        int k = recDelay(x, rec);
+        return (k >= 0) ? k + 1 : -1;
+    } else if (isSigFixDelay(sig, x, y) && isSigInt(y, &d)) {
+        int k = recDelay(x, rec);
+        return (k >= 0 && d >= 0) ? k + d : -1;
+    } else {
+        return -1;
+    }
+}
+
+// Decompose sig as a linear form of the delayed first signal of 'rec'
+static bool linearForm(Tree sig, Tree rec, map<Tree, bool>& memo, LinearForm& form)
+{
+    int  op;
+    Tree x, y;
+
+    if (!dependsOn(sig, rec, memo)) {
+        form.fInput = sig;
+        return true;
+    }
+
+    int k = recDelay(sig, rec);
+    if (k >= 1 && k <= 2) {
+        form.fCoefs[k] = sigReal(1.0);
+        return true;
+    } else if (k >= 0) {
+        return false;
+    }
+
+    if (!isSigBinOp(sig, &op, x, y)) return false;
+
+    if (op == kAdd || op == kSub) {
+        LinearForm f1, f2;
+        if (!linearForm(x, rec, memo, f1) || !linearForm(y, rec, memo, f2)) return false;
+        for (int i = 0; i < 3; i++) {
+            form.fCoefs[i] = (op == kAdd) ? addTerm(f1.fCoefs[i], f2.fCoefs[i]) : subTerm(f1.fCoefs[i], f2.fCoefs[i]);
+        }
+        form.fInput = (op == kAdd) ? addTerm(f1.fInput, f2.fInput) : subTerm(f1.fInput, f2.fInput);
+        return true;
+
+    } else if (op == kMul || op == kDiv) {
+        // The factor has to be independent of the recursion and constant: the K-step form is computed
+        // from the coefficients of the last sample only, so it would not be exact after a control change
+        if (op == kMul && dependsOn(y, rec, memo)) std::swap(x, y);
+        if (dependsOn(y, rec, memo) || getCertifiedSigType(y)->variability() != kKonst) return false;
+        if (!linearForm(x, rec, memo, form)) return false;
+        for (int i = 0; i < 3; i++) {
+            form.fCoefs[i] = (op == kMul) ? mulTerm(form.fCoefs[i], y) : divTerm(form.fCoefs[i], y);
+        }
+        form.fInput = (op == kMul) ? mulTerm(form.fInput, y) : divTerm(form.fInput, y);
+        return true;
+
+    } else {
+        return false;
+    }
+}
+
+static Tree power(Tree x, int n)
+{
+    Tree res = sigReal(1.0);
+    for (int i = 0; i < n; i++) {
+        res = sigMul(res, x);
+    }
+    return res;
+}
+
+/********************************************************************
+ Rewrite the body of a single signal recursive group, or return it unchanged
+**********************************************************************/
+
+Tree SignalLookAhead::lookAhead(Tree rec, Tree body)
+{
+    if (!isList(body) || !isNil(tl(body))) return body;
+
+    // A filter inside a larger recursion could not be vectorized anyway
+    Tree            exp = hd(body);
+    map<Tree, bool> memo, nested;
+    LinearForm      form;
+    if (getCertifiedSigType(exp)->nature() != kReal || isNested(exp, rec, nested) ||
+        !linearForm(exp, rec, memo, form) || !form.fInput) {
+        return body;
+    }
+    if (!form.fCoefs[1] && !form.fCoefs[2]) return body;
+
+    int  K  = fStep;
+    Tree c1 = (form.fCoefs[1]) ? form.fCoefs[1] : sigReal(0.0);
+    Tree c2 = form.fCoefs[2];
+
+    // Impulse response h of 1/(1 - c1.z^-1 - c2.z^-2), and power sums s of its poles
+    vector<Tree> h = {sigReal(1.0), c1};
+    vector<Tree> s = {sigReal(2.0), c1};
+    for (int m = 2; m <= 2 * K; m++) {
+        h.push_back((c2) ? sigAdd(sigMul(c1, h[m - 1]), sigMul(c2, h[m - 2])) : sigMul(c1, h[m - 1]));
+        s.push_back((c2) ? sigAdd(sigMul(c1, s[m - 1]), sigMul(c2, s[m - 2])) : sigMul(c1, s[m - 1]));
+    }
+
+    // First order : y = sum(c1^m * x@m, m < K) + c1^K * y@K
+    // Second order : the numerator is h * (1 - s[K].z^-K + (-c2)^K.z^-2K) truncated to 2K-1 terms
+    int  taps = (c2) ? 2 * K - 1 : K;
+    Tree y    = sigProj(0, rec);
+    Tree res  = form.fInput;  // h[0] = 1
+    for (int m = 1; m < taps; m++) {
+        Tree b = (m < K) ? h[m] : sigSub(h[m], sigMul(s[K], h[m - K]));
+        res    = sigAdd(res, sigMul(simplify(b), normalizeFixedDelayTerm(form.fInput, sigInt(m))));
+    }
+    if (c2) {
+        res = sigAdd(res, sigMul(simplify(s[K]), sigFixDelay(y, sigInt(K))));
+        res = sigSub(res, sigMul(simplify(power(sigSub(sigReal(0.0), c2), K)), sigFixDelay(y, sigInt(2 * K))));
+    } else {
+        res = sigAdd(res, sigMul(simplify(h[K]), sigFixDelay(y, sigInt(K))));
+    }
+
+    return list1(res);
+}
+
+/********************************************************************
+SignalLookAhead::transformation(Tree sig) :
+
+Rewrite the recursive groups that are linear filters of order 1 or 2
+**********************************************************************/
+
+Tree SignalLookAhead::transformation(Tree sig)
+{
+    Tree var, le;
+
+    if (isRec(sig, var, le) && !isNil(le)) {
+        // first visit
+        rec(var, gGlobal->nil);  // to avoid infinite recursions
+        return rec(var, lookAhead(sig, mapself(le)));
+    } else {
+        return SignalIdentity::transformation(sig);
+    }
+}
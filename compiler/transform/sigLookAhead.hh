@@ -0,0 +1,54 @@
+/************************************************************************
+ ************************************************************************
+    FAUST compiler
+    Copyright (C) 2003-2018 GRAME, Centre National de Creation Musicale
+    ---------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ ************************************************************************
+ ************************************************************************/
+
+#ifndef __SIGLOOKAHEAD__
+#define __SIGLOOKAHEAD__
+
+#include "sigIdentity.hh"
+
+//-------------------------SignalLookAhead------------------------------
+// Rewrite the linear time-invariant recursions of order 1 and 2 :
+//      y = x + c1*y@1 + c2*y@2     (c1 and c2 constant)
+// with a scattered look-ahead of K steps :
+//      y = b0*x + b1*x@1 + ... + b(2K-2)*x@(2K-2) + e1*y@K + e2*y@2K
+// A sample then only depends on samples at least K steps back, so that the
+// recursive loops of the -vec mode can be vectorized. The poles of the
+// rewritten filter are the K-th roots of the K-th powers of the original
+// ones, so the stability is kept. The signals must be type annotated.
+// The rewritten filter is only exact when c1 and c2 did not change during
+// the last 2K samples, so the filters with coefficients computed at control
+// rate (from a slider for instance) are left unchanged.
+//----------------------------------------------------------------------
+
+class SignalLookAhead : public SignalIdentity {
+    int fStep;  // the look-ahead step K
+
+   public:
+    SignalLookAhead(int step) : fStep(step) {}
+
+   protected:
+    virtual Tree transformation(Tree sig);
+
+   private:
+    Tree lookAhead(Tree rec, Tree body);
+};
+
+#endif
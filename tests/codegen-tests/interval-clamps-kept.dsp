@@ -0,0 +1,6 @@
+// min, max and fmod whose result depends on the signal values are kept in the code
+x = +(0.01)~_ : sin;            // in [-1, 1]
+y = x : abs;                    // in [0, 1]
+// min(x, 1) is also kept, since the intervals are only trusted with a margin,
+// and hosts can write any value in a control zone, so clamps on UI controls are kept
+process = min(x, 0.5), max(x, -0.5), fmod(y, 1), min(x, 1), min(hslider("h", 0.25, 0, 0.5, 0.01), 1);
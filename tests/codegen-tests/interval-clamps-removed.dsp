@@ -0,0 +1,4 @@
+// min, max and fmod that the signal intervals prove useless are removed from the code
+x = +(0.01)~_ : sin;            // in [-1, 1]
+y = x : abs : *(0.5);           // in [0, 0.5]
+process = min(x, 2), max(x, -2), fmod(y, 1), min(2, x), max(-2, x);
@@ -0,0 +1,9 @@
+// Two cascaded one-pole and biquad sections, rewritten by -la,
+// and a one-pole section with a control rate coefficient, which is left unchanged
+
+c = hslider("c", 0.5, 0, 0.9, 0.01);
+
+onepole(a) = + ~ *(a);
+biquad(a1, a2) = + ~ (_ <: *(a1), (mem : *(a2)) :> _);
+
+process = (onepole(0.5) : onepole(0.7)), (biquad(1.2, -0.5) : biquad(0.9, -0.3)), onepole(c);
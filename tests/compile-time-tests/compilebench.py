@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+#
+# Compile time benchmark of the Faust compiler
+#
+# Runs the compiler over a corpus of DSP files, for a set of backends and compilation modes,
+# records compile time and peak memory of each compilation in a JSON file, and possibly
+# compares the results with a reference JSON file to detect regressions.
+#
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+DEFAULT_LANGS = ["cpp", "c", "interp", "llvm", "wasm"]
+DEFAULT_MODES = ["", "-vec -lv 1", "-sch"]
+
+
+def collect_files(roots):
+    files = []
+    for root in roots:
+        if os.path.isfile(root):
+            files.append(root)
+            continue
+        for folder, _, names in os.walk(root):
+            for name in names:
+                if name.endswith(".dsp") and "TODO" not in name:
+                    files.append(os.path.join(folder, name))
+    return sorted(files)
+
+
+def faust_version(faust):
+    try:
+        out = subprocess.run([faust, "--version"], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True).stdout
+    except OSError:
+        sys.exit("ERROR : cannot run " + faust)
+    for line in out.splitlines():
+        if "Version" in line:
+            return line.split("Version")[-1].strip()
+    return "unknown"
+
+
+def run(cmd, timeout):
+    # os.wait4 gives the resource usage of this compilation only
+    start = time.time()
+    pid = os.fork()
+    if pid == 0:
+        devnull = os.open(os.devnull, os.O_WRONLY)
+        os.dup2(devnull, 1)
+        os.dup2(devnull, 2)
+        try:
+            os.execv(cmd[0], cmd)
+        finally:
+            os._exit(127)
+    deadline = start + timeout
+    while True:
+        rpid, status, usage = os.wait4(pid, os.WNOHANG)
+        if rpid == pid:
+            break
+        if time.time() > deadline:
+            os.kill(pid, 9)
+            os.wait4(pid, 0)
+            return {"status": "timeout"}
+        time.sleep(0.002)
+    wall = time.time() - start
+    rss = usage.ru_maxrss if sys.platform != "darwin" else usage.ru_maxrss // 1024
+    return {"status": "ok" if os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0 else "error",
+            "wall": round(wall, 4),
+            "cpu": round(usage.ru_utime + usage.ru_stime, 4),
+            "rss": rss}
+
+
+def measure(faust, dsp, lang, mode, repeat, timeout, phases):
+    cmd = [faust, "-lang", lang] + mode.split() + [dsp, "-o", os.devnull]
+    best = None
+    report = None
+    for _ in range(repeat):
+        json_file = None
+        if phases:
+            fd, json_file = tempfile.mkstemp(suffix=".json")
+            os.close(fd)
+            res = run(cmd + ["-time-json", json_file], timeout)
+        else:
+            res = run(cmd, timeout)
+        if json_file:
+            try:
+                with open(json_file) as f:
+                    report = json.load(f)
+            except (OSError, ValueError):
+                report = None
+            os.remove(json_file)
+        if res["status"] != "ok":
+            return res
+        # Keep the fastest run, to reduce the noise
+        if best is None or res["cpu"] < best["cpu"]:
+            best = res
+    if report:
+        best["phases"] = {p["name"]: round(p["time"], 4) for p in report["phases"]}
+    return best
+
+
+def compare(results, reference, time_tol, mem_tol, min_time):
+    regressions, improvements = [], []
+    for key, ref in sorted(reference["results"].items()):
+        cur = results["results"].get(key)
+        if cur is None:
+            continue
+        if ref["status"] == "ok" and cur["status"] != "ok":
+            regressions.append("%s : %s (was ok)" % (key, cur["status"]))
+            continue
+        if ref["status"] != "ok" or cur["status"] != "ok":
+            continue
+        delta = cur["cpu"] - ref["cpu"]
+        if delta > min_time and cur["cpu"] > ref["cpu"] * (1 + time_tol):
+            regressions.append("%s : time %.3fs -> %.3fs (+%.0f%%)" % (key, ref["cpu"], cur["cpu"],
+                                                                    100 * delta / max(ref["cpu"], 1e-6)))
+        elif -delta > min_time and cur["cpu"] < ref["cpu"] * (1 - time_tol):
+            improvements.append("%s : time %.3fs -> %.3fs" % (key, ref["cpu"], cur["cpu"]))
+        if cur["rss"] > ref["rss"] * (1 + mem_tol):
+            regressions.append("%s : peak RSS %d KB -> %d KB (+%.0f%%)" % (key, ref["rss"], cur["rss"],
+                                                                        100.0 * (cur["rss"] - ref["rss"]) / ref["rss"]))
+    return regressions, improvements
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    root = os.path.normpath(os.path.join(here, "..", ".."))
+    parser = argparse.ArgumentParser(description="Faust compile time benchmark")
+    parser.add_argument("--faust", default=os.environ.get("FAUST", os.path.join(root, "build", "bin", "faust")))
+    parser.add_argument("--langs", default=",".join(DEFAULT_LANGS), help="comma separated list of backends")
+    parser.add_argument("--modes", default=",".join(DEFAULT_MODES),
+                        help="comma separated list of compilation options (an empty item is the scalar mode)")
+    parser.add_argument("--repeat", type=int, default=1, help="number of runs of each compilation (the fastest is kept)")
+    parser.add_argument("--timeout", type=float, default=120, help="timeout of each compilation (in seconds)")
+    parser.add_argument("--phases", action="store_true", help="also record the duration of each compilation phase")
+    parser.add_argument("--output", "-o", default="compilebench.json", help="JSON file where results are written")
+    parser.add_argument("--reference", "-r", help="reference JSON file to compare with")
+    parser.add_argument("--time-tolerance", type=float, default=0.15, help="allowed relative time increase")
+    parser.add_argument("--mem-tolerance", type=float, default=0.10, help="allowed relative peak memory increase")
+    parser.add_argument("--min-time", type=float, default=0.05,
+                        help="time differences below this value (in seconds) are ignored")
+    parser.add_argument("files", nargs="*", help="DSP files or folders (default: examples, codegen-tests, benchmark and this folder)")
+    args = parser.parse_args()
+
+    roots = args.files or [os.path.join(root, "examples"), os.path.join(root, "tests", "codegen-tests"),
+                           os.path.join(root, "benchmark"), here]
+    files = collect_files(roots)
+    langs = [l for l in args.langs.split(",") if l]
+    modes = args.modes.split(",")
+
+    results = {"version": faust_version(args.faust), "faust": args.faust, "results": {}}
+    for dsp in files:
+        name = os.path.relpath(dsp, root)
+        for lang in langs:
+            for mode in modes:
+                key = "%s|%s|%s" % (name, lang, mode)
+                res = measure(args.faust, dsp, lang, mode, args.repeat, args.timeout, args.phases)
+                results["results"][key] = res
+                if res["status"] == "ok":
+                    print("%-70s %8.3fs %8d KB" % (key, res["cpu"], res["rss"]))
+                else:
+                    print("%-70s %s" % (key, res["status"]))
+                sys.stdout.flush()
+
+    with open(args.output, "w") as f:
+        json.dump(results, f, indent=1, sort_keys=True)
+
+    ok = [r for r in results["results"].values() if r["status"] == "ok"]
+    print("\n%d compilations, %d ok, total time %.3fs" % (len(results["results"]), len(ok),
+                                                          sum(r["cpu"] for r in ok)))
+
+    if args.reference:
+        with open(args.reference) as f:
+            reference = json.load(f)
+        regressions, improvements = compare(results, reference, args.time_tolerance, args.mem_tolerance,
+                                            args.min_time)
+        for line in improvements:
+            print("IMPROVED   " + line)
+        for line in regressions:
+            print("REGRESSION " + line)
+        if regressions:
+            print("\n%d regression(s) compared to %s (version %s)" % (len(regressions), args.reference,
+                                                                       reference.get("version")))
+            sys.exit(1)
+        print("\nNo regression compared to %s (version %s)" % (args.reference, reference.get("version")))
+
+
+if __name__ == "__main__":
+    main()
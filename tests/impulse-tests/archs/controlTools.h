@@ -22,7 +22,10 @@
 using std::max;
 using std::min;
 
+// Block size, can be changed with -DkFrames=n to check other block sizes
+#ifndef kFrames
 #define kFrames 64
+#endif
 
 using namespace std;
 
@@ -0,0 +1,10 @@
+// Smoothed controls, and expressions of smoothed controls, which are computed
+// at a decimated control rate with -cr (see the 'cr' target of the Makefile).
+// The reference output is computed at sample rate.
+
+smooth(c) = *(1.0-c) : + ~ *(c);
+
+freq = hslider("freq", 1000, 0, 2000, 1) : smooth(0.999);
+gate = button("gate") : smooth(0.999);
+
+process = cos(freq*0.001), freq, freq*gate, exp(-gate);
@@ -0,0 +1,13 @@
+// Delay lines of at most N samples, kept in an exact size ring buffer of N+1 values
+// in float and double (see InstructionsCompiler::getDelayLine)
+N = 2500;
+
+// Integer based signals, so that float and double outputs stay close
+count = +(1)~_;
+modulator = count : %(2*N) <: min(2*N-_) : min(N) : max(0);
+fix = @(N);
+variable = @(modulator);
+comb = +~(@(N-1) : *(0.5));
+source = count : %(97) : /(97.0);
+
+process = source <: fix, variable, comb;